@@ -8,7 +8,6 @@ This project is under the MIT license
 */
 #ifdef GPS
 
-#include <mutex.h>
 #include <panic.h>
 
 #include <stdint.h>
@@ -19,18 +18,4 @@ This project is under the MIT license
 #define PANIC(msg) core_panic(PANIC_GENERAL_ERROR, msg)
 
 
-// Update UART line every .. ms
-#define UART_UPDATE_MS  500
-
-// Store information given by UART.
-typedef struct {
-    mutex_t mutex;
-    bool is_parsing;
-    uint8_t line_length;
-    char line[128];
-} uart_info_t;
-
-// Unique instance of UART info structure.
-extern uart_info_t uart_info;
-
 #endif
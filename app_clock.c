@@ -35,32 +35,26 @@
 
 #include "app_clock.h"
 
-#include "xtimer.h"
-#include <time.h>
+#include <string.h>
+
+#include "mutex.h"
 
 #include "net/loramac.h"
 #include "semtech_loramac.h"
 #include "loramac_utils.h"
 
-#include "periph_conf.h"
-
-#if MODULE_PERIPH_RTC == 1
-#include "periph/rtc.h"
-#endif
-
+#include "ztimer.h"
 
-#define DEFAULT_TM {0,0,0,1,0,121,0,0,0}
-
-// 1972 and 1976 have 366 days (DELTA_EPOCH_GPS is 315964800 seconds)
-// GPS Epoch consists of a count of weeks and seconds of the week since 0 hours (midnight) Sunday 6 January 1980
-#define DELTA_EPOCH_GPS ((365*8 + 366*2 + 5)*(24*60*60))
+#include "clock_disc.h"
+#include "timebase.h"
 
 // The end-device responds by sending up to NbTransmissions AppTimeReq messages
 // with the AnsRequired bit set to 0.
 // The end-device stops re-transmissions of the AppTimeReq if a valid AppTimeAns is received.
 // If the NbTransmissions field is 0, the command SHALL be silently discarded.
-// The delay between consecutive transmissions of the AppTimeReq is application specific.
-// TODO static unsigned int NbTransmissions = 0;
+// The delay between consecutive transmissions of the AppTimeReq is application specific:
+// one per data frame.
+static uint8_t resync_transmissions = 0;
 
 // TokenReq is a 4 bits counter initially set to 0. TokenReq is incremented (modulo 16) each time the end-device receives and processes successfully an AppTimeAns message.
 static unsigned int TokenReq = 0;
@@ -68,15 +62,20 @@ static unsigned int TokenReq = 0;
 // If the AnsRequired bit is set to 1 the end-device expects an answer whether its clock is well
 // synchronized or not. If this bit is set to 0, this signals to the AS that it only needs to answer if
 // the end-device clock is de-synchronized.
-// TODO static unsigned int AnsRequired = 1;
+// AnsRequired is 1 for the periodic AppTimeReq and 0 for the forced ones.
 
 // Period encodes the periodicity of the AppTimeReq transmissions. The actual periodicity in
 // seconds is 128.2𝑃𝑒𝑟𝑖𝑜𝑑 ±𝑟𝑎𝑛𝑑(30) where 𝑟𝑎𝑛𝑑(30) is a random integer in the +/-30sec
-// range varying with each transmission.
-static bool isPeriodDefined = false;
-static unsigned int Period = 0;
+// range varying with each transmission (see clock_disc).
+
+// an AppTimeReq is waiting for its AppTimeAns since frames_since_time_req data frames
+static bool awaiting_time_ans = false;
+static uint16_t frames_since_time_req = 0;
 
-#define sent_buffer_SIZE ((1 + sizeof(APP_CLOCK_PackageVersionAns_t)) + (1 + sizeof(APP_CLOCK_DeviceAppTimePeriodicityAns_t)) + (1 + sizeof(APP_CLOCK_AppTimeReq_t)))
+// the last AppTimeReq was not transmitted (duty-cycle, busy MAC or full trailer)
+static bool time_req_unsent = false;
+
+#define sent_buffer_SIZE ((1 + APP_CLOCK_PACKAGE_VERSION_ANS_LEN) + (1 + APP_CLOCK_PERIODICITY_ANS_LEN))
 
 static uint8_t sent_buffer[sent_buffer_SIZE];
 
@@ -84,56 +83,66 @@ static uint32_t sent_buffer_cursor = 0;
 
 static uint32_t sent_buffer_device_time_pos = 0;
 
-static time_t lastTimeCorrection = 0; // 01/01/1970
+// incremented when the answers are built again by a new downlink
+static uint32_t sent_buffer_seq = 0;
+
+// trailer of the uplink in progress: cleared by app_clock_trailer_sent
+static uint8_t *trailer_buf = NULL;
+static uint32_t trailer_answers_seq = 0;
+static bool trailer_answers = false;
+// positions of the times to capture immediately before each transmission (0 if none)
+static uint8_t trailer_ans_time_pos = 0;
+static uint8_t trailer_req_time_pos = 0;
+static uint32_t trailer_req_uptime = 0;
+
+// the answers are built by the receiver and sent by the sender
+static mutex_t app_clock_mutex = MUTEX_INIT;
+
+// GPS time of the last correction (0 for never)
+static uint32_t lastTimeCorrection = 0;
+
+// 2022-01-01 00:00:00: the older GNSS times are wrong (no almanac, week number rollover)
+#define GNSS_MIN_TIME_MS			(1325030400ULL * 1000ULL)
+
+// uptime (ZTIMER_SEC) of the last GNSS time
+static bool gnss_synced = false;
+static uint32_t lastGnssTime = 0;
+
+// large step waiting for the confirmation by the next GNSS time
+static bool gnss_step_pending = false;
+static int32_t gnss_pending_step = 0;
 
-/*
- * print a tm struct
- */
-#define TM_YEAR_OFFSET      (1900)
 /**
  * Print the time
  *
  * @param label the label prefixing the time
- * @param time the time
+ * @param gps_sec the time in seconds since 6/1/1980 (GPS start time)
  */
-static void print_time(const char *label, const struct tm *time) {
+static void print_time(const char *label, uint32_t gps_sec) {
+	timebase_civil_t time;
+	timebase_to_civil(gps_sec, &time);
 	DEBUG("%s  %04d-%02d-%02d %02d:%02d:%02d\n", label,
-			time->tm_year + TM_YEAR_OFFSET, time->tm_mon + 1, time->tm_mday,
-			time->tm_hour, time->tm_min, time->tm_sec);
+			time.year, time.month, time.day,
+			time.hour, time.min, time.sec);
 }
 
 /**
  * Print the RTC time
  */
 void app_clock_print_rtc(void) {
-	/* read RTC */
-	struct tm current_time = DEFAULT_TM;
-#if MODULE_PERIPH_RTC == 1
-	rtc_get_time(&current_time);
-#endif
-	print_time("[clock] Current RTC time : ", &current_time);
-	struct tm lastTimeCorrectionTime = *localtime(&lastTimeCorrection);
+	print_time("[clock] Current RTC time : ", timebase_now_sec());
 	if (lastTimeCorrection == 0) {
 		DEBUG("[clock] Last correction  : never\n");
 	} else {
-		print_time("[clock] Last correction  : ", &lastTimeCorrectionTime);
+		print_time("[clock] Last correction  : ", lastTimeCorrection);
 	}
 }
 
 /**
- * Get the RTC time in seconds since 1/1/1980 (GPS time)
+ * Get the time in seconds since 6/1/1980 (GPS time)
  */
 static unsigned int getTimeSinceEpoch(void) {
-	struct tm current_time = DEFAULT_TM;
-	// Read the RTC current time
-#if MODULE_PERIPH_RTC == 1
-	rtc_get_time(&current_time);
-#endif
-	print_time("[clock] Current time: ", &current_time);
-	time_t timeSinceEpoch = mktime(&current_time);
-	// substract number of seconds between 6/1/1980 and 1/1/1970
-	timeSinceEpoch -= DELTA_EPOCH_GPS;
-	return timeSinceEpoch;
+	return timebase_now_sec();
 }
 
 /**
@@ -142,22 +151,11 @@ static unsigned int getTimeSinceEpoch(void) {
  * @param timeCorrection the correction to apply to the RTC
  */
 static void correct_rtc(int timeCorrection) {
-	struct tm current_time = DEFAULT_TM;
-	// Read the RTC current time
-#if MODULE_PERIPH_RTC == 1
-	rtc_get_time(&current_time);
-#endif
-	print_time("[clock] Current time    : ", &current_time);
-	time_t timeSinceEpoch = mktime(&current_time);
-	// Apply correction
-	timeSinceEpoch += timeCorrection;
+	print_time("[clock] Current time    : ", timebase_now_sec());
 	DEBUG("[clock] Time Correction : %d\n", timeCorrection);
-	current_time = *localtime(&timeSinceEpoch);
-#if MODULE_PERIPH_RTC == 1
-	rtc_set_time(&current_time);
-#endif
-	lastTimeCorrection = mktime(&current_time);
-	print_time("[clock] RTC time fixed  : ", &current_time);
+	timebase_adjust(timeCorrection);
+	lastTimeCorrection = timebase_now_sec();
+	print_time("[clock] RTC time fixed  : ", lastTimeCorrection);
 }
 
 /**
@@ -166,302 +164,356 @@ static void correct_rtc(int timeCorrection) {
  * @param timeToSet the time in seconds since 6/1/1980 (GPS start time)
  */
 static void set_rtc(unsigned int timeToSet) {
-	struct tm current_time = DEFAULT_TM;
-	// Read the RTC current time
-#if MODULE_PERIPH_RTC == 1
-	rtc_get_time(&current_time);
-#endif
-	print_time("[clock] Current time    : ", &current_time);
-	time_t _TimeToSet = timeToSet + DELTA_EPOCH_GPS;
-	current_time = *localtime(&_TimeToSet);
-#if MODULE_PERIPH_RTC == 1
-	rtc_set_time(&current_time);
-#endif
-	lastTimeCorrection = mktime(&current_time);
-	print_time("[clock] RTC time fixed  : ", &current_time);
+	print_time("[clock] Current time    : ", timebase_now_sec());
+	timebase_set(timeToSet);
+	lastTimeCorrection = timeToSet;
+	print_time("[clock] RTC time fixed  : ", lastTimeCorrection);
 }
 
-int8_t app_clock_process_downlink(semtech_loramac_t *loramac) {
-	DEBUG("[clock] app_clock_process_downlink\n");
-
-	uint32_t len = loramac->rx_data.payload_len;
-
-	uint32_t idx = 0;
-
-	uint8_t *payload = (uint8_t*) loramac->rx_data.payload;
-
-	int8_t error = APP_CLOCK_OK;
+static uint32_t get_u32le(const uint8_t *buf) {
+	return (uint32_t) buf[0] | ((uint32_t) buf[1] << 8)
+			| ((uint32_t) buf[2] << 16) | ((uint32_t) buf[3] << 24);
+}
 
-	sent_buffer_cursor = 0;
+static void put_u32le(uint8_t *buf, uint32_t v) {
+	buf[0] = (uint8_t) v;
+	buf[1] = (uint8_t) (v >> 8);
+	buf[2] = (uint8_t) (v >> 16);
+	buf[3] = (uint8_t) (v >> 24);
+}
 
-	bool contains_APP_CLOCK_CID_PackageVersionReq = false;
-	bool contains_APP_CLOCK_CID_DeviceAppTimePeriodicityReq = false;
-	bool contains_APP_CLOCK_CID_AppTimeAns = false;
-	bool contains_APP_CLOCK_CID_ForceDeviceResyncReq = false;
-#ifdef EXPERIMENTAL
-	bool contains_X_APP_CLOCK_CID_AppTimeSetReq = false;
-#endif
+int8_t app_clock_parse(const uint8_t *payload, uint8_t len, app_clock_cmds_t *cmds) {
+	memset(cmds, 0, sizeof(app_clock_cmds_t));
 
-	while (idx < len && (error == APP_CLOCK_OK )) {
+	uint8_t idx = 0;
+	while (idx < len) {
 		uint8_t cid = payload[idx];
+		uint8_t size;
+		uint8_t flag;
 		switch (cid) {
-		case APP_CLOCK_CID_PackageVersionReq :
-			DEBUG("[clock] APP_CLOCK_CID_PackageVersionReq\n")
-			;
-			if (contains_APP_CLOCK_CID_PackageVersionReq) {
-				error = APP_CLOCK_CID_ALREADY_PROCESS;
-				DEBUG("[clock] APP_CLOCK_CID_PackageVersionReq, error=%d\n", error);
-				break;
-			}
-			contains_APP_CLOCK_CID_PackageVersionReq = true;
-			if (idx + 1 + 0 <= len) {
-
-				sent_buffer[sent_buffer_cursor] =
-						APP_CLOCK_CID_PackageVersionAns;
-				APP_CLOCK_PackageVersionAns_t *pva =
-						(APP_CLOCK_PackageVersionAns_t*) (sent_buffer
-								+ (1 + sent_buffer_cursor));
-				pva->PackageIdentifier = 1;
-				pva->PackageVersion = 1;
-
-				sent_buffer_cursor +=
-						(1 + sizeof(APP_CLOCK_PackageVersionAns_t));
-				idx += 1;
-			} else {
-				error = APP_CLOCK_ERROR_OVERFLOW;
-				DEBUG("[clock] APP_CLOCK_CID_PackageVersionReq, error=%d\n", error);
-			}
+		case APP_CLOCK_CID_PackageVersionReq:
+			size = 0;
+			flag = APP_CLOCK_CMD_PACKAGE_VERSION;
 			break;
-
-		case APP_CLOCK_CID_DeviceAppTimePeriodicityReq :
-			DEBUG("[clock] APP_CLOCK_CID_DeviceAppTimePeriodicityReq\n")
-			;
-			if (contains_APP_CLOCK_CID_DeviceAppTimePeriodicityReq) {
-				error = APP_CLOCK_CID_ALREADY_PROCESS;
-				DEBUG("[clock] APP_CLOCK_CID_DeviceAppTimePeriodicityReq, error=%d\n",
-						error);
-				break;
-			}
-			contains_APP_CLOCK_CID_DeviceAppTimePeriodicityReq = true;
-
-			if (idx + 1 + sizeof(APP_CLOCK_DeviceAppTimePeriodicityReq_t)
-					<= len) {
-				APP_CLOCK_DeviceAppTimePeriodicityReq_t *datpr =
-						(APP_CLOCK_DeviceAppTimePeriodicityReq_t*) (payload
-								+ (idx + 1));
-
-				isPeriodDefined = true;
-				Period = datpr->Period;
-
-				sent_buffer[sent_buffer_cursor] =
-						APP_CLOCK_CID_DeviceAppTimePeriodicityAns;
-				APP_CLOCK_DeviceAppTimePeriodicityAns_t *datpa =
-						(APP_CLOCK_DeviceAppTimePeriodicityAns_t*) (sent_buffer
-								+ (1 + sent_buffer_cursor));
-				sent_buffer_device_time_pos = 1 + sent_buffer_cursor;
-				datpa->NotSupported = 0; // The endpoint is not supporting periodicity currently
-				datpa->Time = getTimeSinceEpoch();
-
-				sent_buffer_cursor += (1
-						+ sizeof(APP_CLOCK_DeviceAppTimePeriodicityAns_t));
-				idx += (1 + sizeof(APP_CLOCK_DeviceAppTimePeriodicityReq_t));
-			} else {
-				error = APP_CLOCK_ERROR_OVERFLOW;
-				DEBUG("[clock] APP_CLOCK_CID_DeviceAppTimePeriodicityReq, error=%d\n",
-						error);
-			}
+		case APP_CLOCK_CID_AppTimeAns:
+			size = APP_CLOCK_APP_TIME_ANS_LEN;
+			flag = APP_CLOCK_CMD_APP_TIME;
 			break;
+		case APP_CLOCK_CID_DeviceAppTimePeriodicityReq:
+			size = APP_CLOCK_PERIODICITY_REQ_LEN;
+			flag = APP_CLOCK_CMD_PERIODICITY;
+			break;
+		case APP_CLOCK_CID_ForceDeviceResyncReq:
+			size = APP_CLOCK_FORCE_RESYNC_REQ_LEN;
+			flag = APP_CLOCK_CMD_FORCE_RESYNC;
+			break;
+#ifdef EXPERIMENTAL
+		case X_APP_CLOCK_CID_AppTimeSetReq:
+			size = X_APP_CLOCK_APP_TIME_SET_REQ_LEN;
+			flag = APP_CLOCK_CMD_APP_TIME_SET;
+			break;
+#endif
+		default:
+			// the length of the next commands is unknown
+			return APP_CLOCK_UNKNOWN_CID;
+		}
 
-		case APP_CLOCK_CID_AppTimeAns :
-			DEBUG("[clock] APP_CLOCK_CID_AppTimeAns\n")
-			;
-			if (contains_APP_CLOCK_CID_AppTimeAns) {
-				error = APP_CLOCK_CID_ALREADY_PROCESS;
-				DEBUG("[clock] APP_CLOCK_CID_AppTimeAns, error=%d\n", error);
-				break;
-			}
-			contains_APP_CLOCK_CID_AppTimeAns = true;
-
-			if (idx + 1 + sizeof(APP_CLOCK_AppTimeAns_t) <= len) {
-				APP_CLOCK_AppTimeAns_t *ata = (APP_CLOCK_AppTimeAns_t*) (payload
-						+ (idx + 1));
-
-				unsigned int TokenAns = ata->TokenAns;
-				if (TokenAns != TokenReq) {
-					error = APP_CLOCK_BAD_TOKEN;
-					DEBUG("[clock] APP_CLOCK_CID_AppTimeAns, error=%d\n", error);
-					break;
-				}
-
-				correct_rtc(ata->TimeCorrection);
-
-				// increment TokenReq
-				TokenReq++;
-				TokenReq %= 16;
+		const uint8_t *p = payload + idx + 1;
+		idx += 1 + size;
+		if (idx > len) {
+			return APP_CLOCK_ERROR_OVERFLOW;
+		}
+		if (cmds->flags & flag) {
+			// only the first occurrence of a command is processed
+			return APP_CLOCK_CID_ALREADY_PROCESS;
+		}
+		cmds->flags |= flag;
 
-				idx += (1 + sizeof(APP_CLOCK_AppTimeAns_t));
-			} else {
-				error = APP_CLOCK_ERROR_OVERFLOW;
-				DEBUG("[clock] APP_CLOCK_CID_AppTimeAns, error=%d\n", error);
-			}
+		switch (cid) {
+		case APP_CLOCK_CID_AppTimeAns:
+			cmds->time_correction = (int32_t) get_u32le(p);
+			cmds->token_ans = p[4] & 0x0F;
 			break;
-
-		case APP_CLOCK_CID_ForceDeviceResyncReq :
-			DEBUG("[clock] APP_CLOCK_CID_ForceDeviceResyncReq\n")
-			;
-			if (contains_APP_CLOCK_CID_ForceDeviceResyncReq) {
-				error = APP_CLOCK_CID_ALREADY_PROCESS;
-				DEBUG("[clock] APP_CLOCK_CID_ForceDeviceResyncReq, error=%d\n", error);
-				break;
-			}
-			contains_APP_CLOCK_CID_ForceDeviceResyncReq = true;
-
-			if (idx + 1 + sizeof(APP_CLOCK_ForceDeviceResyncReq_t) <= len) {
-				APP_CLOCK_ForceDeviceResyncReq_t *fdrr =
-						(APP_CLOCK_ForceDeviceResyncReq_t*) (payload + (idx + 1));
-				unsigned int NbTransmissions = fdrr->NbTransmissions;
-				(void) NbTransmissions;
-				// TODO
-
-				idx += (1 + sizeof(APP_CLOCK_ForceDeviceResyncReq_t));
-				error = APP_CLOCK_NOT_IMPLEMENTED;
-				DEBUG("[clock] APP_CLOCK_CID_ForceDeviceResyncReq, error=%d\n", error);
-			} else {
-				error = APP_CLOCK_ERROR_OVERFLOW;
-				DEBUG("[clock] APP_CLOCK_CID_ForceDeviceResyncReq, error=%d\n", error);
-			}
+		case APP_CLOCK_CID_DeviceAppTimePeriodicityReq:
+			cmds->period = p[0] & 0x0F;
+			break;
+		case APP_CLOCK_CID_ForceDeviceResyncReq:
+			cmds->nb_transmissions = p[0] & 0x07;
 			break;
-
 #ifdef EXPERIMENTAL
-		case X_APP_CLOCK_CID_AppTimeSetReq :
-			DEBUG("[clock] X_APP_CLOCK_CID_AppTimeSetReq\n")
-			;
-			if (contains_X_APP_CLOCK_CID_AppTimeSetReq) {
-				error = APP_CLOCK_CID_ALREADY_PROCESS;
-				DEBUG("[clock] X_APP_CLOCK_CID_AppTimeSetReq, error=%d\n", error);
-				break;
-			}
-			contains_X_APP_CLOCK_CID_AppTimeSetReq = true;
-
-			if (idx + 1 + sizeof(X_APP_CLOCK_AppTimeSetReq_t) <= len) {
-				X_APP_CLOCK_AppTimeSetReq_t *atsr =
-						(X_APP_CLOCK_AppTimeSetReq_t*) (payload + (idx + 1));
-				set_rtc(atsr->TimeToSet);
-				idx += (1 + sizeof(X_APP_CLOCK_AppTimeSetReq_t));
-			} else {
-				error = APP_CLOCK_ERROR_OVERFLOW;
-				DEBUG("[clock] X_APP_CLOCK_CID_AppTimeSetReq, error=%d\n", error);
-			}
+		case X_APP_CLOCK_CID_AppTimeSetReq:
+			cmds->time_to_set = get_u32le(p);
 			break;
 #endif
-
 		default:
-			error = APP_CLOCK_UNKNOWN_CID;
-			DEBUG("[clock] APP_CLOCK : Unknown CID, error=%d\n", error)
-			;
 			break;
 		}
 	}
+	return APP_CLOCK_OK;
+}
+
+int8_t app_clock_process_downlink(semtech_loramac_t *loramac) {
+	DEBUG("[clock] app_clock_process_downlink\n");
+
+	app_clock_cmds_t cmds;
+	int8_t error = app_clock_parse((const uint8_t*) loramac->rx_data.payload,
+			loramac->rx_data.payload_len, &cmds);
+	if (error != APP_CLOCK_OK) {
+		// the commands before the error are processed
+		DEBUG("[clock] parse error=%d\n", error);
+	}
+
+	mutex_lock(&app_clock_mutex);
+	sent_buffer_cursor = 0;
+	sent_buffer_device_time_pos = 0;
+	sent_buffer_seq++;
+
+	if (cmds.flags & APP_CLOCK_CMD_PACKAGE_VERSION) {
+		DEBUG("[clock] APP_CLOCK_CID_PackageVersionReq\n");
+		sent_buffer[sent_buffer_cursor++] = APP_CLOCK_CID_PackageVersionAns;
+		sent_buffer[sent_buffer_cursor++] = APP_CLOCK_PACKAGE_IDENTIFIER;
+		sent_buffer[sent_buffer_cursor++] = APP_CLOCK_PACKAGE_VERSION;
+	}
+
+	if (cmds.flags & APP_CLOCK_CMD_APP_TIME) {
+		DEBUG("[clock] APP_CLOCK_CID_AppTimeAns\n");
+		if (cmds.token_ans == TokenReq) {
+			correct_rtc(cmds.time_correction);
+			clock_disc_correction(ztimer_now(ZTIMER_SEC), cmds.time_correction);
+			awaiting_time_ans = false;
+			// a valid AppTimeAns stops the forced resynchronization
+			resync_transmissions = 0;
+
+			// increment TokenReq
+			TokenReq++;
+			TokenReq %= 16;
+		} else {
+			// the AppTimeAns is discarded
+			DEBUG("[clock] TokenAns=%d TokenReq=%d\n", cmds.token_ans, TokenReq);
+			if (error == APP_CLOCK_OK) {
+				error = APP_CLOCK_BAD_TOKEN;
+			}
+		}
+	}
+
+	if (cmds.flags & APP_CLOCK_CMD_PERIODICITY) {
+		DEBUG("[clock] APP_CLOCK_CID_DeviceAppTimePeriodicityReq\n");
+		clock_disc_set_period(cmds.period);
+
+		sent_buffer[sent_buffer_cursor++] = APP_CLOCK_CID_DeviceAppTimePeriodicityAns;
+		// NotSupported = 0
+		sent_buffer[sent_buffer_cursor++] = 0;
+		// the time is captured immediately before the transmission
+		sent_buffer_device_time_pos = sent_buffer_cursor;
+		put_u32le(sent_buffer + sent_buffer_cursor, getTimeSinceEpoch());
+		sent_buffer_cursor += sizeof(uint32_t);
+	}
+
+	if (cmds.flags & APP_CLOCK_CMD_FORCE_RESYNC) {
+		DEBUG("[clock] APP_CLOCK_CID_ForceDeviceResyncReq NbTransmissions=%d\n",
+				cmds.nb_transmissions);
+		// NbTransmissions = 0: the command is silently discarded
+		if (cmds.nb_transmissions != 0) {
+			resync_transmissions = cmds.nb_transmissions;
+		}
+	}
+
+#ifdef EXPERIMENTAL
+	if (cmds.flags & APP_CLOCK_CMD_APP_TIME_SET) {
+		DEBUG("[clock] X_APP_CLOCK_CID_AppTimeSetReq\n");
+		set_rtc(cmds.time_to_set);
+		clock_disc_reset();
+	}
+#endif
 
 	DEBUG("[clock] sent_buffer:");
 	printf_ba(sent_buffer, sent_buffer_cursor);
 	DEBUG("\n");
 
-	if (error == APP_CLOCK_OK) {
-		error = app_clock_send_buffer(loramac);
-	} else {
-		sent_buffer_cursor = 0;
-	}
-
-	// TODO if NbTransmissions > 0, send an APP_CLOCK_CID_AppTimeReq
+	// the answers are sent into the trailer of the next data uplink
+	mutex_unlock(&app_clock_mutex);
 
 	return error;
 }
 
-int8_t app_clock_send_app_time_req(semtech_loramac_t *loramac) {
-	DEBUG("[clock] app_clock_send_app_time_req\n");
+/**
+ * Capture the times of the trailer (to call with the mutex locked)
+ */
+static void stamp_trailer(void) {
+	uint32_t now = getTimeSinceEpoch();
+	if (trailer_ans_time_pos != 0) {
+		put_u32le(trailer_buf + trailer_ans_time_pos, now);
+	}
+	if (trailer_req_time_pos != 0) {
+		put_u32le(trailer_buf + trailer_req_time_pos, now);
+		trailer_req_uptime = ztimer_now(ZTIMER_SEC);
+	}
+}
 
-	uint8_t payload[1 + sizeof(APP_CLOCK_AppTimeReq_t)];
-	payload[0] = APP_CLOCK_CID_AppTimeReq;
+uint8_t app_clock_encode_trailer(uint8_t *buf, uint8_t max_len, bool time_req) {
+	mutex_lock(&app_clock_mutex);
+
+	uint8_t len = 0;
+	trailer_buf = NULL;
+	trailer_answers = false;
+	trailer_ans_time_pos = 0;
+	trailer_req_time_pos = 0;
+
+	if (sent_buffer_cursor != 0 && sent_buffer_cursor <= max_len) {
+		memcpy(buf, sent_buffer, sent_buffer_cursor);
+		len = sent_buffer_cursor;
+		trailer_answers = true;
+		trailer_answers_seq = sent_buffer_seq;
+		trailer_ans_time_pos = sent_buffer_device_time_pos;
+	}
 
-	APP_CLOCK_AppTimeReq_t *atr = (APP_CLOCK_AppTimeReq_t*) (payload + 1);
-	atr->TokenReq = TokenReq;
-	atr->AnsRequired = 1;
+	if (time_req && len + APP_CLOCK_APP_TIME_REQ_SIZE <= max_len) {
+		// the periodic AppTimeReq always requires an answer (the clock discipline needs
+		// all the corrections); the forced ones are answered only if the clock is wrong
+		uint8_t ans_required = (resync_transmissions > 0) ? 0 : 1;
+		buf[len] = APP_CLOCK_CID_AppTimeReq;
+		trailer_req_time_pos = len + 1;
+		buf[len + 1 + sizeof(uint32_t)] = (TokenReq & 0x0F) | (ans_required << 4);
+		len += APP_CLOCK_APP_TIME_REQ_SIZE;
+	} else if (time_req) {
+		// sent into the trailer of the next data frame
+		time_req_unsent = true;
+	}
 
-	atr->DeviceTime = getTimeSinceEpoch();
+	if (len != 0) {
+		trailer_buf = buf;
+		stamp_trailer();
+	}
+	mutex_unlock(&app_clock_mutex);
 
-	// save the current fPort and set the APP_CLOCK_PORT
-	uint8_t current_fPort = semtech_loramac_get_tx_port(loramac);
-	semtech_loramac_set_tx_port(loramac, APP_CLOCK_PORT);
+	if (len != 0) {
+		DEBUG("[clock] trailer:");
+		printf_ba(buf, len);
+		DEBUG("\n");
+	}
+	return len;
+}
 
-	/* send the LoRaWAN message */
-	// TODO thread can be stuck into the semtech_loramac_send
-	uint8_t ret = semtech_loramac_send(loramac, payload,
-			1 + sizeof(APP_CLOCK_AppTimeReq_t));
+void app_clock_restamp_trailer(void) {
+	mutex_lock(&app_clock_mutex);
+	if (trailer_buf != NULL) {
+		stamp_trailer();
+	}
+	mutex_unlock(&app_clock_mutex);
+}
 
-	int8_t error;
-	if (ret != SEMTECH_LORAMAC_TX_DONE) {
-		DEBUG("[clock] Cannot send buffer : ret code: %d (%s)\n", ret,
-				loramac_utils_err_message(ret));
-		if (ret == SEMTECH_LORAMAC_TX_SCHEDULE
-				|| ret == SEMTECH_LORAMAC_DUTYCYCLE_RESTRICTED) {
-			error = APP_CLOCK_TX_RETRY_LATER;
-		} else {
-			error = APP_CLOCK_TX_KO;
-			// reset the buffer
+void app_clock_trailer_sent(uint8_t ret) {
+	mutex_lock(&app_clock_mutex);
+	if (trailer_buf == NULL) {
+		mutex_unlock(&app_clock_mutex);
+		return;
+	}
+	if (ret == SEMTECH_LORAMAC_TX_DONE || ret == SEMTECH_LORAMAC_TX_CNF_FAILED) {
+		// the answers are not cleared if a new downlink has built other answers
+		if (trailer_answers && trailer_answers_seq == sent_buffer_seq) {
 			sent_buffer_cursor = 0;
+			sent_buffer_device_time_pos = 0;
 		}
-	} else {
-		error = APP_CLOCK_OK;
+		if (trailer_req_time_pos != 0) {
+			if (resync_transmissions > 0) {
+				resync_transmissions--;
+			}
+			awaiting_time_ans = true;
+			frames_since_time_req = 0;
+			clock_disc_req_sent(trailer_req_uptime);
+		}
+	} else if (trailer_req_time_pos != 0) {
+		// not transmitted: the answers and the AppTimeReq are sent into the next data frame
+		time_req_unsent = true;
 	}
-
-	// restore the current fPort
-	semtech_loramac_set_tx_port(loramac, current_fPort);
-
-	return error;
+	trailer_buf = NULL;
+	mutex_unlock(&app_clock_mutex);
 }
 
-int8_t app_clock_send_buffer(semtech_loramac_t *loramac) {
-	DEBUG("[clock] app_clock_send_buffer\n");
+/**
+ * Check if the GNSS time is available (to call with the mutex locked)
+ */
+static bool gnss_time_available(void) {
+	return gnss_synced
+			&& (uint32_t)(ztimer_now(ZTIMER_SEC) - lastGnssTime) < APP_CLOCK_GNSS_VALIDITY_SEC;
+}
 
-	int8_t error = APP_CLOCK_OK;
+void app_clock_gnss_time(uint64_t gps_ms) {
+	if (gps_ms < GNSS_MIN_TIME_MS) {
+		DEBUG("[clock] GNSS time rejected (too old)\n");
+		return;
+	}
+	mutex_lock(&app_clock_mutex);
+	int64_t delta_ms = (int64_t)(gps_ms - timebase_now_ms());
+	// rounded to the second
+	int32_t step = (int32_t)((delta_ms + (delta_ms < 0 ? -500 : 500)) / 1000);
+	if (step > APP_CLOCK_GNSS_MAX_STEP_SEC || step < -APP_CLOCK_GNSS_MAX_STEP_SEC) {
+		int32_t diff = step - gnss_pending_step;
+		if (!gnss_step_pending || diff > 2 || diff < -2) {
+			DEBUG("[clock] GNSS time off by %ld sec: waiting for a confirmation\n", (long)step);
+			gnss_step_pending = true;
+			gnss_pending_step = step;
+			mutex_unlock(&app_clock_mutex);
+			return;
+		}
+	}
+	gnss_step_pending = false;
+	if (delta_ms >= 1000 || delta_ms <= -1000) {
+		correct_rtc(step);
+		// the samples of the network synchronization are meaningless
+		clock_disc_reset();
+	}
+	gnss_synced = true;
+	lastGnssTime = ztimer_now(ZTIMER_SEC);
+	// no AppTimeAns is expected while the GNSS time is available
+	awaiting_time_ans = false;
+	mutex_unlock(&app_clock_mutex);
+}
 
-	if (sent_buffer_cursor != 0) {
-		// save the current fPort and set the APP_CLOCK_PORT
-		uint8_t current_fPort = semtech_loramac_get_tx_port(loramac);
-		semtech_loramac_set_tx_port(loramac, APP_CLOCK_PORT);
+bool app_clock_time_req_due(uint16_t retry_frames) {
+	mutex_lock(&app_clock_mutex);
+	bool due;
+	if (time_req_unsent) {
+		time_req_unsent = false;
+		due = true;
+	} else if (resync_transmissions > 0) {
+		// one AppTimeReq per data frame
+		due = true;
+	} else if (gnss_time_available()) {
+		// no clock sync airtime with the GNSS time
+		due = false;
+	} else if (awaiting_time_ans) {
+		// no AppTimeAns yet
+		due = ++frames_since_time_req >= retry_frames;
+	} else {
+		due = clock_disc_sync_due(ztimer_now(ZTIMER_SEC));
+	}
+	mutex_unlock(&app_clock_mutex);
+	return due;
+}
 
-		if (sent_buffer_device_time_pos != 0) {
-			APP_CLOCK_DeviceAppTimePeriodicityAns_t *datpa =
-					(APP_CLOCK_DeviceAppTimePeriodicityAns_t*) (sent_buffer
-							+ (1 + sent_buffer_device_time_pos));
-			datpa->Time = getTimeSinceEpoch();
+void app_clock_discipline(void) {
+	mutex_lock(&app_clock_mutex);
+	if (!gnss_time_available()) {
+		int32_t step = clock_disc_compensation(ztimer_now(ZTIMER_SEC));
+		if (step != 0) {
+			correct_rtc(step);
 		}
-		/* send the LoRaWAN message */
-		uint8_t ret = semtech_loramac_send(loramac, sent_buffer,
-				sent_buffer_cursor);
-
-		if (ret != SEMTECH_LORAMAC_TX_DONE) {
-			DEBUG("[clock] Cannot send buffer : ret code: %d (%s)\n", ret,
-					loramac_utils_err_message(ret));
-			if (ret == SEMTECH_LORAMAC_TX_SCHEDULE
-					|| ret == SEMTECH_LORAMAC_DUTYCYCLE_RESTRICTED) {
-				error = APP_CLOCK_TX_RETRY_LATER;
-			} else {
-				error = APP_CLOCK_TX_KO;
-				// reset the buffer
-				sent_buffer_cursor = 0;
-			}
-		} else {
-			// reset the buffer
-			sent_buffer_cursor = 0;
-		}
-
-		// restore the current fPort
-		semtech_loramac_set_tx_port(loramac, current_fPort);
 	}
+	mutex_unlock(&app_clock_mutex);
+}
 
-	return error;
+void app_clock_print_discipline(void) {
+	mutex_lock(&app_clock_mutex);
+	if (gnss_synced) {
+		DEBUG("[clock] Last GNSS time   : %lu sec ago%s\n",
+				(unsigned long)(ztimer_now(ZTIMER_SEC) - lastGnssTime),
+				gnss_time_available() ? "" : " (expired)");
+	} else {
+		DEBUG("[clock] Last GNSS time   : never\n");
+	}
+	mutex_unlock(&app_clock_mutex);
+	clock_disc_print(ztimer_now(ZTIMER_SEC));
 }
 
 bool app_clock_is_pending_buffer(void) {
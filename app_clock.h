@@ -34,6 +34,7 @@
 #define APP_CLOCK_H_
 
 #include <inttypes.h>
+#include <stdbool.h>
 #include "semtech_loramac.h"
 
 // Comment the following define for removing experimental CID
@@ -158,6 +159,50 @@ typedef struct {
 } __attribute__((packed)) X_APP_CLOCK_AppTimeSetReq_t;
 #endif
 
+/**
+ * Lengths of the commands (without the CID) on the air (little endian).
+ * The layout of the bitfields is compiler specific: the structs above are not used for
+ * the encoding and the decoding.
+ */
+#define APP_CLOCK_PACKAGE_VERSION_ANS_LEN		(2U)
+#define APP_CLOCK_APP_TIME_REQ_LEN				(5U)
+#define APP_CLOCK_APP_TIME_ANS_LEN				(5U)
+#define APP_CLOCK_PERIODICITY_REQ_LEN			(1U)
+#define APP_CLOCK_PERIODICITY_ANS_LEN			(5U)
+#define APP_CLOCK_FORCE_RESYNC_REQ_LEN			(1U)
+#ifdef EXPERIMENTAL
+#define X_APP_CLOCK_APP_TIME_SET_REQ_LEN		(4U)
+#endif
+
+#define APP_CLOCK_PACKAGE_IDENTIFIER			(1U)
+#define APP_CLOCK_PACKAGE_VERSION				(1U)
+
+/**
+ * Size of the payload of an AppTimeReq uplink
+ */
+#define APP_CLOCK_APP_TIME_REQ_SIZE				(1 + APP_CLOCK_APP_TIME_REQ_LEN)
+
+/**
+ * Flags of the commands of a downlink
+ */
+#define APP_CLOCK_CMD_PACKAGE_VERSION			(1U << 0)
+#define APP_CLOCK_CMD_APP_TIME					(1U << 1)
+#define APP_CLOCK_CMD_PERIODICITY				(1U << 2)
+#define APP_CLOCK_CMD_FORCE_RESYNC				(1U << 3)
+#define APP_CLOCK_CMD_APP_TIME_SET				(1U << 4)
+
+/**
+ * Commands of a downlink
+ */
+typedef struct {
+	uint8_t flags;				/**< APP_CLOCK_CMD_xxx of the commands present */
+	int32_t time_correction;	/**< TimeCorrection of the AppTimeAns */
+	uint8_t token_ans;			/**< TokenAns of the AppTimeAns */
+	uint8_t period;				/**< Period of the DeviceAppTimePeriodicityReq */
+	uint8_t nb_transmissions;	/**< NbTransmissions of the ForceDeviceResyncReq */
+	uint32_t time_to_set;		/**< TimeToSet of the AppTimeSetReq */
+} app_clock_cmds_t;
+
 #define APP_CLOCK_OK							(int8_t)0
 #define APP_CLOCK_ERROR_OVERFLOW				(int8_t)-1
 #define APP_CLOCK_NOT_IMPLEMENTED				(int8_t)-2
@@ -172,6 +217,18 @@ typedef struct {
  */
 extern void app_clock_print_rtc(void);
 
+/**
+ * Parse the payload of an APP_CLOCK downlink frame (no side effect)
+ *
+ * @param payload the payload
+ * @param len the length of the payload
+ * @param cmds the commands parsed before the end of the payload or the first error
+ *
+ * @return APP_CLOCK_OK, APP_CLOCK_UNKNOWN_CID, APP_CLOCK_ERROR_OVERFLOW (truncated command)
+ *         or APP_CLOCK_CID_ALREADY_PROCESS (duplicated command)
+ */
+extern int8_t app_clock_parse(const uint8_t *payload, uint8_t len, app_clock_cmds_t *cmds);
+
 /**
  * Process the payload of APP_CLOCK downlink frame
  *
@@ -180,18 +237,83 @@ extern void app_clock_print_rtc(void);
 extern int8_t app_clock_process_downlink(semtech_loramac_t *loramac);
 
 /**
- * Send a uplink frame with a APP_TIME_REQ paylaod
+ * Encode the pending answers built by the app_clock_process_downlink function and
+ * an AppTimeReq (if requested) for the trailer of a data uplink.
+ * The pending answers are kept until app_clock_trailer_sent reports the transmission.
  *
- * @param loramac the LoRaMac context
+ * @param buf the buffer of the trailer (kept until app_clock_trailer_sent)
+ * @param max_len the max length of the trailer
+ * @param time_req true for adding an AppTimeReq
+ *
+ * @return the length of the trailer (0 if nothing to send)
+ */
+extern uint8_t app_clock_encode_trailer(uint8_t *buf, uint8_t max_len, bool time_req);
+
+/**
+ * Capture again the DeviceTime of the AppTimeReq and the Time of the DeviceAppTimePeriodicityAns
+ * of the trailer (to call immediately before each transmission attempt)
  */
-extern int8_t app_clock_send_app_time_req(semtech_loramac_t *loramac);
+extern void app_clock_restamp_trailer(void);
 
 /**
- * Send a uplink frame with a payload built by the app_clock_process_downlink function.
+ * Report the result of the uplink carrying the trailer: the pending answers are cleared
+ * and the AppTimeReq is accounted only if the uplink is transmitted (TX_DONE or TX_CNF_FAILED)
  *
- * @param loramac the LoRaMac context
+ * @param ret the return code of the send
+ */
+extern void app_clock_trailer_sent(uint8_t ret);
+
+/**
+ * Check if an AppTimeReq is due: at the periodicity of the clock discipline, or every
+ * retry_frames data frames while the last AppTimeReq is not answered.
+ * To call once per data frame.
+ *
+ * @param retry_frames the number of data frames before sending again an unanswered AppTimeReq
+ *
+ * @return true if an AppTimeReq has to be added into the trailer
+ */
+extern bool app_clock_time_req_due(uint16_t retry_frames);
+
+/**
+ * Length of the FOpts reserved into the max payload of the DR when the trailer is sized:
+ * LinkCheckReq (1) + LinkADRAns (2) + DevStatusAns (3)
+ */
+#ifndef APP_CLOCK_TRAILER_FOPTS_LEN
+#define APP_CLOCK_TRAILER_FOPTS_LEN					(6U)
+#endif
+
+/**
+ * Max step (in seconds) of the clock by the GNSS time: a larger step is applied only when
+ * it is confirmed by the next GNSS time
+ */
+#ifndef APP_CLOCK_GNSS_MAX_STEP_SEC
+#define APP_CLOCK_GNSS_MAX_STEP_SEC					(300)
+#endif
+
+/**
+ * The AppTimeReq are disabled during APP_CLOCK_GNSS_VALIDITY_SEC after the last GNSS time
+ */
+#ifndef APP_CLOCK_GNSS_VALIDITY_SEC
+#define APP_CLOCK_GNSS_VALIDITY_SEC					(6UL * 3600UL)
+#endif
+
+/**
+ * Discipline the clock with the GNSS time (the clock is corrected when it is off by one
+ * second or more). The AppTimeReq are disabled while the GNSS time is available.
+ *
+ * @param gps_ms the GNSS time in milliseconds since 6/1/1980 (GPS start time)
+ */
+extern void app_clock_gnss_time(uint64_t gps_ms);
+
+/**
+ * Compensate the drift of the RTC estimated since the last AppTimeAns (to call periodically)
+ */
+extern void app_clock_discipline(void);
+
+/**
+ * Print the state of the clock discipline
  */
-extern int8_t app_clock_send_buffer(semtech_loramac_t *loramac);
+extern void app_clock_print_discipline(void);
 
 /**
  * Check if the payload built by the app_clock_process_downlink function had to be sent.
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Discipline of the RTC: drift estimation and periodicity of the clock synchronization.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include "mutex.h"
+#include "random.h"
+
+#include "clock_disc.h"
+
+#define PPB                             (1000000000LL)
+
+// randomization of the periodicity set by the application server (±30 seconds)
+#define CLOCK_DISC_PERIOD_JITTER_SEC    (30U)
+
+// base of the periodicity set by the application server (128*2^Period seconds)
+#define CLOCK_DISC_PERIOD_BASE_SEC      (128UL)
+
+typedef struct {
+    uint32_t t;         // local time of the correction
+    int32_t adjust;     // sum of the corrections and of the compensations since the reset
+} clock_disc_sample_t;
+
+static mutex_t clock_disc_mutex = MUTEX_INIT;
+
+static clock_disc_sample_t samples[CLOCK_DISC_SAMPLES];
+static uint8_t nb_samples = 0;
+static uint8_t next_sample = 0;
+
+static int32_t adjust = 0;
+static int32_t drift_ppb = 0;
+
+// local time of the last correction and compensation applied since
+static uint32_t t_ref = 0;
+static int32_t compensated = 0;
+
+// interval between two AppTimeReq
+static uint32_t interval_sec = CLOCK_DISC_MIN_INTERVAL_SEC;
+static bool period_defined = false;
+static uint32_t period_sec = 0;
+
+static bool req_sent = false;
+static uint32_t last_req = 0;
+static uint32_t next_interval_sec = 0;
+
+static int64_t div_round(int64_t a, int64_t b)
+{
+    return (a >= 0) ? (a + b / 2) / b : -((-a + b / 2) / b);
+}
+
+/*
+ * Slope (in ppb) of the least-squares line of the samples
+ */
+static void fit_drift(void)
+{
+    uint8_t oldest = (next_sample + CLOCK_DISC_SAMPLES - nb_samples) % CLOCK_DISC_SAMPLES;
+    int64_t sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (uint8_t i = 0; i < nb_samples; i++) {
+        const clock_disc_sample_t *s = samples + (oldest + i) % CLOCK_DISC_SAMPLES;
+        // relative to the oldest sample for keeping the sums small
+        int64_t x = (uint32_t)(s->t - samples[oldest].t);
+        int64_t y = s->adjust - samples[oldest].adjust;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    int64_t num = nb_samples * sxy - sx * sy;
+    int64_t den = nb_samples * sxx - sx * sx;
+    if (den <= 0) {
+        return;
+    }
+    // scale down before the conversion to ppb
+    while (num > INT64_MAX / PPB || num < -(INT64_MAX / PPB)) {
+        num /= 2;
+        den /= 2;
+    }
+    if (den == 0) {
+        return;
+    }
+    int64_t ppb = div_round(num * PPB, den);
+    if (ppb > CLOCK_DISC_MAX_DRIFT_PPM * 1000LL) {
+        ppb = CLOCK_DISC_MAX_DRIFT_PPM * 1000LL;
+    } else if (ppb < -CLOCK_DISC_MAX_DRIFT_PPM * 1000LL) {
+        ppb = -CLOCK_DISC_MAX_DRIFT_PPM * 1000LL;
+    }
+    drift_ppb = (int32_t)ppb;
+}
+
+static void add_sample(uint32_t now)
+{
+    samples[next_sample].t = now;
+    samples[next_sample].adjust = adjust;
+    next_sample = (next_sample + 1) % CLOCK_DISC_SAMPLES;
+    if (nb_samples < CLOCK_DISC_SAMPLES) {
+        nb_samples++;
+    }
+}
+
+static void reset(void)
+{
+    nb_samples = 0;
+    next_sample = 0;
+    adjust = 0;
+    drift_ppb = 0;
+    compensated = 0;
+    interval_sec = CLOCK_DISC_MIN_INTERVAL_SEC;
+}
+
+bool clock_disc_sync_due(uint32_t now)
+{
+    mutex_lock(&clock_disc_mutex);
+    bool due = !req_sent || (uint32_t)(now - last_req) >= next_interval_sec;
+    mutex_unlock(&clock_disc_mutex);
+    return due;
+}
+
+void clock_disc_req_sent(uint32_t now)
+{
+    mutex_lock(&clock_disc_mutex);
+    req_sent = true;
+    last_req = now;
+    if (period_defined) {
+        // the randomization varies with each transmission
+        next_interval_sec = period_sec - CLOCK_DISC_PERIOD_JITTER_SEC
+                            + random_uint32_range(0, 2 * CLOCK_DISC_PERIOD_JITTER_SEC + 1);
+    } else {
+        next_interval_sec = interval_sec;
+    }
+    mutex_unlock(&clock_disc_mutex);
+}
+
+void clock_disc_correction(uint32_t now, int32_t correction)
+{
+    mutex_lock(&clock_disc_mutex);
+    if (correction > CLOCK_DISC_MAX_CORRECTION_SEC || correction < -CLOCK_DISC_MAX_CORRECTION_SEC) {
+        // the clock is set: the previous samples are meaningless
+        DEBUG("[clock] correction=%ld sec: clock set\n", (long)correction);
+        reset();
+    } else {
+        adjust += correction;
+        if (nb_samples >= CLOCK_DISC_MIN_SAMPLES - 1) {
+            if (correction <= CLOCK_DISC_TOLERANCE_SEC && correction >= -CLOCK_DISC_TOLERANCE_SEC) {
+                interval_sec = (interval_sec < CLOCK_DISC_MAX_INTERVAL_SEC / 2) ? 2 * interval_sec
+                                                                                : CLOCK_DISC_MAX_INTERVAL_SEC;
+            } else if (interval_sec / 2 >= CLOCK_DISC_MIN_INTERVAL_SEC) {
+                interval_sec /= 2;
+            } else {
+                interval_sec = CLOCK_DISC_MIN_INTERVAL_SEC;
+            }
+        }
+    }
+    add_sample(now);
+    if (nb_samples >= CLOCK_DISC_MIN_SAMPLES) {
+        fit_drift();
+    }
+    t_ref = now;
+    compensated = 0;
+    if (!period_defined) {
+        next_interval_sec = interval_sec;
+    }
+    DEBUG("[clock] correction=%ld sec samples=%d drift=%ld ppb interval=%lu sec\n",
+          (long)correction, nb_samples, (long)drift_ppb, (unsigned long)interval_sec);
+    mutex_unlock(&clock_disc_mutex);
+}
+
+void clock_disc_reset(void)
+{
+    mutex_lock(&clock_disc_mutex);
+    reset();
+    mutex_unlock(&clock_disc_mutex);
+}
+
+int32_t clock_disc_compensation(uint32_t now)
+{
+    mutex_lock(&clock_disc_mutex);
+    int32_t step = 0;
+    if (nb_samples >= CLOCK_DISC_MIN_SAMPLES) {
+        int64_t elapsed = (uint32_t)(now - t_ref);
+        int32_t predicted = (int32_t)div_round(elapsed * drift_ppb, PPB);
+        step = predicted - compensated;
+        compensated += step;
+        adjust += step;
+    }
+    mutex_unlock(&clock_disc_mutex);
+    if (step != 0) {
+        DEBUG("[clock] drift compensation: %ld sec\n", (long)step);
+    }
+    return step;
+}
+
+void clock_disc_set_period(uint8_t period)
+{
+    mutex_lock(&clock_disc_mutex);
+    period_defined = true;
+    period_sec = CLOCK_DISC_PERIOD_BASE_SEC << (period & 0x0F);
+    next_interval_sec = period_sec;
+    mutex_unlock(&clock_disc_mutex);
+    DEBUG("[clock] periodicity set to %lu sec\n", (unsigned long)period_sec);
+}
+
+void clock_disc_print(uint32_t now)
+{
+    mutex_lock(&clock_disc_mutex);
+    printf("[clock] samples=%d drift=%ld ppb compensated=%ld sec interval=%lu sec (%s)",
+           nb_samples, (long)drift_ppb, (long)compensated,
+           (unsigned long)(period_defined ? period_sec : interval_sec),
+           period_defined ? "set by the server" : "adaptive");
+    if (req_sent) {
+        printf(" last AppTimeReq %lu sec ago\n", (unsigned long)(uint32_t)(now - last_req));
+    } else {
+        printf(" no AppTimeReq sent\n");
+    }
+    mutex_unlock(&clock_disc_mutex);
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Discipline of the RTC: drift estimation and periodicity of the clock synchronization.
+ *
+ * Each AppTimeAns gives a sample <local time, sum of the corrections applied to the RTC>.
+ * The drift of the RTC (in ppb) is the slope of the least-squares line of the last
+ * CLOCK_DISC_SAMPLES samples. Between two synchronizations, the RTC is stepped by one second
+ * each time the drift predicted since the last synchronization reaches one more second.
+ *
+ * The interval between two AppTimeReq starts at CLOCK_DISC_MIN_INTERVAL_SEC and is doubled
+ * (up to CLOCK_DISC_MAX_INTERVAL_SEC) after each correction within CLOCK_DISC_TOLERANCE_SEC
+ * once CLOCK_DISC_MIN_SAMPLES samples are fitted. It is halved after a larger correction.
+ * When the application server sets the Period (DeviceAppTimePeriodicityReq), the interval is
+ * 128*2^Period seconds ±30 seconds.
+ *
+ * The local time is the uptime in seconds (ZTIMER_SEC): it is never corrected.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef CLOCK_DISC_H
+#define CLOCK_DISC_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Number of samples of the least-squares fit
+ */
+#ifndef CLOCK_DISC_SAMPLES
+#define CLOCK_DISC_SAMPLES              (8U)
+#endif
+
+/*
+ * Min number of samples before the drift compensation and the lengthening of the interval
+ */
+#ifndef CLOCK_DISC_MIN_SAMPLES
+#define CLOCK_DISC_MIN_SAMPLES          (3U)
+#endif
+
+/*
+ * Max error (in seconds) of a correction for a well-behaved clock
+ */
+#ifndef CLOCK_DISC_TOLERANCE_SEC
+#define CLOCK_DISC_TOLERANCE_SEC        (1)
+#endif
+
+/*
+ * Min interval (in seconds) between two AppTimeReq (1 hour)
+ */
+#ifndef CLOCK_DISC_MIN_INTERVAL_SEC
+#define CLOCK_DISC_MIN_INTERVAL_SEC     (3600UL)
+#endif
+
+/*
+ * Max interval (in seconds) between two AppTimeReq (2 days)
+ */
+#ifndef CLOCK_DISC_MAX_INTERVAL_SEC
+#define CLOCK_DISC_MAX_INTERVAL_SEC     (2UL * 24UL * 3600UL)
+#endif
+
+/*
+ * Corrections larger than this (in seconds) set the clock: the samples are cleared
+ */
+#ifndef CLOCK_DISC_MAX_CORRECTION_SEC
+#define CLOCK_DISC_MAX_CORRECTION_SEC   (60)
+#endif
+
+/*
+ * Max drift (in ppm) of the RTC: larger estimations are clipped
+ */
+#ifndef CLOCK_DISC_MAX_DRIFT_PPM
+#define CLOCK_DISC_MAX_DRIFT_PPM        (200)
+#endif
+
+/**
+ * Check if an AppTimeReq is due
+ *
+ * @param now   the local time in seconds
+ *
+ * @return true if an AppTimeReq has to be sent
+ */
+bool clock_disc_sync_due(uint32_t now);
+
+/**
+ * Register an AppTimeReq sent at the local time now
+ *
+ * @param now   the local time in seconds
+ */
+void clock_disc_req_sent(uint32_t now);
+
+/**
+ * Register the correction of an AppTimeAns (already applied to the RTC): update the drift
+ * estimation and the interval
+ *
+ * @param now           the local time in seconds
+ * @param correction    the correction in seconds
+ */
+void clock_disc_correction(uint32_t now, int32_t correction);
+
+/**
+ * Clear the samples (the RTC has been set)
+ */
+void clock_disc_reset(void);
+
+/**
+ * Get the step to apply to the RTC for compensating the drift since the last correction
+ *
+ * @param now   the local time in seconds
+ *
+ * @return the step in seconds (0 if none)
+ */
+int32_t clock_disc_compensation(uint32_t now);
+
+/**
+ * Set the periodicity of the AppTimeReq given by a DeviceAppTimePeriodicityReq
+ *
+ * @param period    the periodicity is 128*2^period seconds
+ */
+void clock_disc_set_period(uint8_t period);
+
+/**
+ * Print the state of the discipline
+ *
+ * @param now   the local time in seconds
+ */
+void clock_disc_print(uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
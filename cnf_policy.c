@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Policy of the confirmed uplinks.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include "cnf_policy.h"
+#include "config.h"
+#include "liveness.h"
+#include "stats.h"
+#include "tx_slot.h"
+#include "loramac_dutycycle.h"
+#include "loramac_utils.h"
+#include "session.h"
+#include "wdt_ztimer.h"
+#if APP_CLOCK_SYNC == 1
+#include "app_clock.h"
+#endif
+
+static uint32_t cnt_frames = 0;
+static uint16_t fallback_frames = 0;
+
+static uint32_t cnt_cnf_frames = 0;
+static uint32_t cnt_cnf_acked = 0;
+static uint32_t cnt_cnf_failed = 0;
+static uint32_t cnt_retries = 0;
+
+static bool is_confirmed(bool alarm)
+{
+    cnt_frames++;
+    if (alarm) {
+        return true;
+    }
+    if (fallback_frames > 0) {
+        fallback_frames--;
+        return false;
+    }
+    if (config.txcnf) {
+        return true;
+    }
+    return config.cnf_every_n != 0 && (cnt_frames % config.cnf_every_n) == 0;
+}
+
+uint8_t cnf_policy_send(semtech_loramac_t *loramac, uint8_t port, uint8_t *payload, uint8_t len,
+        bool alarm, ztimer_now_t *tx_start)
+{
+    bool confirmed = is_confirmed(alarm);
+    uint8_t attempts = confirmed ? 1 + config.cnf_max_retries : 1;
+    ztimer_now_t deadline = ztimer_now(ZTIMER_MSEC) + config.cnf_deadline_sec * 1000;
+    uint8_t ret = SEMTECH_LORAMAC_TX_ERROR;
+
+    semtech_loramac_set_tx_mode(loramac, confirmed ? LORAMAC_TX_CNF : LORAMAC_TX_UNCNF);
+    semtech_loramac_set_tx_port(loramac, port);
+    if (confirmed) {
+        cnt_cnf_frames++;
+    }
+
+    for (uint8_t attempt = 0; attempt < attempts; attempt++) {
+        if (attempt > 0) {
+            // wait for the duty-cycle budget before the retry
+            ztimer_now_t now = ztimer_now(ZTIMER_MSEC);
+            uint32_t delay = loramac_dutycycle_next_tx_delay(*tx_start, 0, now);
+            if ((int32_t)(deadline - (now + delay)) <= 0) {
+                DEBUG("[cnf] deadline reached after %d attempts\n", attempt);
+                break;
+            }
+            DEBUG("[cnf] retry %d in %ld msec\n", attempt, delay);
+            // the sender is not monitored during the wait
+            liveness_idle(LIVENESS_TASK_SENDER);
+            wdt_ztimer_sleep(ZTIMER_MSEC, delay);
+            liveness_busy(LIVENESS_TASK_SENDER);
+            cnt_retries++;
+        }
+
+#if APP_CLOCK_SYNC == 1
+        // the times of the clock sync trailer are captured before each attempt
+        app_clock_restamp_trailer();
+#endif
+        uint8_t dr = semtech_loramac_get_dr(loramac);
+        *tx_start = ztimer_now(ZTIMER_MSEC);
+        stats_tx_start(dr, len);
+        if (confirmed) {
+            // the MAC retransmits the frame (after the duty-cycle waits) before returning:
+            // the duration of the call is bounded by the liveness monitor and the WDT is kicked meanwhile
+            liveness_busy_for(LIVENESS_TASK_SENDER, LIVENESS_SENDER_MAX_CNF_SEND_MS);
+            wdt_ztimer_blocking_begin();
+        } else {
+            liveness_busy(LIVENESS_TASK_SENDER);
+        }
+        session_before_uplink(loramac);
+        ret = semtech_loramac_send(loramac, payload, len);
+        wdt_ztimer_blocking_end();
+        liveness_busy(LIVENESS_TASK_SENDER);
+        wdt_ztimer_kick();
+        stats_tx_end(ret);
+        if (ret == SEMTECH_LORAMAC_TX_DONE || ret == SEMTECH_LORAMAC_TX_CNF_FAILED) {
+            loramac_dutycycle_register_tx(dr, len, *tx_start);
+        }
+        // each attempt advances the FCntUp: the reservation of the saved session is refreshed
+        if (!session_after_uplink(loramac, ret)) {
+            break;
+        }
+        if (ret == SEMTECH_LORAMAC_TX_DONE) {
+            break;
+        }
+        if (ret != SEMTECH_LORAMAC_TX_CNF_FAILED) {
+            // not transmitted (duty-cycle restricted, busy MAC, ...): no time on air is registered,
+            // so a retry would not wait and would be rejected again
+            DEBUG("[cnf] attempt %d not transmitted: ret code: %d (%s)\n", attempt, ret,
+                  loramac_utils_err_message(ret));
+            break;
+        }
+        DEBUG("[cnf] attempt %d failed: ret code: %d (%s)\n", attempt, ret, loramac_utils_err_message(ret));
+    }
+
+    if (confirmed) {
+        if (ret == SEMTECH_LORAMAC_TX_DONE) {
+            cnt_cnf_acked++;
+            tx_slot_delivered();
+        } else {
+            cnt_cnf_failed++;
+            // a missing ACK is the only collision indicator available
+            if (ret == SEMTECH_LORAMAC_TX_CNF_FAILED) {
+                tx_slot_collision();
+            }
+            fallback_frames = CNF_FALLBACK_FRAMES;
+            DEBUG("[cnf] no ACK: fall back to unconfirmed for %d frames\n", fallback_frames);
+        }
+    }
+    return ret;
+}
+
+void cnf_policy_print(void)
+{
+    DEBUG("[cnf] frames=%ld confirmed=%ld acked=%ld failed=%ld retries=%ld\n",
+            cnt_frames, cnt_cnf_frames, cnt_cnf_acked, cnt_cnf_failed, cnt_retries);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Policy of the confirmed uplinks.
+ *
+ * A frame is sent as confirmed when TXCNF is set, every CNF_EVERY_N frames (for checking the link)
+ * or when it is an alarm frame. A confirmed frame is retransmitted at most CNF_MAX_RETRIES times
+ * before CNF_DEADLINE_SEC, each retry waiting for the duty-cycle budget. A frame which is not
+ * transmitted (duty-cycle restricted or busy MAC) is not retried. When the budget is exhausted,
+ * the frames fall back to unconfirmed (except the alarm frames) during CNF_FALLBACK_FRAMES frames.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef CNF_POLICY_H
+#define CNF_POLICY_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "net/loramac.h"
+#include "semtech_loramac.h"
+#include "ztimer.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Number of unconfirmed frames sent after a failure of a confirmed frame
+ */
+#ifndef CNF_FALLBACK_FRAMES
+#define CNF_FALLBACK_FRAMES                 (10U)
+#endif
+
+/**
+ * Send a frame according to the policy of the confirmed uplinks
+ *
+ * @param loramac   the loramac descriptor
+ * @param port      the port of the frame
+ * @param payload   the payload
+ * @param len       the length of the payload
+ * @param alarm     true if the frame should be delivered (always confirmed)
+ * @param tx_start  the start time (ZTIMER_MSEC) of the last transmission
+ *
+ * @return the return code of the last semtech_loramac_send call
+ */
+uint8_t cnf_policy_send(semtech_loramac_t *loramac, uint8_t port, uint8_t *payload, uint8_t len,
+        bool alarm, ztimer_now_t *tx_start);
+
+/**
+ * Print the statistics of the confirmed uplinks
+ */
+void cnf_policy_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
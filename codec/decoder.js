@@ -9,6 +9,10 @@
 
 Usage:
 
+The blocks of the data message depend on the sensors of the endpoint: the device variable
+'sensors' is the mask of the sensors (BMX280 0x01, BME280 humidity 0x02, PMS7003 0x04,
+DS75LX 0x08, AT30TSE75X 0x10, GPS 0x20) and defaults to BME280 + PMS7003 (0x07).
+
 var payload = Buffer.from("AHAJAScsEgAAAAAAAAAAAAAAALQAOAACAAIAAAA=","base64");
 console.log(Decode(101,payload,null));
 
@@ -49,68 +53,240 @@ function readInt16LE (buf, offset) {
 }
 
 
-// TODO: Decode App Sync Clock message
-function Decode202(bytes, variables, object) {
-    return object;
+function toHex(bytes) {
+    var s = "";
+    for (var i = 0; i < bytes.length; i++) {
+        s += ("0" + (bytes[i] & 0xFF).toString(16)).slice(-2);
+    }
+    return s;
+}
+
+// Decode the uplink commands of the App Clock Sync package (port 202 or trailer of the data message)
+function Decode202(bytes, variables, o) {
+    var i = 0;
+    while (i < bytes.length) {
+        var cid = bytes[i++];
+        if (cid === 0x00 && i + 2 <= bytes.length) {
+            // PackageVersionAns
+            o['package_identifier'] = bytes[i];
+            o['package_version'] = bytes[i + 1];
+            i += 2;
+        } else if (cid === 0x01 && i + 5 <= bytes.length) {
+            // AppTimeReq
+            o['device_time'] = (readUInt16LE(bytes, i) + readUInt16LE(bytes, i + 2) * 65536); // in sec since the GPS epoch
+            o['token_req'] = bytes[i + 4] & 0x0F;
+            o['ans_required'] = (bytes[i + 4] & 0x10) !== 0;
+            i += 5;
+        } else if (cid === 0x02 && i + 5 <= bytes.length) {
+            // DeviceAppTimePeriodicityAns
+            o['periodicity_not_supported'] = (bytes[i] & 0x01) !== 0;
+            o['device_time'] = (readUInt16LE(bytes, i + 1) + readUInt16LE(bytes, i + 3) * 65536); // in sec since the GPS epoch
+            i += 5;
+        } else {
+            o['_errors'] = ["bad clock sync command " + cid];
+            break;
+        }
+    }
+    return o;
+}
+
+
+// Decode the diagnostics message
+function Decode103(bytes, variables, o) {
+
+    var RET_CODES = ["tx_done", "tx_cnf_failed", "dutycycle_restricted", "busy", "not_joined", "other"];
+    // upper bounds of the buckets of the send durations (in msec)
+    var BUCKETS = [1000, 2000, 3000, 4000, 6000, 8000, 16000, null];
+
+    var version = bytes[0];
+    if (bytes.length < 26 || (version !== 1 && version !== 2)) {
+        return { _errors: ["bad diagnostics message"] };
+    }
+
+    var i = 1;
+    for (var r = 0; r < RET_CODES.length; r++) {
+        o[RET_CODES[r]] = readUInt16LE(bytes, i);
+        i += 2;
+    }
+    o['rx1'] = readUInt16LE(bytes, i);
+    i += 2;
+    o['rx2'] = readUInt16LE(bytes, i);
+    i += 2;
+    o['rx_other'] = readUInt16LE(bytes, i);
+    i += 2;
+    o['link_checks'] = readUInt16LE(bytes, i);
+    i += 2;
+    o['margin_min'] = bytes[i++]; // in dB
+    o['margin_avg'] = bytes[i++]; // in dB
+    o['margin_max'] = bytes[i++]; // in dB
+    o['gateways_max'] = bytes[i++];
+    if (version >= 2) {
+        o['class_c_minutes'] = readUInt16LE(bytes, i);
+        i += 2;
+    }
+
+    var nb = bytes[i++];
+    o['send_duration'] = [];
+    for (var d = 0; d < nb && i + 4 <= bytes.length; d++) {
+        o['send_duration'].push({
+            dr: bytes[i],
+            count: readUInt16LE(bytes, i + 1),
+            median_max_ms: BUCKETS[bytes[i + 3] >> 4],
+            p90_max_ms: BUCKETS[bytes[i + 3] & 0x0F]
+        });
+        i += 4;
+    }
+    return o;
 }
 
 
-// TODO: Decode Data message
+// BEGIN DecodeData
+// Generated by tools/codec/gen_codec.py from tools/codec/payload.json: do not edit
+
+function readInt16BE (buf, offset) {
+    offset = offset >>> 0;
+    var val = (buf[offset] << 8) | buf[offset + 1];
+    return (val & 0x8000) ? val | 0xFFFF0000 : val;
+}
+
+function readInt24BE (buf, offset) {
+    offset = offset >>> 0;
+    return ((buf[offset] << 24) | (buf[offset + 1] << 16) | (buf[offset + 2] << 8)) >> 8;
+}
+
+var DATA_SENSORS_DEFAULT = 0x07;
+
+// Decode the data message (the sensors of the endpoint are given by the device variable 'sensors')
 function DecodeData(bytes, variables, o) {
 
+    var sensors = DATA_SENSORS_DEFAULT;
+    if (variables && variables.sensors !== undefined) {
+        sensors = parseInt(variables.sensors);
+    }
     var size = bytes.length;
+    if (size < 1) {
+        return { _errors: ["data too short"] };
+    }
 
-    if (size >= 1) {
+    var flags = bytes[0];
+    var i = 1;
 
-        var flags = bytes[0];
-        var i = 1;
+    if ((flags & 0x80) !== 0) {
+        // clock sync trailer: <commands><length of the commands>
+        var n = bytes[size - 1];
+        if (n + 2 > size) {
+            return { _errors: ["bad clock sync trailer"] };
+        }
+        var trailer = bytes.slice(size - 1 - n, size - 1);
+        o['clock_sync_payload'] = toHex(trailer);
+        Decode202(trailer, variables, o);
+        size -= n + 1;
+    }
 
-        if(((flags & 0x01) === 0) && (size >= i + 6)) {
-            o['temperature'] = readInt16LE(bytes, i) / 100.0; // in °C
-            i += 2;
-            o['pressure'] = readUInt16LE(bytes, i) / 10.0; // in hPa
-            i += 2;
+    if ((flags & 0x01) !== 0) {
+        o['bmx280_error'] = true;
+    }
+    if ((flags & 0x02) !== 0) {
+        o['pms7003_error'] = true;
+    }
+    if ((flags & 0x04) !== 0) {
+        o['gps_error'] = true;
+    }
+    if ((flags & 0x08) !== 0) {
+        o['ds75lx_error'] = true;
+    }
+    if ((flags & 0x10) !== 0) {
+        o['at30tse75x_error'] = true;
+    }
+
+    if ((sensors & 0x01) !== 0 && (flags & 0x01) === 0) {
+        if (size < i + 4 + ((sensors & 0x02) !== 0 ? 2 : 0)) {
+            return { _errors: ["bmx280 too short"] };
+        }
+        o['temperature'] = readInt16LE(bytes, i) / 100.0; // in °C
+        i += 2;
+        o['pressure'] = readUInt16LE(bytes, i) / 10.0; // in hPa
+        i += 2;
+        if ((sensors & 0x02) !== 0) {
             o['humidity'] = readUInt16LE(bytes, i) / 100.0; // in %
             i += 2;
-        } else {
-            o['bmx280_error'] = true;
         }
+    }
 
-        if(((flags & 0x01) === 0) && (size >= i + 22)) {
-            o['pm1_0Standard'] = readUInt16LE(bytes, i); // in ug/m3
-            i += 2;
-            o['pm2_5Standard'] = readUInt16LE(bytes, i); // in ug/m3
-            i += 2;
-            o['pm10Standard'] = readUInt16LE(bytes, i); // in ug/m3
-            i += 2;
-            
-            o['pm1_0Atmospheric'] = readUInt16LE(bytes, i); // in ug/m3
-            i += 2;
-            o['pm2_5Atmospheric'] = readUInt16LE(bytes, i); // in ug/m3
-            i += 2;
-            o['pm10Atmospheric'] = readUInt16LE(bytes, i); // in ug/m3
-            i += 2;
+    if ((sensors & 0x04) !== 0 && (flags & 0x02) === 0) {
+        if (size < i + 22) {
+            return { _errors: ["pms7003 too short"] };
+        }
+        o['pm1_0Standard'] = readUInt16LE(bytes, i); // in ug/m3
+        i += 2;
+        o['pm2_5Standard'] = readUInt16LE(bytes, i); // in ug/m3
+        i += 2;
+        o['pm10Standard'] = readUInt16LE(bytes, i); // in ug/m3
+        i += 2;
+        o['pm1_0Atmospheric'] = readUInt16LE(bytes, i); // in ug/m3
+        i += 2;
+        o['pm2_5Atmospheric'] = readUInt16LE(bytes, i); // in ug/m3
+        i += 2;
+        o['pm10Atmospheric'] = readUInt16LE(bytes, i); // in ug/m3
+        i += 2;
+        o['particuleGT0_3'] = readUInt16LE(bytes, i); // in 1/0.1L
+        i += 2;
+        o['particuleGT0_5'] = readUInt16LE(bytes, i); // in 1/0.1L
+        i += 2;
+        o['particuleGT1_0'] = readUInt16LE(bytes, i); // in 1/0.1L
+        i += 2;
+        o['particuleGT2_5'] = readUInt16LE(bytes, i); // in 1/0.1L
+        i += 2;
+        o['particuleGT10'] = readUInt16LE(bytes, i); // in 1/0.1L
+        i += 2;
+    }
 
-            o['particuleGT0_3'] = readUInt16LE(bytes, i); // in ug/m3
-            i += 2;
-            o['particuleGT0_5'] = readUInt16LE(bytes, i); // in ug/m3
-            i += 2;
-            o['particuleGT1_0'] = readUInt16LE(bytes, i); // in ug/m3
-            i += 2;
-            o['particuleGT2_5'] = readUInt16LE(bytes, i); // in ug/m3
-            i += 2;
-            o['particuleGT2_5'] = readUInt16LE(bytes, i); // in ug/m3
-            i += 2;
-            o['particuleGT10'] = readUInt16LE(bytes, i); // in ug/m3
-            i += 2;            
-        } else {
-            o['pms7003_error'] = true;
+    if ((sensors & 0x08) !== 0 && (flags & 0x08) === 0) {
+        if (size < i + 2) {
+            return { _errors: ["ds75lx too short"] };
         }
-        return o;
-    } else {
-        return { _errors: ["data too short"] };
-    }    
+        o['ds75lx_temperature'] = readInt16BE(bytes, i) / 100.0; // in °C
+        i += 2;
+    }
+
+    if ((sensors & 0x10) !== 0 && (flags & 0x10) === 0) {
+        if (size < i + 2) {
+            return { _errors: ["at30tse75x too short"] };
+        }
+        o['at30tse75x_temperature'] = readInt16BE(bytes, i) / 100.0; // in °C
+        i += 2;
+    }
+
+    if ((flags & 0x40) !== 0) {
+        if (size < i + 8) {
+            return { _errors: ["position too short"] };
+        }
+        o['latitude'] = readInt24BE(bytes, i) * 90 / (readInt24BE(bytes, i) < 0 ? 8388608 : 8388607); // in °
+        i += 3;
+        o['longitude'] = readInt24BE(bytes, i) * 180 / (readInt24BE(bytes, i) < 0 ? 8388608 : 8388607); // in °
+        i += 3;
+        o['altitude'] = readInt16BE(bytes, i); // in m
+        i += 2;
+    }
+
+    if (i < size && (flags & 0x80) === 0) {
+        // zero padding of the frames of a survey (DRPWSZ_SEQUENCE)
+        var k = i;
+        while (k < size && bytes[k] === 0) {
+            k++;
+        }
+        if (k === size) {
+            o['padding_len'] = size - i;
+            i = size;
+        }
+    }
+
+    if (i !== size) {
+        return { _errors: ["bad length for the sensors 0x" + sensors.toString(16)] };
+    }
+    return o;
 }
+// END DecodeData
 
 
 // Chirpstack
@@ -123,6 +299,7 @@ function Decode(fPort, bytes, variables) {
 
     var DATA_PORT = 101; // const
     var APPSYNCCLOCK_PORT = 202; // const
+    var DIAGNOSTICS_PORT = 103; // const
 
     var o = {_tags:variables}; // tags can be used in InfluxDB / Grafana to filter data
 
@@ -130,6 +307,8 @@ function Decode(fPort, bytes, variables) {
         return DecodeData(bytes, variables, o);
     } if(fPort === APPSYNCCLOCK_PORT) {
         return Decode202(bytes, variables, o)
+    } else if(fPort === DIAGNOSTICS_PORT) {
+        return Decode103(bytes, variables, o)
     } else {
         o._errors = ["unknown port " + fPort];
         return o;
@@ -149,7 +328,7 @@ function decodeUplink(input) {
     if(decoded._errors) {
         output.errors = decoded._errors;  // Mandatory when failed
     } else {
-        output.data = Decode(input.fPort, input.bytes, variables); // Mandatory when successful.
+        output.data = decoded; // Mandatory when successful.
     }
     if(output._warnings) {
         output.warnings = decoded._warnings; // Optional
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Runtime configuration of the endpoint.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include <string.h>
+
+#include "config.h"
+#include "persist.h"
+
+#ifndef VALID_DATA_AFTER_WAKEUP_SEC
+#define VALID_DATA_AFTER_WAKEUP_SEC                 (30U)
+#endif
+
+#ifndef CNF_EVERY_N
+#define CNF_EVERY_N                                 (0U)
+#endif
+
+#ifndef CNF_MAX_RETRIES
+#define CNF_MAX_RETRIES                             (2U)
+#endif
+
+#ifndef CNF_DEADLINE_SEC
+#define CNF_DEADLINE_SEC                            (600U)
+#endif
+
+#ifndef STATS_PERIOD
+#define STATS_PERIOD                                (100U)
+#endif
+
+#ifndef GPS_MOVE_THRESHOLD_M
+#define GPS_MOVE_THRESHOLD_M                        (50U)
+#endif
+
+#ifndef GPS_REFRESH_FRAMES
+#define GPS_REFRESH_FRAMES                          (24U)
+#endif
+
+#define NELEMS(x)  (sizeof(x) / sizeof((x)[0]))
+
+// Max size of the saved configuration: (id + len + value) for each parameter
+#define CONFIG_TLV_MAX_SIZE                         (NELEMS(config_params) * (2 + sizeof(uint32_t)))
+
+typedef enum {
+    CONFIG_TYPE_BOOL,
+    CONFIG_TYPE_U8,
+    CONFIG_TYPE_U16,
+    CONFIG_TYPE_U32,
+} config_type_t;
+
+typedef struct {
+    uint8_t id;
+    const char *name;
+    config_type_t type;
+    uint32_t min;
+    uint32_t max;
+    uint32_t def;
+    size_t offset;
+} config_param_t;
+
+static const config_param_t config_params[] = {
+        { CONFIG_ID_TXPERIOD_AT_DR0, "TXPERIOD_AT_DR0", CONFIG_TYPE_U16, 32, UINT16_MAX, TXPERIOD_AT_DR0, offsetof(config_t, txperiod_at_dr0) },
+        { CONFIG_ID_TXCNF, "TXCNF", CONFIG_TYPE_BOOL, 0, 1, TXCNF, offsetof(config_t, txcnf) },
+        { CONFIG_ID_ADR_ON, "ADR_ON", CONFIG_TYPE_BOOL, 0, 1, ADR_ON, offsetof(config_t, adr_on) },
+        { CONFIG_ID_APP_TIME_REQ_PERIOD, "APP_TIME_REQ_PERIOD", CONFIG_TYPE_U16, 1, 10000, APP_TIME_REQ_PERIOD, offsetof(config_t, app_time_req_period) },
+        { CONFIG_ID_VALID_DATA_AFTER_WAKEUP_SEC, "VALID_DATA_AFTER_WAKEUP_SEC", CONFIG_TYPE_U16, 10, 300, VALID_DATA_AFTER_WAKEUP_SEC, offsetof(config_t, valid_data_after_wakeup_sec) },
+        { CONFIG_ID_CNF_EVERY_N, "CNF_EVERY_N", CONFIG_TYPE_U16, 0, 10000, CNF_EVERY_N, offsetof(config_t, cnf_every_n) },
+        { CONFIG_ID_CNF_MAX_RETRIES, "CNF_MAX_RETRIES", CONFIG_TYPE_U8, 0, 15, CNF_MAX_RETRIES, offsetof(config_t, cnf_max_retries) },
+        { CONFIG_ID_CNF_DEADLINE_SEC, "CNF_DEADLINE_SEC", CONFIG_TYPE_U16, 10, 3600, CNF_DEADLINE_SEC, offsetof(config_t, cnf_deadline_sec) },
+        { CONFIG_ID_STATS_PERIOD, "STATS_PERIOD", CONFIG_TYPE_U16, 0, 10000, STATS_PERIOD, offsetof(config_t, stats_period) },
+        { CONFIG_ID_GPS_MOVE_THRESHOLD_M, "GPS_MOVE_THRESHOLD_M", CONFIG_TYPE_U16, 1, 10000, GPS_MOVE_THRESHOLD_M, offsetof(config_t, gps_move_threshold_m) },
+        { CONFIG_ID_GPS_REFRESH_FRAMES, "GPS_REFRESH_FRAMES", CONFIG_TYPE_U16, 1, 10000, GPS_REFRESH_FRAMES, offsetof(config_t, gps_refresh_frames) },
+};
+
+config_t config;
+
+// max size of a downlink payload
+#define CONFIG_STAGED_MAX_SIZE                      (242U)
+
+static uint8_t staged_tlv[CONFIG_STAGED_MAX_SIZE];
+static size_t staged_len = 0;
+
+static uint8_t type_size(config_type_t type)
+{
+    switch (type) {
+        case CONFIG_TYPE_BOOL:
+        case CONFIG_TYPE_U8:
+            return sizeof(uint8_t);
+        case CONFIG_TYPE_U16:
+            return sizeof(uint16_t);
+        default:
+            return sizeof(uint32_t);
+    }
+}
+
+static const config_param_t *find_param(uint8_t id)
+{
+    for (unsigned int i = 0; i < NELEMS(config_params); i++) {
+        if (config_params[i].id == id) {
+            return config_params + i;
+        }
+    }
+    return NULL;
+}
+
+static uint32_t get_value(const config_param_t *p)
+{
+    const uint8_t *field = (const uint8_t *)&config + p->offset;
+    switch (p->type) {
+        case CONFIG_TYPE_BOOL:
+            return *(const bool *)field;
+        case CONFIG_TYPE_U8:
+            return *field;
+        case CONFIG_TYPE_U16:
+            return *(const uint16_t *)field;
+        default:
+            return *(const uint32_t *)field;
+    }
+}
+
+static void set_value(const config_param_t *p, uint32_t value)
+{
+    uint8_t *field = (uint8_t *)&config + p->offset;
+    switch (p->type) {
+        case CONFIG_TYPE_BOOL:
+            *(bool *)field = (value != 0);
+            break;
+        case CONFIG_TYPE_U8:
+            *field = value;
+            break;
+        case CONFIG_TYPE_U16:
+            *(uint16_t *)field = value;
+            break;
+        default:
+            *(uint32_t *)field = value;
+            break;
+    }
+}
+
+/*
+ * Check (if apply is false) or apply (if apply is true) a batch of TLV
+ */
+static int8_t process_tlv(const uint8_t *buf, size_t len, bool apply)
+{
+    size_t idx = 0;
+    while (idx < len) {
+        if (idx + 2 > len) {
+            return CONFIG_ERROR_BAD_LENGTH;
+        }
+        uint8_t id = buf[idx];
+        uint8_t vlen = buf[idx + 1];
+        const config_param_t *p = find_param(id);
+        if (p == NULL) {
+            DEBUG("[config] unknown id=%d\n", id);
+            return CONFIG_ERROR_UNKNOWN_ID;
+        }
+        if (vlen != type_size(p->type) || idx + 2 + vlen > len) {
+            DEBUG("[config] bad length for %s\n", p->name);
+            return CONFIG_ERROR_BAD_LENGTH;
+        }
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < vlen; i++) {
+            value |= (uint32_t)buf[idx + 2 + i] << (8 * i);
+        }
+        if (value < p->min || value > p->max) {
+            DEBUG("[config] %s=%ld out of range [%ld,%ld]\n", p->name, value, p->min, p->max);
+            return CONFIG_ERROR_OUT_OF_RANGE;
+        }
+        if (apply) {
+            DEBUG("[config] %s=%ld\n", p->name, value);
+            set_value(p, value);
+        }
+        idx += 2 + vlen;
+    }
+    return CONFIG_OK;
+}
+
+void config_init(void)
+{
+    for (unsigned int i = 0; i < NELEMS(config_params); i++) {
+        set_value(config_params + i, config_params[i].def);
+    }
+
+    uint8_t buf[CONFIG_TLV_MAX_SIZE];
+    int len = persist_read(PERSIST_ID_CONFIG, buf, sizeof(buf));
+    if (len > 0 && process_tlv(buf, len, false) == CONFIG_OK) {
+        process_tlv(buf, len, true);
+        DEBUG("[config] configuration loaded from flash\n");
+    } else {
+        DEBUG("[config] default configuration\n");
+    }
+    config_print();
+}
+
+int8_t config_set_tlv(const uint8_t *buf, size_t len)
+{
+    int8_t ret = process_tlv(buf, len, false);
+    if (ret != CONFIG_OK) {
+        return ret;
+    }
+    process_tlv(buf, len, true);
+    return config_save();
+}
+
+int8_t config_stage_tlv(const uint8_t *buf, size_t len)
+{
+    if (len > sizeof(staged_tlv)) {
+        return CONFIG_ERROR_BAD_LENGTH;
+    }
+    int8_t ret = process_tlv(buf, len, false);
+    if (ret != CONFIG_OK) {
+        return ret;
+    }
+    memcpy(staged_tlv, buf, len);
+    staged_len = len;
+    DEBUG("[config] %d bytes staged\n", len);
+    return CONFIG_OK;
+}
+
+int8_t config_apply_staged(void)
+{
+    if (staged_len == 0) {
+        return CONFIG_OK;
+    }
+    int8_t ret = config_set_tlv(staged_tlv, staged_len);
+    staged_len = 0;
+    return ret;
+}
+
+int8_t config_set(uint8_t id, uint32_t value)
+{
+    const config_param_t *p = find_param(id);
+    if (p == NULL) {
+        return CONFIG_ERROR_UNKNOWN_ID;
+    }
+    uint8_t tlv[2 + sizeof(uint32_t)];
+    tlv[0] = id;
+    tlv[1] = type_size(p->type);
+    for (uint8_t i = 0; i < tlv[1]; i++) {
+        tlv[2 + i] = (value >> (8 * i)) & 0xFF;
+    }
+    return config_set_tlv(tlv, 2 + tlv[1]);
+}
+
+int8_t config_save(void)
+{
+    // only the parameters which differ from the default values are saved
+    uint8_t buf[CONFIG_TLV_MAX_SIZE];
+    size_t len = 0;
+    for (unsigned int i = 0; i < NELEMS(config_params); i++) {
+        const config_param_t *p = config_params + i;
+        uint32_t value = get_value(p);
+        if (value != p->def) {
+            uint8_t size = type_size(p->type);
+            buf[len++] = p->id;
+            buf[len++] = size;
+            for (uint8_t j = 0; j < size; j++) {
+                buf[len++] = (value >> (8 * j)) & 0xFF;
+            }
+        }
+    }
+
+    int8_t ret = (len == 0) ? persist_erase(PERSIST_ID_CONFIG) : persist_write(PERSIST_ID_CONFIG, buf, len);
+    return (ret == PERSIST_OK) ? CONFIG_OK : CONFIG_ERROR_PERSIST;
+}
+
+void config_print(void)
+{
+    for (unsigned int i = 0; i < NELEMS(config_params); i++) {
+        const config_param_t *p = config_params + i;
+        DEBUG("[config] %02x %s=%ld (default=%ld)\n", p->id, p->name, get_value(p), p->def);
+    }
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Runtime configuration of the endpoint.
+ *
+ * The parameters are set by a downlink frame (on the port PORT_DN_CONFIG) containing a batch of TLV:
+ * <id (1 byte)><len (1 byte)><value (len bytes, little endian)>
+ * The batch is applied only if all the TLV are valid. The configuration is saved into the flash.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Identifiers of the parameters
+ */
+#define CONFIG_ID_TXPERIOD_AT_DR0                   (uint8_t)0x01
+#define CONFIG_ID_TXCNF                             (uint8_t)0x02
+#define CONFIG_ID_ADR_ON                            (uint8_t)0x03
+#define CONFIG_ID_APP_TIME_REQ_PERIOD               (uint8_t)0x04
+#define CONFIG_ID_VALID_DATA_AFTER_WAKEUP_SEC       (uint8_t)0x05
+#define CONFIG_ID_CNF_EVERY_N                       (uint8_t)0x06
+#define CONFIG_ID_CNF_MAX_RETRIES                   (uint8_t)0x07
+#define CONFIG_ID_CNF_DEADLINE_SEC                  (uint8_t)0x08
+#define CONFIG_ID_STATS_PERIOD                      (uint8_t)0x09
+#define CONFIG_ID_GPS_MOVE_THRESHOLD_M              (uint8_t)0x0A
+#define CONFIG_ID_GPS_REFRESH_FRAMES                (uint8_t)0x0B
+
+#define CONFIG_OK                                   (int8_t)0
+#define CONFIG_ERROR_UNKNOWN_ID                     (int8_t)-1
+#define CONFIG_ERROR_BAD_LENGTH                     (int8_t)-2
+#define CONFIG_ERROR_OUT_OF_RANGE                   (int8_t)-3
+#define CONFIG_ERROR_PERSIST                        (int8_t)-4     /**< applied but not saved */
+
+/**
+ * Runtime configuration
+ */
+typedef struct {
+    /*
+     * @brief TX period (in seconds) at DR0. The TX period at DRn is txperiod_at_dr0 >> n
+     */
+    uint16_t txperiod_at_dr0;
+
+    /*
+     * @brief Send confirmed uplinks
+     */
+    bool txcnf;
+
+    /*
+     * @brief Enable the ADR
+     */
+    bool adr_on;
+
+    /*
+     * @brief Send again an unanswered AppTimeReq after app_time_req_period messages
+     */
+    uint16_t app_time_req_period;
+
+    /*
+     * @brief Delay (in seconds) before the PMS7003 measurements are valid after the wakeup
+     */
+    uint16_t valid_data_after_wakeup_sec;
+
+    /*
+     * @brief Send a confirmed uplink every cnf_every_n frames for checking the link (0 for never)
+     */
+    uint16_t cnf_every_n;
+
+    /*
+     * @brief Max number of retransmissions of a confirmed uplink
+     */
+    uint8_t cnf_max_retries;
+
+    /*
+     * @brief Deadline (in seconds) for the retransmissions of a confirmed uplink
+     */
+    uint16_t cnf_deadline_sec;
+
+    /*
+     * @brief Send a diagnostics uplink every stats_period data frames (0 for never)
+     */
+    uint16_t stats_period;
+
+    /*
+     * @brief Min distance (in meters) between the reported positions
+     */
+    uint16_t gps_move_threshold_m;
+
+    /*
+     * @brief Report the position at least every gps_refresh_frames data frames
+     */
+    uint16_t gps_refresh_frames;
+} config_t;
+
+/**
+ * Current configuration
+ */
+extern config_t config;
+
+/**
+ * Load the configuration from the flash (or set the default values)
+ */
+void config_init(void);
+
+/**
+ * Apply a batch of TLV
+ *
+ * @param buf   the TLV buffer
+ * @param len   the length of the buffer
+ *
+ * @return CONFIG_OK, CONFIG_ERROR_PERSIST (the batch is applied but not saved into the flash)
+ *         or an error (the batch is not applied)
+ */
+int8_t config_set_tlv(const uint8_t *buf, size_t len);
+
+/**
+ * Check and stage a batch of TLV which will be applied later by config_apply_staged
+ *
+ * @param buf   the TLV buffer
+ * @param len   the length of the buffer
+ *
+ * @return CONFIG_OK or an error
+ */
+int8_t config_stage_tlv(const uint8_t *buf, size_t len);
+
+/**
+ * Apply the staged batch of TLV
+ *
+ * @return same as config_set_tlv
+ */
+int8_t config_apply_staged(void);
+
+/**
+ * Set one parameter
+ *
+ * @param id    the identifier of the parameter
+ * @param value the value
+ *
+ * @return CONFIG_OK or an error
+ */
+int8_t config_set(uint8_t id, uint32_t value);
+
+/**
+ * Save the configuration into the flash
+ *
+ * @return CONFIG_OK or an error
+ */
+int8_t config_save(void);
+
+/**
+ * Print the configuration
+ */
+void config_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
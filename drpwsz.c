@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Cycling of the data uplinks through a sequence of <datarate,tx power,payload size>.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifdef DRPWSZ_SEQUENCE
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include <string.h>
+
+#include "drpwsz.h"
+
+#define NELEMS(x)  (sizeof(x) / sizeof((x)[0]))
+
+static const uint8_t sequence[] = { DRPWSZ_SEQUENCE };
+
+#define DRPWSZ_NB_TRIPLETS              (NELEMS(sequence) / 3)
+
+_Static_assert(NELEMS(sequence) % 3 == 0, "DRPWSZ_SEQUENCE should contain triplets <datarate,tx power,payload size>");
+
+typedef struct {
+    uint32_t sent;
+    uint32_t done;
+    uint32_t cnf_failed;
+    uint32_t errors;
+} drpwsz_counters_t;
+
+static drpwsz_counters_t counters[DRPWSZ_NB_TRIPLETS];
+static unsigned current = 0;
+
+uint8_t drpwsz_before_uplink(semtech_loramac_t *loramac, uint8_t *payload, uint8_t len, uint8_t max_len)
+{
+    const uint8_t *t = sequence + 3 * current;
+    uint8_t dr = t[0];
+    uint8_t power = t[1];
+    uint8_t size = (t[2] > max_len) ? max_len : t[2];
+
+    if (dr == DRPWSZ_ADR) {
+        semtech_loramac_set_adr(loramac, true);
+    } else {
+        semtech_loramac_set_adr(loramac, false);
+        semtech_loramac_set_dr(loramac, dr);
+    }
+    semtech_loramac_set_tx_power(loramac, power);
+
+    if (size > len) {
+        memset(payload + len, 0, size - len);
+    }
+    DEBUG("[drpwsz] triplet %d/%d: dr=%d power=%d size=%d (payload %d)\n",
+          current, DRPWSZ_NB_TRIPLETS, dr, power, size, len);
+    return size;
+}
+
+void drpwsz_after_uplink(uint8_t ret)
+{
+    drpwsz_counters_t *c = counters + current;
+    c->sent++;
+    switch (ret) {
+        case SEMTECH_LORAMAC_TX_DONE:
+            c->done++;
+            break;
+        case SEMTECH_LORAMAC_TX_CNF_FAILED:
+            c->cnf_failed++;
+            break;
+        default:
+            c->errors++;
+            break;
+    }
+    current = (current + 1) % DRPWSZ_NB_TRIPLETS;
+    if (current == 0) {
+        // end of a cycle of the sequence
+        drpwsz_print();
+    }
+}
+
+void drpwsz_print(void)
+{
+    for (unsigned i = 0; i < DRPWSZ_NB_TRIPLETS; i++) {
+        const uint8_t *t = sequence + 3 * i;
+        printf("[drpwsz] <%d,%d,%d>: sent=%ld done=%ld cnf_failed=%ld errors=%ld\n",
+               t[0], t[1], t[2], counters[i].sent, counters[i].done, counters[i].cnf_failed, counters[i].errors);
+    }
+}
+
+#endif
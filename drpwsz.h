@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Cycling of the data uplinks through a sequence of <datarate,tx power,payload size>.
+ *
+ * The sequence DRPWSZ_SEQUENCE (defined by the Makefile) is used for the link-budget and
+ * coverage surveys: each data uplink uses the DR, the TX power (LoRaMAC TX power index,
+ * 0 for the max power) and the payload size of the next triplet of the sequence. A DR of
+ * DRPWSZ_ADR (255) enables the ADR. The payload is padded with zeros or truncated.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef DRPWSZ_H
+#define DRPWSZ_H
+
+#include <inttypes.h>
+
+#include "semtech_loramac.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * DR of a triplet for enabling the ADR
+ */
+#define DRPWSZ_ADR                      (255U)
+
+/**
+ * Apply the DR and the TX power of the current triplet and resize the payload
+ *
+ * @param loramac   the loramac descriptor
+ * @param payload   the payload (padded with zeros up to the size of the triplet)
+ * @param len       the length of the encoded payload
+ * @param max_len   the size of the payload buffer
+ *
+ * @return the length of the payload to send
+ */
+uint8_t drpwsz_before_uplink(semtech_loramac_t *loramac, uint8_t *payload, uint8_t len, uint8_t max_len);
+
+/**
+ * Count the result of the uplink for the current triplet and move to the next triplet
+ *
+ * @param ret       the return code of the send
+ */
+void drpwsz_after_uplink(uint8_t ret);
+
+/**
+ * Print the counters of the triplets
+ */
+void drpwsz_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -9,272 +9,255 @@ This file is based on LoRaMAC-node from Semtech, under Revised BSD License.
 #ifdef GPS
 
 #include "gps.h"
+#include "nmea.h"
+#include "liveness.h"
 
 #include <mutex.h>
+#include <msg.h>
+#include <thread.h>
+#include <tsrb.h>
+#include <ztimer.h>
 
 #include <string.h>
-#include <stdlib.h>
 
 
-// Various type of NMEA data we can receive with the GPS.
-static const char NmeaDataTypeGPGGA[] = "GPGGA";
-static const char NmeaDataTypeGPRMC[] = "GPRMC";
+// The UART ISR only queues the bytes into a ring buffer and wakes up the parser thread at
+// the end of each line: the sentences (GGA, RMC, GSA, VTG and ZDA from any talker) are
+// parsed one byte at a time in the context of the thread.
 // TODO process messages GPGLL : Latitude, longitude, UTC time of position fix and status.
-// TODO process messages GPGSA : GPS receiver operating mode, satellites used in the position solution, and DOP values.
 // TODO process messages GPGSV : The number of GPS satellites in view satellite ID numbers, elevation, azimuth, and SNR values.
 // TODO process messages GPMSS : Signal-to-noise ratio, signal strength, frequency, and bit rate from a radio-beacon receiver.
-// TODO process messages GPRMC : Time, date, position, course and speed data.
-// TODO process messages GPVTG : Course and speed information relative to the ground.
-// TODO process messages GPZDA : PPS timing message (synchronized to PPS).
 
 
-// TODO process messages from BD ou GB - Beidou ; GA - Galileo ; GL - GLONASS.
-
-
-// Value used for the conversion of the position from DMS to decimal.
-static const int32_t MaxNorthPosition = 8388607;  // 2^23 - 1
-static const int32_t MaxSouthPosition = 8388608;  // -2^23
-static const int32_t MaxEastPosition  = 8388607;  // 2^23 - 1
-static const int32_t MaxWestPosition  = 8388608;  // -2^23
-
-// GPS data in ASCII and numrical formats.
-gps_nmea_t gps_nmea;
+// GPS data in numerical format.
 gps_data_t gps_data;
 
 // Mutex that protect GPS data.
 static mutex_t gps_mutex = MUTEX_INIT;
 
+// Ring buffer filled by the UART ISR.
+static uint8_t rx_buf[GPS_RX_BUF_SIZE];
+static tsrb_t rx_rb = TSRB_INIT(rx_buf);
 
-// Convert a nibble to hex char.
-static int8_t nibble_to_hex(uint8_t a)
-{
-    if (a < 10)
-        return '0' + a;
-    else if (a < 16)
-        return 'A' + (a - 10);
-    else
-        return '?';
-}
+// The parser thread is woken up once per line.
+#define GPS_MSG_LINE        (0x4750)
+#define GPS_MSG_QUEUE_SIZE  (2)
+static msg_t gps_msg_queue[GPS_MSG_QUEUE_SIZE];
+static kernel_pid_t gps_pid = KERNEL_PID_UNDEF;
+static volatile bool line_pending = false;
+static char gps_thread_stack[THREAD_STACKSIZE_DEFAULT];
 
+// Parser of the sentences (thread context only).
+static nmea_parser_t parser;
 
+// The sentences are monitored only when the receiver is powered.
+static volatile bool powered = true;
 
-// Convert GPS positions from double to binary values.
-static void positions_to_binary(void)
-{
-    long double temp;
-
-    if (gps_data.latitude >= 0) { // North
-        temp = gps_data.latitude * MaxNorthPosition;
-        gps_data.latitude_bin = temp / 90;
-    } else {                      // South
-        temp = gps_data.latitude * MaxSouthPosition;
-        gps_data.latitude_bin = temp / 90;
-    }
 
-    if (gps_data.longitude >= 0) { // East
-        temp = gps_data.longitude * MaxEastPosition;
-        gps_data.longitude_bin = temp / 180;
-    } else {                       // West
-        temp = gps_data.longitude * MaxWestPosition;
-        gps_data.longitude_bin = temp / 180;
+// Set the position from the fields of a GGA or RMC sentence.
+static void set_position(uint8_t lat_field)
+{
+    int32_t lat, lon;
+    if (nmea_coord_to_binary(nmea_field(&parser, lat_field), nmea_field(&parser, lat_field + 1), 90, &lat) &&
+        nmea_coord_to_binary(nmea_field(&parser, lat_field + 2), nmea_field(&parser, lat_field + 3), 180, &lon)) {
+        gps_data.latitude_bin = lat;
+        gps_data.longitude_bin = lon;
+    } else {
+        gps_data.has_fix = false;
     }
 }
 
 
-// Convert GPS positions from ASCII to double values.
-static void positions_to_double(void)
+// Parse a time field (hhmmss.ss).
+static bool parse_time(const char *field, gps_utc_t *utc)
 {
-    double valueTmp1, valueTmp2, valueTmp3, valueTmp4;
-
-    // Convert the latitude from ASCII to uint8_t values.
-    for (int i = 0 ; i < 10 ; i++ )
-        gps_nmea.latitude[i] = gps_nmea.latitude[i] & 0xF;
-
-    // Convert latitude from degree/minute/second (DMS) format into decimal.
-    valueTmp1 = (double)gps_nmea.latitude[0] * 10.0 + (double)gps_nmea.latitude[1];
-    valueTmp2 = (double)gps_nmea.latitude[2] * 10.0 + (double)gps_nmea.latitude[3];
-    valueTmp3 = (double)gps_nmea.latitude[5] * 1000.0 + (double)gps_nmea.latitude[6] * 100.0 +
-                (double)gps_nmea.latitude[7] * 10.0 + (double)gps_nmea.latitude[8];
-
-    gps_data.latitude = valueTmp1 + ((valueTmp2 + (valueTmp3 * 0.0001)) / 60.0);
-    if (gps_nmea.latitude_pole[0] == 'S')
-        gps_data.latitude *= -1;
-
-    // Convert the longitude from ASCII to uint8_t values.
-    for (int i = 0 ; i < 10 ; i++)
-        gps_nmea.longitude[i] = gps_nmea.longitude[i] & 0xF;
-
-    // Convert longitude from degree/minute/second (DMS) format into decimal.
-    valueTmp1 = (double)gps_nmea.longitude[0] * 100.0 + (double)gps_nmea.longitude[1] * 10.0 + (double)gps_nmea.longitude[2];
-    valueTmp2 = (double)gps_nmea.longitude[3] * 10.0 + (double)gps_nmea.longitude[4];
-    valueTmp3 = (double)gps_nmea.longitude[6] * 1000.0 + (double)gps_nmea.longitude[7] * 100;
-    valueTmp4 = (double)gps_nmea.longitude[8] * 10.0 + (double)gps_nmea.longitude[9];
-
-    gps_data.longitude = valueTmp1 + (valueTmp2 / 60.0) + (((valueTmp3 + valueTmp4) * 0.0001) / 60.0);
-    if (gps_nmea.longitude_pole[0] == 'W')
-        gps_data.longitude *= -1;
-}
+    int32_t value;
+    if (!nmea_fixed(field, 0, &value))
+        return false;
 
+    utc->hour = value / 10000;
+    utc->min = (value / 100) % 100;
+    utc->sec = value % 100;
+    utc->rx_ms = ztimer_now(ZTIMER_MSEC);
+    return true;
+}
 
 
-// Calculates the checksum for a NMEA sentence (and return the position of the
-// checksum in the sentence).
-static int32_t nmea_checksum(int8_t *nmeaStr, int32_t nmeaStrSize, int8_t *checksum)
+// Check the date and time (the time of the receiver is trusted only with a fix).
+static bool valid_utc(const gps_utc_t *utc)
 {
-    int i = 0;
-    uint8_t checkNum = 0;
+    return gps_data.has_fix && utc->month >= 1 && utc->month <= 12
+        && utc->day >= 1 && utc->day <= 31
+        && utc->hour < 24 && utc->min < 60 && utc->sec < 60;
+}
 
-    if ((nmeaStr == NULL) || (checksum == NULL) || (nmeaStrSize <= 1))
-        return -1;
 
-    if (nmeaStr[i] == '$')
-        i += 1;  // Skip the first '$' if necessary.
+// Parse a GGA message.
+static void parse_GGA(void)
+{
+    int32_t value;
 
-    while (nmeaStr[i] != '*') {
-        checkNum ^= nmeaStr[i];  // XOR until '*' or max length is reached.
-        i += 1;
-        if (i >= nmeaStrSize)
-            return -1;
+    gps_data.has_fix = (nmea_field(&parser, 6)[0] > '0');
+    if (gps_data.has_fix) {
+        set_position(2);
+        if (nmea_fixed(nmea_field(&parser, 9), 0, &value))
+            gps_data.altitude = value;
     }
-
-    // Convert checksum value to 2 hexadecimal characters.
-    checksum[0] = nibble_to_hex(checkNum / 16); // upper nibble
-    checksum[1] = nibble_to_hex(checkNum % 16); // lower nibble
-    return i + 1;
+    if (nmea_fixed(nmea_field(&parser, 7), 0, &value))
+        gps_data.satellites = value;
+    if (nmea_fixed(nmea_field(&parser, 8), 2, &value))
+        gps_data.hdop_x100 = value;
+    if (gps_data.has_fix)
+        gps_data.fix_count++;
 }
 
 
-// Calculate the checksum of a NMEA frame and compare it to the checksum that
-// is present at the end of it (return true if it matches).
-static bool nmea_validate_checksum(int8_t *serialBuff, int32_t buffSize)
+// Parse a RMC message.
+static void parse_RMC(void)
 {
-    int32_t checksumIndex;
-    int8_t checksum[2]; // 2 characters to calculate NMEA checksum.
+    int32_t value;
 
-    checksumIndex = nmea_checksum(serialBuff, buffSize, checksum);
-    if (checksumIndex < 0)
-        return false;
+    gps_data.has_fix = (nmea_field(&parser, 2)[0] == 'A');
+    if (gps_data.has_fix)
+        set_position(3);
+    if (nmea_fixed(nmea_field(&parser, 8), 1, &value))
+        gps_data.course_x10 = value;
+
+    // date: ddmmyy
+    gps_utc_t utc;
+    if (parse_time(nmea_field(&parser, 1), &utc) &&
+        nmea_fixed(nmea_field(&parser, 9), 0, &value)) {
+        utc.day = value / 10000;
+        utc.month = (value / 100) % 100;
+        utc.year = 2000 + value % 100;
+        utc.valid = valid_utc(&utc);
+        gps_data.utc = utc;
+    }
+}
 
-    if (checksumIndex >= (buffSize - 2))
-        return false;  // Not enough char in the serial buffer to read checksum.
 
-    return  // Check the checksum.
-        (serialBuff[checksumIndex + 0] == checksum[0]) &&
-        (serialBuff[checksumIndex + 1] == checksum[1]);
+// Parse a GSA message.
+static void parse_GSA(void)
+{
+    int32_t value;
+
+    if (nmea_fixed(nmea_field(&parser, 2), 0, &value))
+        gps_data.fix_mode = value;
+    if (nmea_fixed(nmea_field(&parser, 16), 2, &value))
+        gps_data.hdop_x100 = value;
 }
 
 
-// Format GPS data.
-static void format_gps_data(void)
+// Parse a VTG message.
+static void parse_VTG(void)
 {
-    positions_to_double();
-    positions_to_binary();
+    int32_t value;
 
-    if (gps_data.has_fix)
-        gps_data.altitude = atoi(gps_nmea.altitude);
+    if (nmea_fixed(nmea_field(&parser, 1), 1, &value))
+        gps_data.course_x10 = value;
+    if (nmea_fixed(nmea_field(&parser, 7), 1, &value))
+        gps_data.speed_kmh_x10 = value;
 }
 
 
-
-// Read a field from RX buffer.
-#define READ_FIELD(field, i, rxBuffer, maxSize)       \
-{                                                     \
-    uint8_t __fs = 0;                                 \
-    while ((rxBuffer)[(i) + __fs++] != ',')           \
-        if (__fs > (maxSize)) return GPS_FAIL;        \
-    for (uint8_t __j = 0; __j < __fs; __j++, (i)++)   \
-        (field)[__j] = (rxBuffer)[i];                 \
+// Parse a ZDA message.
+static void parse_ZDA(void)
+{
+    int32_t day, month, year;
+
+    gps_utc_t utc;
+    if (parse_time(nmea_field(&parser, 1), &utc) &&
+        nmea_fixed(nmea_field(&parser, 2), 0, &day) &&
+        nmea_fixed(nmea_field(&parser, 3), 0, &month) &&
+        nmea_fixed(nmea_field(&parser, 4), 0, &year)) {
+        utc.day = day;
+        utc.month = month;
+        utc.year = year;
+        utc.valid = valid_utc(&utc);
+        gps_data.utc = utc;
+    }
 }
 
-// Read a field from RX buffer.
-#define SKIP_FIELD(i, rxBuffer, maxSize)              \
-{                                                     \
-    uint8_t __fs = 0;                                 \
-    while ((rxBuffer)[(i) + __fs++] != ',')           \
-        if (__fs > (maxSize)) return GPS_FAIL;        \
-    (i) += __fs;                                      \
+
+// Process a sentence with a valid checksum.
+static void process_sentence(void)
+{
+    // heartbeat of the GPS: a valid sentence is expected every LIVENESS_GPS_MAX_BUSY_MS
+    if (powered)
+        liveness_busy(LIVENESS_TASK_GPS);
+
+    mutex_lock(&gps_mutex);
+    switch (nmea_type(&parser)) {
+    case NMEA_GGA:
+        parse_GGA();
+        break;
+    case NMEA_RMC:
+        parse_RMC();
+        break;
+    case NMEA_GSA:
+        parse_GSA();
+        break;
+    case NMEA_VTG:
+        parse_VTG();
+        break;
+    case NMEA_ZDA:
+        parse_ZDA();
+        break;
+    default:
+        break;
+    }
+    mutex_unlock(&gps_mutex);
 }
 
 
-// Parse a GPGGA message.
-static uint8_t parse_GPGGA(uint8_t i, int8_t *rxBuffer)
+// Queue a byte received from the GNSS module (interrupt context).
+void gps_isr_rx(char c)
 {
-    // NmeaUtcTime.
-    SKIP_FIELD(i, rxBuffer, 11);
-    // NmeaLatitude.
-    READ_FIELD(gps_nmea.latitude, i, rxBuffer, 10);
-    // NmeaLatitudePole.
-    READ_FIELD(gps_nmea.latitude_pole, i, rxBuffer, 2);
-    // NmeaLongitude.
-    READ_FIELD(gps_nmea.longitude, i, rxBuffer, 11);
-    // NmeaLongitudePole.
-    READ_FIELD(gps_nmea.longitude_pole, i, rxBuffer, 2);
-    // NmeaFixQuality.
-    READ_FIELD(gps_nmea.fix_quality, i, rxBuffer, 2);
-    // NmeaSatelliteTracked.
-    SKIP_FIELD(i, rxBuffer, 3);
-    // NmeaHorizontalDilution.
-    SKIP_FIELD(i, rxBuffer, 6);
-    // NmeaAltitude.
-    READ_FIELD(gps_nmea.altitude, i, rxBuffer, 8);
-    // NmeaAltitudeUnit.
-    SKIP_FIELD(i, rxBuffer, 2);
-    // NmeaHeightGeoid.
-    SKIP_FIELD(i, rxBuffer, 8);
-    // NmeaHeightGeoidUnit.
-    SKIP_FIELD(i, rxBuffer, 2);
-
-    gps_data.has_fix = (gps_nmea.fix_quality[0] > 0x30);
-    format_gps_data();
-
-    return GPS_SUCCESS;
+    // the byte is dropped when the ring buffer is full
+    tsrb_add_one(&rx_rb, (uint8_t)c);
+
+    if (c == '\n' && !line_pending && gps_pid != KERNEL_PID_UNDEF) {
+        msg_t msg;
+        msg.type = GPS_MSG_LINE;
+        line_pending = true;
+        // msg_send does not block in interrupt context
+        if (msg_send(&msg, gps_pid) <= 0)
+            line_pending = false;
+    }
 }
 
 
-// Parse a GPRMC message.
-static uint8_t parse_GPRMC(uint8_t i, int8_t *rxBuffer)
+// Parse the bytes queued by the ISR.
+static void *gps_thread(void *arg)
 {
-    // NmeaUtcTime.
-    SKIP_FIELD(i, rxBuffer, 11);
-    // NmeaDataStatus.
-    READ_FIELD(gps_nmea.fix_quality, i, rxBuffer, 2);
-    // NmeaLatitude.
-    READ_FIELD(gps_nmea.latitude, i, rxBuffer, 10);
-    // NmeaLatitudePole.
-    READ_FIELD(gps_nmea.latitude_pole, i, rxBuffer, 2);
-    // NmeaLongitude.
-    READ_FIELD(gps_nmea.longitude, i, rxBuffer, 11);
-    // NmeaLongitudePole.
-    READ_FIELD(gps_nmea.longitude_pole, i, rxBuffer, 2);
-    // NmeaSpeed.
-    SKIP_FIELD(i, rxBuffer, 8);
-    // NmeaDetectionAngle.
-    SKIP_FIELD(i, rxBuffer, 8);
-    // NmeaDate.
-    SKIP_FIELD(i, rxBuffer, 8);
-
-    gps_data.has_fix = (gps_nmea.fix_quality[0] == 0x41);
-    format_gps_data();
-
-    return GPS_SUCCESS;
+    (void)arg;
+    msg_init_queue(gps_msg_queue, GPS_MSG_QUEUE_SIZE);
+    nmea_init(&parser);
+
+    while (1) {
+        msg_t msg;
+        msg_receive(&msg);
+        line_pending = false;
+
+        int c;
+        while ((c = tsrb_get_one(&rx_rb)) >= 0) {
+            if (nmea_parse_byte(&parser, (char)c))
+                process_sentence();
+        }
+    }
+    return NULL;
 }
 
 
-// Parse GPS data.
-uint8_t gps_parse_data(int8_t *rxBuffer, int32_t rxBufferSize)
+// Start the thread parsing the NMEA sentences.
+void gps_init(void)
 {
-    if (!nmea_validate_checksum(rxBuffer, rxBufferSize))
-        return GPS_FAIL;
-
-    uint8_t i = 1;
-    READ_FIELD(gps_nmea.data_type, i, rxBuffer, 6);
-
-    if (strncmp(gps_nmea.data_type, NmeaDataTypeGPGGA, 5) == 0)
-        return parse_GPGGA(i, rxBuffer);
-    else if (strncmp(gps_nmea.data_type, NmeaDataTypeGPRMC, 5) == 0)
-        return parse_GPRMC(i, rxBuffer);
-    else
-        return GPS_FAIL;
+    gps_reset_data();
+    gps_data.hdop_x100 = 0xFFFF;
+    gps_data.fix_mode = 1;
+    gps_pid = thread_create(gps_thread_stack, sizeof(gps_thread_stack),
+                            THREAD_PRIORITY_MAIN - 1, THREAD_CREATE_STACKTEST,
+                            gps_thread, NULL, "gps");
 }
 
 
@@ -296,15 +279,31 @@ uint8_t gps_get_binary(int32_t *lat, int32_t *lon, int16_t *alt)
 }
 
 
+// Get a copy of the GPS data.
+void gps_get_data(gps_data_t *data)
+{
+    mutex_lock(&gps_mutex);
+    *data = gps_data;
+    mutex_unlock(&gps_mutex);
+}
+
+
+// Declare the power state of the receiver.
+void gps_set_powered(bool on)
+{
+    powered = on;
+    // the GPS is monitored again after the first valid sentence
+    if (!on)
+        liveness_idle(LIVENESS_TASK_GPS);
+}
+
+
 // Reset GPS data.
 void gps_reset_data(void)
 {
     gps_data.has_fix = false;
     gps_data.altitude = 0xFFFF;
 
-    gps_data.latitude = 0;
-    gps_data.longitude = 0;
-
     gps_data.latitude_bin = 0;
     gps_data.longitude_bin = 0;
 }
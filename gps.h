@@ -12,35 +12,47 @@ This project is under the MIT license
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 
 #if GPS == 1
 
+// Size of the ring buffer between the UART ISR and the parser (power of 2).
+#ifndef GPS_RX_BUF_SIZE
+#define GPS_RX_BUF_SIZE  256
+#endif
+
 // Return codes.
 #define GPS_SUCCESS  0
 #define GPS_FAIL     1
 
 
-// Store the GPS parsed data in ASCII.
+// UTC time and date of the GNSS (RMC, ZDA).
 typedef struct {
-    char data_type[6];
-    char latitude[10];
-    char latitude_pole[2];
-    char longitude[11];
-    char longitude_pole[2];
-    char fix_quality[2];
-    char altitude[8];
-} gps_nmea_t;
+    bool valid;              // received with a fix
+    uint32_t rx_ms;          // ZTIMER_MSEC at the reception
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t min;
+    uint8_t sec;
+} gps_utc_t;
 
 
 // Store GPS data.
 typedef struct {
     bool has_fix;  // Ara data fixed?
-    double latitude;
-    double longitude;
     int32_t latitude_bin;
     int32_t longitude_bin;
     int16_t altitude;
+    uint8_t satellites;      // satellites used (GGA)
+    uint16_t hdop_x100;      // horizontal dilution of precision * 100 (GGA, GSA)
+    uint8_t fix_mode;        // 1: no fix, 2: 2D, 3: 3D (GSA)
+    uint16_t speed_kmh_x10;  // speed over ground in km/h * 10 (VTG)
+    uint16_t course_x10;     // course over ground in degrees * 10 (VTG, RMC)
+    gps_utc_t utc;           // time of the last RMC or ZDA
+    uint32_t fix_count;      // number of GGA with a fix
 } gps_data_t;
 
 // GPS parsed data.
@@ -58,12 +70,30 @@ uint8_t gps_get_binary(int32_t *lat, int32_t *lon, int16_t *alt);
 
 
 /**
- * @brief Parse GPS data.
- * @param rxBuffer GPS data to parse.
- * @param rxBufferSize Length of data.
- * @return Either `GPS_SUCCESS` or `GPS_FAIL`.
+ * @brief Start the thread parsing the NMEA sentences.
+ */
+void gps_init(void);
+
+
+/**
+ * @brief Queue a byte received from the GNSS module (to call by the UART ISR).
+ * @param c The byte.
  */
-uint8_t gps_parse_data(int8_t *rxBuffer, int32_t rxBufferSize);
+void gps_isr_rx(char c);
+
+/**
+ * @brief Get a copy of the GPS data.
+ * @param data Where to store the data.
+ */
+void gps_get_data(gps_data_t *data);
+
+
+/**
+ * @brief Declare the power state of the receiver (the sentences are monitored when powered).
+ * @param powered True if the receiver is powered.
+ */
+void gps_set_powered(bool powered);
+
 
 /**
  * @brief Reset parsed GPS data.
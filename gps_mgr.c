@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Power management of the GNSS receiver: duty-cycled fix acquisition.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#if GPS == 1
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include "mutex.h"
+#include "ztimer.h"
+
+#include "gps.h"
+#include "gps_mgr.h"
+#include "liveness.h"
+#include "timebase.h"
+#include "wdt_ztimer.h"
+
+#if GPS_STANDBY == GPS_STANDBY_PIN
+#include "periph/gpio.h"
+#endif
+
+#if GPS_STANDBY == GPS_STANDBY_PIN && !defined(GPS_POWER_PIN)
+#error "GPS_POWER_PIN is required by GPS_STANDBY_PIN"
+#endif
+
+#if GPS_STANDBY == GPS_STANDBY_PMTK || GPS_STANDBY == GPS_STANDBY_UBX
+#error "the receiver shares the console UART: any log line wakes it up, use GPS_STANDBY_PIN"
+#endif
+
+// polling period of the fix during an acquisition
+#define GPS_MGR_POLL_MS                 (250U)
+
+static mutex_t gps_mgr_mutex = MUTEX_INIT;
+
+static bool acquiring = false;
+static uint32_t start_ms = 0;
+static uint32_t start_fix_count = 0;
+
+// last accepted fix
+static bool has_position = false;
+static int32_t last_lat = 0;
+static int32_t last_lon = 0;
+static int16_t last_alt = 0;
+
+// statistics of the time to fix
+static uint32_t nb_acquisitions = 0;
+static uint32_t nb_fixes = 0;
+static uint32_t nb_timeouts = 0;
+static uint32_t last_ttf_ms = 0;
+static uint32_t min_ttf_ms = UINT32_MAX;
+static uint32_t max_ttf_ms = 0;
+static uint64_t sum_ttf_ms = 0;
+
+static void gps_power(bool on)
+{
+#if GPS_STANDBY == GPS_STANDBY_PIN
+    gpio_write(GPS_POWER_PIN, on ? GPS_POWER_PIN_ON_LEVEL : !GPS_POWER_PIN_ON_LEVEL);
+#endif
+#if GPS_STANDBY != GPS_STANDBY_NONE
+    gps_set_powered(on);
+#else
+    // always on
+    (void)on;
+#endif
+}
+
+void gps_mgr_init(void)
+{
+#if GPS_STANDBY == GPS_STANDBY_PIN
+    gpio_init(GPS_POWER_PIN, GPIO_OUT);
+#endif
+    gps_power(false);
+    DEBUG("[gps] standby mode=%d fix timeout=%u sec\n", GPS_STANDBY, GPS_MGR_FIX_TIMEOUT_SEC);
+}
+
+void gps_mgr_start(void)
+{
+    gps_data_t data;
+    gps_get_data(&data);
+
+    mutex_lock(&gps_mgr_mutex);
+    if (!acquiring) {
+        acquiring = true;
+        start_ms = ztimer_now(ZTIMER_MSEC);
+        // only the fixes of this acquisition are accepted
+        start_fix_count = data.fix_count;
+        nb_acquisitions++;
+        gps_power(true);
+    }
+    mutex_unlock(&gps_mgr_mutex);
+}
+
+static bool acceptable_fix(const gps_data_t *data)
+{
+    return data->has_fix && data->fix_count != start_fix_count
+           && data->satellites >= GPS_MGR_MIN_SATELLITES
+           && data->hdop_x100 <= GPS_MGR_MAX_HDOP_X100;
+}
+
+uint8_t gps_mgr_get_position(int32_t *lat, int32_t *lon, int16_t *alt)
+{
+    gps_data_t data;
+
+    gps_mgr_start();
+
+    // the wait is longer than the max busy period of the sender
+    liveness_busy_for(LIVENESS_TASK_SENDER, GPS_MGR_FIX_TIMEOUT_SEC * 1000U + LIVENESS_SENDER_MAX_BUSY_MS);
+
+    uint32_t elapsed_ms;
+    while (true) {
+        gps_get_data(&data);
+        elapsed_ms = ztimer_now(ZTIMER_MSEC) - start_ms;
+        if (acceptable_fix(&data) || elapsed_ms >= GPS_MGR_FIX_TIMEOUT_SEC * 1000U) {
+            break;
+        }
+        ztimer_sleep(ZTIMER_MSEC, GPS_MGR_POLL_MS);
+        // progress point of the acquisition
+        wdt_ztimer_kick();
+    }
+    liveness_busy(LIVENESS_TASK_SENDER);
+
+    mutex_lock(&gps_mgr_mutex);
+    gps_power(false);
+    acquiring = false;
+
+    uint8_t ret;
+    if (acceptable_fix(&data)) {
+        has_position = true;
+        last_lat = data.latitude_bin;
+        last_lon = data.longitude_bin;
+        last_alt = data.altitude;
+        nb_fixes++;
+        last_ttf_ms = elapsed_ms;
+        sum_ttf_ms += elapsed_ms;
+        if (elapsed_ms < min_ttf_ms) {
+            min_ttf_ms = elapsed_ms;
+        }
+        if (elapsed_ms > max_ttf_ms) {
+            max_ttf_ms = elapsed_ms;
+        }
+        ret = GPS_MGR_FIX;
+        DEBUG("[gps] fix in %lu ms (satellites=%u hdop=%u.%02u)\n", (unsigned long)elapsed_ms,
+              data.satellites, data.hdop_x100 / 100, data.hdop_x100 % 100);
+    } else {
+        nb_timeouts++;
+        ret = has_position ? GPS_MGR_LAST_KNOWN : GPS_MGR_NO_POSITION;
+        DEBUG("[gps] no fix after %u sec: %s\n", GPS_MGR_FIX_TIMEOUT_SEC,
+              has_position ? "last known position" : "no position");
+    }
+    *lat = last_lat;
+    *lon = last_lon;
+    *alt = last_alt;
+    mutex_unlock(&gps_mgr_mutex);
+    return ret;
+}
+
+bool gps_mgr_get_time(uint64_t *gps_ms)
+{
+    gps_data_t data;
+    gps_get_data(&data);
+    if (!data.utc.valid) {
+        return false;
+    }
+    uint32_t age_ms = ztimer_now(ZTIMER_MSEC) - data.utc.rx_ms;
+    if (age_ms > GPS_MGR_TIME_MAX_AGE_SEC * 1000U) {
+        return false;
+    }
+    timebase_civil_t civil = {
+        .year = data.utc.year,
+        .month = data.utc.month,
+        .day = data.utc.day,
+        .hour = data.utc.hour,
+        .min = data.utc.min,
+        .sec = data.utc.sec,
+    };
+    // the sentence is received after the second of the fix: the time is late by the latency
+    *gps_ms = (uint64_t)(timebase_from_civil(&civil) + GPS_UTC_LEAP_SEC) * 1000 + age_ms;
+    return true;
+}
+
+void gps_mgr_print(void)
+{
+    mutex_lock(&gps_mgr_mutex);
+    printf("[gps] acquisitions=%lu fixes=%lu timeouts=%lu", (unsigned long)nb_acquisitions,
+           (unsigned long)nb_fixes, (unsigned long)nb_timeouts);
+    if (nb_fixes > 0) {
+        printf(" ttf: last=%lu min=%lu max=%lu avg=%lu ms\n", (unsigned long)last_ttf_ms,
+               (unsigned long)min_ttf_ms, (unsigned long)max_ttf_ms,
+               (unsigned long)(sum_ttf_ms / nb_fixes));
+    } else {
+        printf("\n");
+    }
+    mutex_unlock(&gps_mgr_mutex);
+}
+
+#endif
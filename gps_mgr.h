@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Power management of the GNSS receiver: duty-cycled fix acquisition.
+ *
+ * The receiver is powered off (or put into standby/backup mode) between the uplinks. It is
+ * powered on at the beginning of the encoding of the data frame (in parallel with the
+ * warm-up of the other sensors). The first fix with at least GPS_MGR_MIN_SATELLITES
+ * satellites and an HDOP below GPS_MGR_MAX_HDOP_X100 is accepted and the receiver is powered
+ * off again. After GPS_MGR_FIX_TIMEOUT_SEC without an acceptable fix, the last known
+ * position is used.
+ *
+ * The receiver is controlled by GPS_STANDBY:
+ * - GPS_STANDBY_NONE: always on (no power management)
+ * - GPS_STANDBY_PIN: power switch on GPS_POWER_PIN
+ * - GPS_STANDBY_PMTK: standby mode of the MediaTek receivers ($PMTK161)
+ * - GPS_STANDBY_UBX: backup mode of the u-blox receivers (UBX-RXM-PMREQ)
+ *
+ * The receiver shares the console UART (UART_DEV(0), the other UART is used by the PMS7003):
+ * every log line is received by the GNSS module and wakes it up from the standby or backup mode.
+ * GPS_STANDBY_PMTK and GPS_STANDBY_UBX are rejected at the build: only GPS_STANDBY_PIN powers
+ * the receiver off between the acquisitions.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef GPS_MGR_H
+#define GPS_MGR_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define GPS_STANDBY_NONE                (0)
+#define GPS_STANDBY_PIN                 (1)
+#define GPS_STANDBY_PMTK                (2)
+#define GPS_STANDBY_UBX                 (3)
+
+#ifndef GPS_STANDBY
+#define GPS_STANDBY                     GPS_STANDBY_NONE
+#endif
+
+/*
+ * Level of GPS_POWER_PIN powering the receiver
+ */
+#ifndef GPS_POWER_PIN_ON_LEVEL
+#define GPS_POWER_PIN_ON_LEVEL          (1)
+#endif
+
+/*
+ * Max duration (in seconds) of an acquisition
+ */
+#ifndef GPS_MGR_FIX_TIMEOUT_SEC
+#define GPS_MGR_FIX_TIMEOUT_SEC         (90U)
+#endif
+
+/*
+ * Min number of satellites of an acceptable fix
+ */
+#ifndef GPS_MGR_MIN_SATELLITES
+#define GPS_MGR_MIN_SATELLITES          (5U)
+#endif
+
+/*
+ * Max HDOP (* 100) of an acceptable fix
+ */
+#ifndef GPS_MGR_MAX_HDOP_X100
+#define GPS_MGR_MAX_HDOP_X100           (250U)
+#endif
+
+/*
+ * Leap seconds between the GPS time and UTC (GPS = UTC + 18 seconds since 2017)
+ */
+#ifndef GPS_UTC_LEAP_SEC
+#define GPS_UTC_LEAP_SEC                (18U)
+#endif
+
+/*
+ * Max age (in seconds) of the last UTC time of the receiver
+ */
+#ifndef GPS_MGR_TIME_MAX_AGE_SEC
+#define GPS_MGR_TIME_MAX_AGE_SEC        (600U)
+#endif
+
+/*
+ * Return codes of gps_mgr_get_position
+ */
+#define GPS_MGR_FIX                     (0)     /**< fix of this acquisition */
+#define GPS_MGR_LAST_KNOWN              (1)     /**< timeout: last known position */
+#define GPS_MGR_NO_POSITION             (2)     /**< timeout and no position known */
+
+/**
+ * Power off the receiver until the first acquisition
+ */
+void gps_mgr_init(void);
+
+/**
+ * Power on the receiver for an acquisition (no-op if an acquisition is in progress)
+ */
+void gps_mgr_start(void);
+
+/**
+ * Wait for an acceptable fix (or the timeout) of the acquisition and power off the receiver
+ *
+ * @param lat   the latitude (24-bit binary format)
+ * @param lon   the longitude (24-bit binary format)
+ * @param alt   the altitude in meters
+ *
+ * @return GPS_MGR_FIX, GPS_MGR_LAST_KNOWN or GPS_MGR_NO_POSITION
+ */
+uint8_t gps_mgr_get_position(int32_t *lat, int32_t *lon, int16_t *alt);
+
+/**
+ * Get the current GPS time from the last UTC time (RMC or ZDA) received with a fix
+ *
+ * @param gps_ms    the time in milliseconds since the GPS epoch
+ *
+ * @return false if no recent UTC time
+ */
+bool gps_mgr_get_time(uint64_t *gps_ms);
+
+/**
+ * Print the statistics of the time to fix
+ */
+void gps_mgr_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
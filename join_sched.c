@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Scheduler of the OTAA join attempts.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include <string.h>
+
+#include "random.h"
+#include "ztimer.h"
+
+#include "join_sched.h"
+#include "loramac_dutycycle.h"
+#include "persist.h"
+
+#ifndef LORAMAC_JOIN_MIN_DATARATE
+#define LORAMAC_JOIN_MIN_DATARATE           (0U)
+#endif
+
+// phases of the join duty-cycle of LoRaWAN 1.0.4 (elapsed time since the first attempt)
+#define JOIN_SCHED_PHASE1_END_SEC           (3600UL)
+#define JOIN_SCHED_PHASE2_END_SEC           (11UL * 3600UL)
+
+// off-time factors after a JoinRequest: 1% -> 99, 0.1% -> 999, 0.01% -> 9999
+#define JOIN_SCHED_PHASE1_OFF_FACTOR        (99UL)
+#define JOIN_SCHED_PHASE2_OFF_FACTOR        (999UL)
+#define JOIN_SCHED_PHASE3_OFF_FACTOR        (9999UL)
+
+// max exponent of the backoff window (base << exp)
+#define JOIN_SCHED_MAX_EXP                  (16U)
+
+typedef struct {
+    // the join sequence in progress
+    uint32_t elapsed_sec;
+    uint16_t attempts;
+    uint8_t dr;
+    uint8_t exp;
+    // statistics
+    uint32_t total_attempts;
+    uint32_t last_time_to_join_sec;
+    uint16_t last_attempts;
+    uint16_t joins;
+    uint8_t last_dr;
+    uint8_t rfu[3];
+} join_sched_t;
+
+static join_sched_t state;
+
+static uint8_t init_dr;
+static uint32_t base_sec;
+static uint32_t max_sec;
+
+// time (ZTIMER_SEC) at which state.elapsed_sec was updated
+static ztimer_now_t mark;
+
+static void save(void)
+{
+    if (persist_write(PERSIST_ID_JOIN, &state, sizeof(state)) != PERSIST_OK) {
+        DEBUG("[join] ERROR: state not saved\n");
+    }
+}
+
+void join_sched_init(uint8_t dr, uint32_t base, uint32_t max)
+{
+    init_dr = dr;
+    base_sec = base;
+    max_sec = max;
+
+    if (persist_read(PERSIST_ID_JOIN, &state, sizeof(state)) != sizeof(state)) {
+        memset(&state, 0, sizeof(state));
+        state.dr = init_dr;
+    } else if (state.attempts != 0) {
+        DEBUG("[join] resuming the join sequence: attempts=%d elapsed=%ld sec dr=%d exp=%d\n",
+              state.attempts, state.elapsed_sec, state.dr, state.exp);
+    }
+    if (state.dr > init_dr) {
+        state.dr = init_dr;
+    }
+    mark = ztimer_now(ZTIMER_SEC);
+}
+
+uint8_t join_sched_dr(void)
+{
+    return state.dr;
+}
+
+/*
+ * Backoff window (in seconds) for the current exponent
+ */
+static uint32_t backoff_window_sec(void)
+{
+    uint32_t window = base_sec << state.exp;
+    if (window > max_sec || (window >> state.exp) != base_sec) {
+        window = max_sec;
+    }
+    return window;
+}
+
+/*
+ * Min off-time (in seconds, rounded up) after a JoinRequest at the DR
+ */
+static uint32_t dutycycle_off_sec(uint8_t dr)
+{
+    uint32_t toa_ms = loramac_dutycycle_time_on_air_ms(dr, JOIN_SCHED_JOIN_REQUEST_LEN - LORAMAC_DUTYCYCLE_MAC_OVERHEAD);
+    uint32_t factor;
+    if (state.elapsed_sec < JOIN_SCHED_PHASE1_END_SEC) {
+        factor = JOIN_SCHED_PHASE1_OFF_FACTOR;
+    } else if (state.elapsed_sec < JOIN_SCHED_PHASE2_END_SEC) {
+        factor = JOIN_SCHED_PHASE2_OFF_FACTOR;
+    } else {
+        factor = JOIN_SCHED_PHASE3_OFF_FACTOR;
+    }
+    return (toa_ms * factor + 999) / 1000;
+}
+
+uint32_t join_sched_failed(void)
+{
+    ztimer_now_t now = ztimer_now(ZTIMER_SEC);
+    state.elapsed_sec += now - mark;
+    state.attempts++;
+    state.total_attempts++;
+
+    uint32_t off_sec = dutycycle_off_sec(state.dr);
+
+    // sweep the DR down to the min DR, then restart the sweep with a larger backoff window
+    if (state.dr > LORAMAC_JOIN_MIN_DATARATE) {
+        state.dr--;
+    } else {
+        state.dr = init_dr;
+        if (state.exp < JOIN_SCHED_MAX_EXP) {
+            state.exp++;
+        }
+    }
+
+    // random delay into [window/2, window] so the endpoints do not retry in lock-step
+    uint32_t window = backoff_window_sec();
+    uint32_t delay = window / 2 + random_uint32_range(0, window / 2 + 1);
+    if (delay < off_sec) {
+        delay = off_sec;
+    }
+
+    // the delay is counted before the sleep: a reboot during the sleep moves the sequence
+    // forward (to the more restrictive phases), never backward
+    state.elapsed_sec += delay;
+    mark = now + delay;
+    save();
+
+    DEBUG("[join] attempt %d failed: next attempt in %ld sec at dr=%d (off-time=%ld sec, elapsed=%ld sec)\n",
+          state.attempts, delay, state.dr, off_sec, state.elapsed_sec);
+    return delay;
+}
+
+uint32_t join_sched_resume_delay(void)
+{
+    if (state.attempts == 0) {
+        return 0;
+    }
+    // the previous delay may have been interrupted by the reboot
+    uint32_t delay = random_uint32_range(0, backoff_window_sec() + 1);
+    uint32_t off_sec = dutycycle_off_sec(state.dr);
+    if (delay < off_sec) {
+        delay = off_sec;
+    }
+    state.elapsed_sec += delay;
+    mark = ztimer_now(ZTIMER_SEC) + delay;
+    DEBUG("[join] resume the join sequence in %ld sec\n", delay);
+    return delay;
+}
+
+void join_sched_succeeded(void)
+{
+    ztimer_now_t now = ztimer_now(ZTIMER_SEC);
+    if ((int32_t)(now - mark) > 0) {
+        state.elapsed_sec += now - mark;
+    }
+
+    state.total_attempts++;
+    state.joins++;
+    state.last_attempts = state.attempts + 1;
+    state.last_time_to_join_sec = state.elapsed_sec;
+    state.last_dr = state.dr;
+
+    // reset the backoff for the next join sequence
+    state.elapsed_sec = 0;
+    state.attempts = 0;
+    state.exp = 0;
+    state.dr = init_dr;
+    save();
+
+    join_sched_print();
+}
+
+void join_sched_print(void)
+{
+    printf("[join] joins: %d attempts: %ld last join: %d attempts in %ld sec at dr=%d\n",
+           state.joins, state.total_attempts, state.last_attempts, state.last_time_to_join_sec, state.last_dr);
+}
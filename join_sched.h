@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Scheduler of the OTAA join attempts.
+ *
+ * The delay between two attempts follows a randomized exponential backoff and the
+ * join duty-cycle limits of LoRaWAN 1.0.4 (1% during the first hour, 0.1% during the
+ * next 10 hours, 0.01% after). The attempts sweep the DR from the initial DR down to
+ * LORAMAC_JOIN_MIN_DATARATE. The state of the backoff is saved into the flash so a
+ * reboot does not restart the join sequence from its most aggressive step.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef JOIN_SCHED_H
+#define JOIN_SCHED_H
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Size of the PHY payload of a JoinRequest
+ * MHDR (1) + JoinEUI (8) + DevEUI (8) + DevNonce (2) + MIC (4)
+ */
+#define JOIN_SCHED_JOIN_REQUEST_LEN         (23U)
+
+/**
+ * Load the state of the join sequence saved into the flash
+ *
+ * @param init_dr       the first DR of the sweep
+ * @param base_sec      the first backoff window in seconds
+ * @param max_sec       the max backoff window in seconds
+ */
+void join_sched_init(uint8_t init_dr, uint32_t base_sec, uint32_t max_sec);
+
+/**
+ * Get the DR of the next join attempt
+ *
+ * @return the DR
+ */
+uint8_t join_sched_dr(void);
+
+/**
+ * Get the delay before the first attempt of a join sequence resumed after a reboot
+ *
+ * @return the delay in seconds (0 for a new join sequence)
+ */
+uint32_t join_sched_resume_delay(void);
+
+/**
+ * Register a failed join attempt at the DR given by join_sched_dr()
+ *
+ * @return the delay in seconds before the next attempt
+ */
+uint32_t join_sched_failed(void);
+
+/**
+ * Register the successful join attempt: update the statistics and reset the backoff
+ */
+void join_sched_succeeded(void);
+
+/**
+ * Print the statistics of the joins
+ */
+void join_sched_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
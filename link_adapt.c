@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Device-side adaptation of the DR and the TX power to the link margin.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include "mutex.h"
+
+#include "link_adapt.h"
+
+// gain (in dB) of the margin for a DR step down and for a TX power step up
+#define LINK_ADAPT_DR_STEP_DB           (3)
+#define LINK_ADAPT_POWER_STEP_DB        (2)
+
+// number of DR steps down on loss
+#define LINK_ADAPT_LOSS_DR_STEPS        (2U)
+
+// weight of the new margin into the EWMA: 1/4
+#define LINK_ADAPT_EWMA_SHIFT           (2)
+
+// fixed point of the EWMA (1/16 dB)
+#define Q4(db)                          ((int16_t)((db) * 16))
+
+static mutex_t link_adapt_mutex = MUTEX_INIT;
+
+static uint8_t tx_power_idx = 0;
+static int16_t margin_q4 = 0;
+static bool margin_valid = false;
+static uint32_t cnt_uplinks = 0;
+// a LinkCheckReq is requested for the current uplink
+static bool requested = false;
+// a LinkCheckReq was transmitted: an answer is expected
+static bool pending = false;
+static uint8_t missed = 0;
+
+void link_adapt_init(semtech_loramac_t *loramac, uint8_t dbm)
+{
+    uint8_t idx = 0;
+    if (dbm < LINK_ADAPT_MAX_EIRP_DBM) {
+        idx = (LINK_ADAPT_MAX_EIRP_DBM - dbm) / LINK_ADAPT_POWER_STEP_DB;
+    }
+    if (idx > LINK_ADAPT_MAX_TX_POWER_IDX) {
+        idx = LINK_ADAPT_MAX_TX_POWER_IDX;
+    }
+    mutex_lock(&link_adapt_mutex);
+    tx_power_idx = idx;
+    semtech_loramac_set_tx_power(loramac, tx_power_idx);
+    mutex_unlock(&link_adapt_mutex);
+    DEBUG("[link] tx power=%d dBm (index %d)\n", LINK_ADAPT_MAX_EIRP_DBM - LINK_ADAPT_POWER_STEP_DB * idx, idx);
+}
+
+/*
+ * Go back quickly to a robust link: max TX power and a lower DR
+ */
+static void step_down_on_loss(semtech_loramac_t *loramac)
+{
+    uint8_t dr = semtech_loramac_get_dr(loramac);
+    dr = (dr > LINK_ADAPT_LOSS_DR_STEPS) ? dr - LINK_ADAPT_LOSS_DR_STEPS : 0;
+    semtech_loramac_set_dr(loramac, dr);
+    tx_power_idx = 0;
+    semtech_loramac_set_tx_power(loramac, tx_power_idx);
+    margin_valid = false;
+    missed = 0;
+    DEBUG("[link] link lost: dr=%d tx power index=%d\n", dr, tx_power_idx);
+}
+
+void link_adapt_before_uplink(semtech_loramac_t *loramac)
+{
+#if LINK_ADAPT_CHECK_PERIOD == 0
+    (void)loramac;
+#else
+    mutex_lock(&link_adapt_mutex);
+    if (pending) {
+        // no LinkCheckAns for the previous uplink
+        DEBUG("[link] LinkCheckReq not answered (%d)\n", missed + 1);
+        pending = false;
+        if (++missed >= LINK_ADAPT_MAX_MISSED) {
+            step_down_on_loss(loramac);
+        }
+    }
+
+    // after a miss, the link is checked at each uplink until an answer is received
+    requested = missed > 0 || (cnt_uplinks % LINK_ADAPT_CHECK_PERIOD) == 0;
+    if (requested) {
+        semtech_loramac_request_link_check(loramac);
+    }
+    mutex_unlock(&link_adapt_mutex);
+#endif
+}
+
+void link_adapt_after_uplink(uint8_t ret)
+{
+#if LINK_ADAPT_CHECK_PERIOD == 0
+    (void)ret;
+#else
+    if (ret != SEMTECH_LORAMAC_TX_DONE && ret != SEMTECH_LORAMAC_TX_CNF_FAILED) {
+        // nothing transmitted (duty-cycle, busy, not joined): the link check is requested again
+        return;
+    }
+    mutex_lock(&link_adapt_mutex);
+    // the answer may have been received before the end of the send
+    pending = requested;
+    requested = false;
+    cnt_uplinks++;
+    mutex_unlock(&link_adapt_mutex);
+#endif
+}
+
+void link_adapt_link_check(semtech_loramac_t *loramac, bool adr_on, uint8_t demod_margin)
+{
+    mutex_lock(&link_adapt_mutex);
+    requested = false;
+    pending = false;
+    missed = 0;
+
+    if (margin_valid) {
+        margin_q4 += (Q4(demod_margin) - margin_q4) >> LINK_ADAPT_EWMA_SHIFT;
+    } else {
+        margin_q4 = Q4(demod_margin);
+        margin_valid = true;
+    }
+
+    if (adr_on) {
+        // the network drives the DR and the TX power
+        mutex_unlock(&link_adapt_mutex);
+        return;
+    }
+
+    uint8_t dr = semtech_loramac_get_dr(loramac);
+    int16_t target_q4 = Q4(LINK_ADAPT_TARGET_MARGIN_DB);
+
+    if (margin_q4 >= target_q4 + Q4(LINK_ADAPT_DR_STEP_DB) && dr < LINK_ADAPT_MAX_DR) {
+        // the largest energy saving: shorter time on air
+        dr++;
+        semtech_loramac_set_dr(loramac, dr);
+        margin_q4 -= Q4(LINK_ADAPT_DR_STEP_DB);
+        DEBUG("[link] margin=%d dB: dr up to %d\n", margin_q4 / 16, dr);
+    } else if (margin_q4 >= target_q4 + Q4(LINK_ADAPT_POWER_STEP_DB) && tx_power_idx < LINK_ADAPT_MAX_TX_POWER_IDX) {
+        tx_power_idx++;
+        semtech_loramac_set_tx_power(loramac, tx_power_idx);
+        margin_q4 -= Q4(LINK_ADAPT_POWER_STEP_DB);
+        DEBUG("[link] margin=%d dB: tx power index up to %d\n", margin_q4 / 16, tx_power_idx);
+    } else if (margin_q4 < target_q4 && tx_power_idx > 0) {
+        tx_power_idx--;
+        semtech_loramac_set_tx_power(loramac, tx_power_idx);
+        margin_q4 += Q4(LINK_ADAPT_POWER_STEP_DB);
+        DEBUG("[link] margin=%d dB: tx power index down to %d\n", margin_q4 / 16, tx_power_idx);
+    } else if (margin_q4 < target_q4 && dr > 0) {
+        dr--;
+        semtech_loramac_set_dr(loramac, dr);
+        margin_q4 += Q4(LINK_ADAPT_DR_STEP_DB);
+        DEBUG("[link] margin=%d dB: dr down to %d\n", margin_q4 / 16, dr);
+    }
+    mutex_unlock(&link_adapt_mutex);
+}
+
+void link_adapt_print(void)
+{
+    mutex_lock(&link_adapt_mutex);
+    printf("[link] margin=%d dB (%s) tx power index=%d missed=%d\n",
+           margin_q4 / 16, margin_valid ? "valid" : "unknown", tx_power_idx, missed);
+    mutex_unlock(&link_adapt_mutex);
+}
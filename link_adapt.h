@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Device-side adaptation of the DR and the TX power to the link margin.
+ *
+ * A LinkCheckReq is piggybacked every LINK_ADAPT_CHECK_PERIOD uplinks. The margins of the
+ * LinkCheckAns are smoothed (EWMA): when the smoothed margin exceeds the target margin,
+ * the DR is raised first (shorter time on air), then the TX power is reduced. Below the
+ * target, the TX power is restored first, then the DR is lowered. After
+ * LINK_ADAPT_MAX_MISSED unanswered LinkCheckReq, the endpoint steps down quickly to the
+ * max TX power and a lower DR. Only the transmitted uplinks (TX_DONE or TX_CNF_FAILED)
+ * are counted: a LinkCheckReq of an uplink which is not sent is requested again.
+ *
+ * When the network ADR is enabled, the network drives the DR and the TX power: only the
+ * fast step-down on loss is applied.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef LINK_ADAPT_H
+#define LINK_ADAPT_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "semtech_loramac.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Number of uplinks between two LinkCheckReq (0 for disabling the controller)
+ */
+#ifndef LINK_ADAPT_CHECK_PERIOD
+#define LINK_ADAPT_CHECK_PERIOD         (10U)
+#endif
+
+/*
+ * Target link margin (in dB above the demodulation floor)
+ */
+#ifndef LINK_ADAPT_TARGET_MARGIN_DB
+#define LINK_ADAPT_TARGET_MARGIN_DB     (10U)
+#endif
+
+/*
+ * Number of consecutive unanswered LinkCheckReq before the fast step-down
+ */
+#ifndef LINK_ADAPT_MAX_MISSED
+#define LINK_ADAPT_MAX_MISSED           (2U)
+#endif
+
+/*
+ * Max DR used by the controller (DR5 is SF7BW125 in EU868)
+ */
+#ifndef LINK_ADAPT_MAX_DR
+#define LINK_ADAPT_MAX_DR               (5U)
+#endif
+
+/*
+ * Max EIRP (in dBm) of the region: TX power index 0 (16 dBm in EU868)
+ */
+#ifndef LINK_ADAPT_MAX_EIRP_DBM
+#define LINK_ADAPT_MAX_EIRP_DBM         (16U)
+#endif
+
+/*
+ * Min TX power (max TX power index) of the region (index 7 = 2 dBm in EU868)
+ */
+#ifndef LINK_ADAPT_MAX_TX_POWER_IDX
+#define LINK_ADAPT_MAX_TX_POWER_IDX     (7U)
+#endif
+
+/**
+ * Apply the initial TX power
+ *
+ * @param loramac   the loramac descriptor
+ * @param dbm       the initial TX power (EIRP in dBm)
+ */
+void link_adapt_init(semtech_loramac_t *loramac, uint8_t dbm);
+
+/**
+ * Request a LinkCheckReq every LINK_ADAPT_CHECK_PERIOD uplinks (to call before the uplink)
+ *
+ * @param loramac   the loramac descriptor
+ */
+void link_adapt_before_uplink(semtech_loramac_t *loramac);
+
+/**
+ * Count the uplink and its LinkCheckReq if the uplink is transmitted (to call after the uplink)
+ *
+ * @param ret       the return code of the send
+ */
+void link_adapt_after_uplink(uint8_t ret);
+
+/**
+ * Process the LinkCheckAns (to call by the receiver)
+ *
+ * @param loramac       the loramac descriptor
+ * @param adr_on        true if the network ADR is enabled
+ * @param demod_margin  the demodulation margin in dB
+ */
+void link_adapt_link_check(semtech_loramac_t *loramac, bool adr_on, uint8_t demod_margin);
+
+/**
+ * Print the state of the controller
+ */
+void link_adapt_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Liveness monitor of the tasks of the endpoint.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "irq.h"
+#include "periph/pm.h"
+#include "ztimer.h"
+
+#include "liveness.h"
+
+#define LIVENESS_NAME_MAX_LEN           (15U)
+
+// "LIVE"
+#define LIVENESS_NOINIT_MAGIC           (0x4556494CUL)
+
+typedef struct {
+    const char *name;
+    uint32_t max_busy_ms;
+    uint32_t current_max_busy_ms;
+    ztimer_now_t busy_since;
+    bool busy;
+} liveness_entry_t;
+
+static liveness_entry_t tasks[LIVENESS_TASK_NUMOF];
+
+/*
+ * The no-init RAM is not cleared by the startup code: the record survives a software or watchdog reset
+ */
+typedef struct {
+    uint32_t magic;
+    char name[LIVENESS_NAME_MAX_LEN + 1];
+} liveness_noinit_t;
+
+static liveness_noinit_t stuck_task __attribute__((section(".noinit")));
+
+void liveness_register(liveness_task_t task, const char *name, uint32_t max_busy_ms)
+{
+    if (task >= LIVENESS_TASK_NUMOF) {
+        return;
+    }
+    unsigned state = irq_disable();
+    tasks[task].name = name;
+    tasks[task].max_busy_ms = max_busy_ms;
+    tasks[task].busy = false;
+    irq_restore(state);
+    DEBUG("[liveness] register %s (max busy %ld msec)\n", name, max_busy_ms);
+}
+
+void liveness_busy_for(liveness_task_t task, uint32_t max_busy_ms)
+{
+    if (task >= LIVENESS_TASK_NUMOF) {
+        return;
+    }
+    ztimer_now_t now = ztimer_now(ZTIMER_MSEC);
+    unsigned state = irq_disable();
+    tasks[task].busy_since = now;
+    tasks[task].current_max_busy_ms = max_busy_ms;
+    tasks[task].busy = true;
+    irq_restore(state);
+}
+
+void liveness_busy(liveness_task_t task)
+{
+    if (task >= LIVENESS_TASK_NUMOF) {
+        return;
+    }
+    liveness_busy_for(task, tasks[task].max_busy_ms);
+}
+
+void liveness_idle(liveness_task_t task)
+{
+    if (task >= LIVENESS_TASK_NUMOF) {
+        return;
+    }
+    tasks[task].busy = false;
+}
+
+const char *liveness_check(void)
+{
+    ztimer_now_t now = ztimer_now(ZTIMER_MSEC);
+    for (unsigned i = 0; i < LIVENESS_TASK_NUMOF; i++) {
+        unsigned state = irq_disable();
+        liveness_entry_t entry = tasks[i];
+        irq_restore(state);
+
+        if (entry.name != NULL && entry.busy && now - entry.busy_since > entry.current_max_busy_ms) {
+            DEBUG("[liveness] %s is stuck since %ld msec\n", entry.name, now - entry.busy_since);
+            return entry.name;
+        }
+    }
+    return NULL;
+}
+
+void liveness_reboot(const char *name)
+{
+    stuck_task.magic = LIVENESS_NOINIT_MAGIC;
+    strncpy(stuck_task.name, name, LIVENESS_NAME_MAX_LEN);
+    stuck_task.name[LIVENESS_NAME_MAX_LEN] = '\0';
+    DEBUG("[liveness] rebooting now ...\n");
+    pm_reboot();
+}
+
+void liveness_report_reboot(void)
+{
+    if (stuck_task.magic == LIVENESS_NOINIT_MAGIC) {
+        stuck_task.name[LIVENESS_NAME_MAX_LEN] = '\0';
+        printf("[liveness] previous reboot caused by the stuck task: %s\n", stuck_task.name);
+    } else {
+        DEBUG("[liveness] no stuck task before the reboot\n");
+    }
+    stuck_task.magic = 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Liveness monitor of the tasks of the endpoint.
+ *
+ * Each task declares the max duration of its busy periods. A task is busy when it processes
+ * an event (a send, a downlink, a sensor frame ...) and idle when it waits for an event
+ * (sleep, semtech_loramac_recv, msg_receive ...). A task which stays busy longer than its
+ * max duration is stuck: the watchdog is not kicked anymore and the board is rebooted.
+ * The name of the stuck task is kept into the no-init RAM and reported after the reboot.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef LIVENESS_H
+#define LIVENESS_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Max duration (in msec) of the busy periods of the tasks
+ */
+/*
+ * The sender kicks the watchdog: its max busy duration is below the timeout of the watchdog
+ * (minus the margin) so that a stuck sender is reported before the reset
+ */
+#ifndef LIVENESS_SENDER_MAX_BUSY_MS
+#define LIVENESS_SENDER_MAX_BUSY_MS         (25000U)
+#endif
+
+/*
+ * Max duration (in msec) of a confirmed uplink: the retransmissions of the MAC (with their
+ * duty-cycle waits) are done into the semtech_loramac_send call
+ */
+#ifndef LIVENESS_SENDER_MAX_CNF_SEND_MS
+#define LIVENESS_SENDER_MAX_CNF_SEND_MS     (300000U)
+#endif
+
+#ifndef LIVENESS_RECEIVER_MAX_BUSY_MS
+#define LIVENESS_RECEIVER_MAX_BUSY_MS       (30000U)
+#endif
+
+#ifndef LIVENESS_PMS7003_MAX_BUSY_MS
+#define LIVENESS_PMS7003_MAX_BUSY_MS        (10000U)
+#endif
+
+#ifndef LIVENESS_GPS_MAX_BUSY_MS
+#define LIVENESS_GPS_MAX_BUSY_MS            (30000U)
+#endif
+
+/**
+ * Identifiers of the monitored tasks
+ */
+typedef enum {
+    LIVENESS_TASK_SENDER    = 0,
+    LIVENESS_TASK_RECEIVER  = 1,
+    LIVENESS_TASK_PMS7003   = 2,
+    LIVENESS_TASK_GPS       = 3,
+    LIVENESS_TASK_NUMOF
+} liveness_task_t;
+
+/**
+ * Register a task (the task is idle after the registration)
+ *
+ * @param task          the identifier of the task
+ * @param name          the name of the task
+ * @param max_busy_ms   the max duration of a busy period in milliseconds
+ */
+void liveness_register(liveness_task_t task, const char *name, uint32_t max_busy_ms);
+
+/**
+ * Mark a task as busy (or renew its busy period). Can be called from an ISR.
+ *
+ * @param task          the identifier of the task
+ */
+void liveness_busy(liveness_task_t task);
+
+/**
+ * Mark a task as busy for a longer period than its max duration (a blocking call with a known timeout)
+ *
+ * @param task          the identifier of the task
+ * @param max_busy_ms   the max duration of this busy period in milliseconds
+ */
+void liveness_busy_for(liveness_task_t task, uint32_t max_busy_ms);
+
+/**
+ * Mark a task as idle (waiting for an event). Can be called from an ISR.
+ *
+ * @param task          the identifier of the task
+ */
+void liveness_idle(liveness_task_t task);
+
+/**
+ * Check the liveness of the registered tasks
+ *
+ * @return the name of the first stuck task or NULL if all the tasks are live
+ */
+const char *liveness_check(void);
+
+/**
+ * Save the name of the stuck task into the no-init RAM and reboot
+ *
+ * @param name          the name of the stuck task
+ */
+void liveness_reboot(const char *name);
+
+/**
+ * Report the stuck task which caused the previous reboot (if any)
+ */
+void liveness_report_reboot(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
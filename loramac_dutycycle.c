@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       LoRa time-on-air calculator and duty-cycle budget scheduler.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include "ztimer.h"
+
+#include "loramac_dutycycle.h"
+
+#define LORA_PREAMBLE_LEN               (8U)
+#define LORA_CODING_RATE_4_5            (1U)
+
+#define FSK_BITRATE_KBPS                (50U)
+// preamble (5) + sync word (3) + length (1) + CRC (2)
+#define FSK_OVERHEAD                    (5U + 3U + 1U + 2U)
+
+/*
+ * The 1% sub-bands of EU868: the off-time after a transmission is ToA * 99
+ */
+#if defined(REGION_EU868) && (!defined(EU868_DUTY_CYCLE_ENABLED) || EU868_DUTY_CYCLE_ENABLED == 1)
+#define DUTYCYCLE_DIVISOR               (100U)
+#else
+// No duty-cycle restriction
+#define DUTYCYCLE_DIVISOR               (0U)
+#endif
+
+typedef struct {
+    /*
+     * @brief true if a transmission has been registered in the band
+     */
+    bool used;
+
+    /*
+     * @brief Time (ZTIMER_MSEC) from which the band is available again
+     */
+    ztimer_now_t ready_at;
+} dutycycle_band_t;
+
+static dutycycle_band_t bands[LORAMAC_DUTYCYCLE_NB_BANDS];
+
+/* wrap-around safe comparison of ztimer_now_t */
+static inline int32_t _diff(ztimer_now_t a, ztimer_now_t b)
+{
+    return (int32_t)(a - b);
+}
+
+uint32_t loramac_dutycycle_lora_time_on_air(uint8_t sf, uint16_t bw_khz, uint8_t cr,
+        uint16_t preamble_len, uint8_t phy_payload_len,
+        bool crc_on, bool implicit_header, bool low_dr_optimize)
+{
+    /* symbol duration in microseconds: exact for all SF and BW in 125, 250, 500 kHz */
+    uint32_t t_sym_us = ((uint32_t)1 << sf) * 1000U / bw_khz;
+
+    int32_t num = 8 * (int32_t)phy_payload_len - 4 * (int32_t)sf + 28
+            + (crc_on ? 16 : 0) - (implicit_header ? 20 : 0);
+    int32_t den = 4 * ((int32_t)sf - (low_dr_optimize ? 2 : 0));
+
+    uint32_t payload_symb_nb = 8;
+    if (num > 0) {
+        payload_symb_nb += ((num + den - 1) / den) * (cr + 4);
+    }
+
+    /* (preamble + 4.25 + payload) symbols, counted in quarters of symbol */
+    uint32_t quarter_symb_nb = 4 * (uint32_t)preamble_len + 17 + 4 * payload_symb_nb;
+
+    return (quarter_symb_nb * t_sym_us) / 4;
+}
+
+uint32_t loramac_dutycycle_time_on_air_ms(uint8_t dr, uint8_t app_payload_len)
+{
+    uint8_t phy_payload_len = app_payload_len + LORAMAC_DUTYCYCLE_MAC_OVERHEAD;
+    uint8_t sf;
+    uint16_t bw_khz = 125;
+
+#if defined(REGION_US915)
+    switch (dr) {
+        case 0: sf = 10; break;
+        case 1: sf = 9; break;
+        case 2: sf = 8; break;
+        case 3: sf = 7; break;
+        case 4: sf = 8; bw_khz = 500; break;
+        default: sf = 7; bw_khz = 500; break;
+    }
+#elif defined(REGION_AU915)
+    /* DR0..DR5: SF12..SF7 at 125 kHz, DR6: SF8 at 500 kHz */
+    if (dr == 6) {
+        sf = 8;
+        bw_khz = 500;
+    } else {
+        sf = 12 - (dr > 5 ? 5 : dr);
+    }
+#else
+    if (dr == 7) {
+        /* FSK 50 kbps: 8 bits per byte */
+        return ((FSK_OVERHEAD + phy_payload_len) * 8 + FSK_BITRATE_KBPS - 1) / FSK_BITRATE_KBPS;
+    }
+    if (dr == 6) {
+        sf = 7;
+        bw_khz = 250;
+    } else {
+        sf = 12 - (dr > 5 ? 5 : dr);
+    }
+#endif
+
+    /* the low data rate optimization is mandatory when the symbol duration exceeds 16 ms */
+    bool ldro = (bw_khz == 125 && sf >= 11);
+
+    uint32_t toa_us = loramac_dutycycle_lora_time_on_air(sf, bw_khz, LORA_CODING_RATE_4_5,
+            LORA_PREAMBLE_LEN, phy_payload_len, true, false, ldro);
+
+    return (toa_us + 999) / 1000;
+}
+
+uint8_t loramac_dutycycle_max_payload_len(uint8_t dr)
+{
+#if defined(REGION_US915)
+    static const uint8_t max_len[] = { 11, 53, 125, 242, 242 };
+#else
+    static const uint8_t max_len[] = { 51, 51, 51, 115, 242, 242, 242, 242 };
+#endif
+    return (dr < sizeof(max_len)) ? max_len[dr] : max_len[sizeof(max_len) - 1];
+}
+
+void loramac_dutycycle_register_tx(uint8_t dr, uint8_t app_payload_len, ztimer_now_t start)
+{
+    uint32_t toa = loramac_dutycycle_time_on_air_ms(dr, app_payload_len);
+
+    if (DUTYCYCLE_DIVISOR == 0) {
+        DEBUG("[dc] tx dr=%d size=%d toa=%ld ms\n", dr, app_payload_len, toa);
+        return;
+    }
+
+    /* the MAC uses a band which is available: take the earliest one */
+    unsigned b = 0;
+    for (unsigned i = 1; i < LORAMAC_DUTYCYCLE_NB_BANDS; i++) {
+        if (!bands[i].used || (bands[b].used && _diff(bands[i].ready_at, bands[b].ready_at) < 0)) {
+            b = i;
+        }
+    }
+
+    bands[b].used = true;
+    bands[b].ready_at = start + toa * DUTYCYCLE_DIVISOR;
+
+    DEBUG("[dc] tx dr=%d size=%d toa=%ld ms band=%d off=%ld ms\n",
+          dr, app_payload_len, toa, b, toa * DUTYCYCLE_DIVISOR);
+}
+
+uint32_t loramac_dutycycle_next_tx_delay(ztimer_now_t last_tx_start, uint32_t target_period_ms, ztimer_now_t now)
+{
+    ztimer_now_t next = last_tx_start + target_period_ms;
+
+    if (DUTYCYCLE_DIVISOR != 0) {
+        /* earliest instant at which one of the bands becomes available */
+        bool found = false;
+        ztimer_now_t ready = now;
+        for (unsigned i = 0; i < LORAMAC_DUTYCYCLE_NB_BANDS; i++) {
+            if (!bands[i].used) {
+                ready = now;
+                found = true;
+                break;
+            }
+            if (!found || _diff(bands[i].ready_at, ready) < 0) {
+                ready = bands[i].ready_at;
+                found = true;
+            }
+        }
+        if (_diff(ready, next) > 0) {
+            DEBUG("[dc] target period delayed by %ld ms for the duty-cycle\n", _diff(ready, next));
+            next = ready;
+        }
+    }
+
+    int32_t delay = _diff(next, now);
+    return delay > 0 ? (uint32_t)delay : 0;
+}
+
+void loramac_dutycycle_print(void)
+{
+    ztimer_now_t now = ztimer_now(ZTIMER_MSEC);
+    DEBUG("[dc] duty-cycle divisor=%d bands=%d\n", DUTYCYCLE_DIVISOR, LORAMAC_DUTYCYCLE_NB_BANDS);
+    for (unsigned i = 0; i < LORAMAC_DUTYCYCLE_NB_BANDS; i++) {
+        int32_t wait = bands[i].used ? _diff(bands[i].ready_at, now) : 0;
+        DEBUG("[dc] band %d: available in %ld ms\n", i, wait > 0 ? wait : 0);
+    }
+}
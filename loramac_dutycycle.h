@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     pkg_semtech_loramac
+ * @{
+ *
+ * @file
+ * @brief       LoRa time-on-air calculator and duty-cycle budget scheduler.
+ *
+ * The scheduler mirrors the per-band off-time enforced by the LoRaMac stack
+ * (TimeOff = ToA * (1/DutyCycle)) so that the application never wakes up only
+ * to get SEMTECH_LORAMAC_DUTYCYCLE_RESTRICTED.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef LORAMAC_DUTYCYCLE_H
+#define LORAMAC_DUTYCYCLE_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "ztimer.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Number of sub-bands (with the same duty-cycle) used by the enabled channels.
+ * The 3 default EU868 channels (868.1, 868.3, 868.5 MHz) share a single 1% sub-band.
+ * Set to 2 when the network adds the 867.1-867.9 MHz channels with the CFList.
+ */
+#ifndef LORAMAC_DUTYCYCLE_NB_BANDS
+#define LORAMAC_DUTYCYCLE_NB_BANDS          (1U)
+#endif
+
+/*
+ * Number of bytes added by the LoRaWAN MAC layer to the application payload
+ * MHDR (1) + FHDR (7 without FOpts) + FPort (1) + MIC (4)
+ */
+#define LORAMAC_DUTYCYCLE_MAC_OVERHEAD      (13U)
+
+/**
+ * Compute the time on air of a LoRa frame (Semtech AN1200.13)
+ *
+ * @param sf                spreading factor (6 to 12)
+ * @param bw_khz            bandwidth in kHz (125, 250 or 500)
+ * @param cr                coding rate (1 for 4/5 to 4 for 4/8)
+ * @param preamble_len      number of programmed preamble symbols
+ * @param phy_payload_len   PHY payload length in bytes
+ * @param crc_on            true if the payload CRC is present
+ * @param implicit_header   true if the header is implicit
+ * @param low_dr_optimize   true if the low data rate optimization is enabled
+ *
+ * @return the time on air in microseconds
+ */
+uint32_t loramac_dutycycle_lora_time_on_air(uint8_t sf, uint16_t bw_khz, uint8_t cr,
+        uint16_t preamble_len, uint8_t phy_payload_len,
+        bool crc_on, bool implicit_header, bool low_dr_optimize);
+
+/**
+ * Compute the time on air of an uplink for the current region
+ *
+ * @param dr                the datarate of the uplink
+ * @param app_payload_len   the application payload length (FRMPayload) in bytes
+ *
+ * @return the time on air in milliseconds (rounded up)
+ */
+uint32_t loramac_dutycycle_time_on_air_ms(uint8_t dr, uint8_t app_payload_len);
+
+/**
+ * Get the max application payload length (FRMPayload without FOpts) of an uplink for the current region
+ *
+ * @param dr                the datarate of the uplink
+ *
+ * @return the max length in bytes (N of the Regional Parameters, no repeater)
+ */
+uint8_t loramac_dutycycle_max_payload_len(uint8_t dr);
+
+/**
+ * Register a transmission into the duty-cycle budget
+ *
+ * @param dr                the datarate of the uplink
+ * @param app_payload_len   the application payload length in bytes
+ * @param start             the start time of the transmission (ZTIMER_MSEC)
+ */
+void loramac_dutycycle_register_tx(uint8_t dr, uint8_t app_payload_len, ztimer_now_t start);
+
+/**
+ * Get the number of milliseconds to wait before the next transmission
+ * respecting both the duty-cycle budget and the target period
+ *
+ * @param last_tx_start     the start time of the previous transmission (ZTIMER_MSEC)
+ * @param target_period_ms  the configured target period between two transmissions
+ * @param now               the current time (ZTIMER_MSEC)
+ *
+ * @return the delay in milliseconds (0 if the transmission can start now)
+ */
+uint32_t loramac_dutycycle_next_tx_delay(ztimer_now_t last_tx_start, uint32_t target_period_ms, ztimer_now_t now);
+
+/**
+ * Print the state of the duty-cycle budget
+ */
+void loramac_dutycycle_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
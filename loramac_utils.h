@@ -23,6 +23,8 @@
 
 #include <inttypes.h>
 
+#include "ztimer.h"
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -41,6 +43,13 @@ extern "C"
      */
     void loramac_utils_sleep_adaptative_period_dr(semtech_loramac_t* loramac, uint32_t tx_period_at_dr0);
 
+    /*
+     * Sleep until the next transmission: the period according the current Data Rate
+     * is counted from the start of the last transmission (with the jitter of the TX slot)
+     * and is extended when the duty-cycle budget of the sub-bands is exhausted
+     */
+    void loramac_utils_sleep_next_tx(semtech_loramac_t* loramac, uint32_t tx_period_at_dr0, ztimer_now_t last_tx_start);
+
     const char* loramac_utils_get_lorawan_network(const uint32_t devaddr);
 
     void printf_ba(const uint8_t* ba, size_t len);
@@ -17,7 +17,6 @@
 #include <string.h>
 
 //#include "xtimer.h"
-#include <time.h>
 
 #include "ztimer.h"
 #include "ztimer/periodic.h"
@@ -37,14 +36,37 @@
 //#include "net/loramac.h"
 #include "semtech_loramac.h"
 #include "loramac_utils.h"
+#include "loramac_dutycycle.h"
 
 #include "git_utils.h"
 //#include "wdt_utils.h"
 #include "wdt_ztimer.h"
 
 #include "sensors.h"
+#if GPS == 1
+#include "gps_mgr.h"
+#endif
 
 #include "app_clock.h"
+#include "timebase.h"
+
+#include "persist.h"
+#include "config.h"
+#include "sched_action.h"
+#include "cnf_policy.h"
+#include "liveness.h"
+#include "stats.h"
+#include "tx_slot.h"
+#include "session.h"
+#include "join_sched.h"
+#include "link_adapt.h"
+#ifdef DRPWSZ_SEQUENCE
+#include "drpwsz.h"
+#endif
+
+#if ENABLE_SHELL == 1
+#include "shell.h"
+#endif
 
 #include <random.h>
 
@@ -55,23 +77,45 @@ extern semtech_loramac_t loramac;
 #define CNT(array) (uint8_t)(sizeof(array) / sizeof(*array))
 
 /* LoRaMac values */
-#define JOIN_NEXT_RETRY_TIME            10 // Next join tentative in 1 minute
+#define JOIN_NEXT_RETRY_TIME            10 // First backoff window of the join retries (in seconds)
 #define SECONDS_PER_DAY                 24 * 60 * 60
 
 /* Use a fast datarate, e.g. BW125/SF7 in EU868 */
 #define DR_INIT                         LORAMAC_DR_5
 
-#define FIRST_TX_PERIOD                 TXPERIOD_AT_DR0
-#define TX_PERIOD                       TXPERIOD_AT_DR0
-
 #define PORT_UP_DATA                    101
 #define PORT_UP_ERROR                   102
 
+/* Flag of the first byte of the data payload: the payload ends with a clock sync trailer */
+#define FLAG_CLOCK_TRAILER              0x80
+
 #define PORT_DN_TEXT                    101
 #define PORT_DN_SET_TX_PERIOD           3
+#define PORT_DN_CONFIG                  4
 #define PORT_DN_REBOOT_NOW           	64
 #define PORT_DN_REBOOT_ONE_MINUTE       65
 #define PORT_DN_REBOOT_ONE_HOUR         66
+#define PORT_DN_SCHEDULE_ACTION         67
+#define PORT_DN_CANCEL_ACTION           68
+#define PORT_DN_CLASS_C_WINDOW          69
+
+/* Default and max duration (in seconds) of the Class C window opened by PORT_DN_CLASS_C_WINDOW */
+#ifndef CLASS_C_WINDOW_DEFAULT_SEC
+#define CLASS_C_WINDOW_DEFAULT_SEC      (300U)
+#endif
+#ifndef CLASS_C_WINDOW_MAX_SEC
+#define CLASS_C_WINDOW_MAX_SEC          (3600U)
+#endif
+
+/* Initial TX power (EIRP in dBm) */
+#ifndef TX_POWER
+#define TX_POWER                        (14U)
+#endif
+
+/* Window (in seconds) of the phase of the first transmission after the first measure (see tx_slot) */
+#ifndef TX_SLOT_FIRST_WINDOW_SEC
+#define TX_SLOT_FIRST_WINDOW_SEC        (30U)
+#endif
 
 /* Implement the receiver thread */
 #define RECEIVER_MSG_QUEUE                          (4U)
@@ -99,91 +143,196 @@ static uint8_t nwkskey[LORAMAC_APPSKEY_LEN] ;
 static msg_t _receiver_queue[RECEIVER_MSG_QUEUE];
 static char _receiver_stack[THREAD_STACKSIZE_DEFAULT];
 
-static uint16_t tx_period = TX_PERIOD;
 
 
+static bool rebooting = false;
 
-#if GUARD_SENDER_WAKEUP == 1
+#if APP_CLOCK_SYNC == 1
+static bool clock_resync_requested = false;
+#endif
 
-// Add a guard since the sender thread can be stuck into the semtech_loramac_send call
+static void _reboot_action(sched_action_id_t id)
+{
+    (void)id;
+    DEBUG("[sched] rebooting now ...\n");
+    rebooting = true;
+    pm_reboot();
+}
 
-// TODO add a loramac_utils_guarded_semtech_loramac_send
+/*
+ * Propagate a new configuration to the MAC and the sensors
+ */
+static void _config_changed(int8_t ret)
+{
+    if (ret != CONFIG_OK && ret != CONFIG_ERROR_PERSIST) {
+        DEBUG("[config] rejected: %d\n", ret);
+        return;
+    }
+    if (ret == CONFIG_ERROR_PERSIST) {
+        // the values are applied into the RAM: the MAC and the sensors should use them
+        DEBUG("[config] applied but not saved\n");
+    }
+    semtech_loramac_set_adr(&loramac, config.adr_on);
+    sensors_apply_config();
+}
 
-static ztimer_now_t start_time=0;
+static void _config_apply_action(sched_action_id_t id)
+{
+    (void)id;
+    _config_changed(config_apply_staged());
+}
+
+static void _clock_resync_action(sched_action_id_t id)
+{
+    (void)id;
+#if APP_CLOCK_SYNC == 1
+    // the AppTimeReq is piggybacked into the next data frame
+    clock_resync_requested = true;
+#endif
+}
 
-static kernel_pid_t sender_pid;
+static void _class_revert_action(sched_action_id_t id)
+{
+    (void)id;
+    DEBUG("[sched] back to the endpoint class\n");
+    semtech_loramac_set_class(&loramac, ENDPOINT_CLASS);
+    stats_class_c_end();
+}
 
-static ztimer_periodic_t _wakeup_sender_ztimer; // = { 0 };
+/* End (ZTIMER_SEC) of the Class C window in progress */
+static ztimer_now_t class_c_window_end;
 
-static bool _wakeup_sender_cb(void *arg)
+/*
+ * Payload of PORT_DN_CLASS_C_WINDOW: [duration in sec (2 bytes, little endian)]
+ * The endpoint stays in Class C during the window for receiving the next commands within seconds.
+ * A new window extends the window in progress (the later of the two ends is kept).
+ */
+static void _class_c_window_downlink(const uint8_t *payload, uint8_t len)
 {
-	(void)arg;
-    //printf("[%s] enter\n", __FUNCTION__);
-    if(start_time != 0)
-    {
-    	ztimer_now_t delta = ztimer_now(ZTIMER_MSEC) - start_time;
-        if(delta > GUARD_SENDER_TIMEOUT_MS)
-        {
-            DEBUG("[%s] timeout after %ld ms\n", __FUNCTION__, delta);
-#if 0
-            DEBUG("[%s] wake up sender\n", __FUNCTION__);
-            thread_wakeup(sender_pid); // REM: thread_wakeup seems to have no effect
-#else
-            DEBUG("[%s] rebooting now ...\n", __FUNCTION__);
-            pm_reboot();
-#endif
-        } else {
-            DEBUG("[%s] delta: %ld ms\n", __FUNCTION__, delta);
+    uint32_t duration = CLASS_C_WINDOW_DEFAULT_SEC;
+    if (len >= sizeof(uint16_t)) {
+        duration = payload[0] | (payload[1] << 8);
+    }
+    if (duration > CLASS_C_WINDOW_MAX_SEC) {
+        duration = CLASS_C_WINDOW_MAX_SEC;
+    }
+    if (duration == 0) {
+        // close the window now
+        if (sched_action_cancel(SCHED_ACTION_CLASS_REVERT)) {
+            _class_revert_action(SCHED_ACTION_CLASS_REVERT);
         }
+        return;
     }
-	// function to call on each trigger returns true if the timer should keep going
-    return true;
+    ztimer_now_t now = ztimer_now(ZTIMER_SEC);
+    if (sched_action_is_pending(SCHED_ACTION_CLASS_REVERT)
+        && (int32_t)(class_c_window_end - (now + duration)) >= 0) {
+        // a shorter window does not shorten the window in progress
+        DEBUG("[dn] Class C window kept for %ld sec\n", (int32_t)(class_c_window_end - now));
+        return;
+    }
+    DEBUG("[dn] Class C window for %ld sec\n", duration);
+    class_c_window_end = now + duration;
+    semtech_loramac_set_class(&loramac, LORAMAC_CLASS_C);
+    stats_class_c_start();
+    sched_action_schedule(SCHED_ACTION_CLASS_REVERT, duration);
 }
 
-static int wakeup_sender_ztimer(void) {
-
-	// check the guard every 10 seconds
-    ztimer_periodic_init(ZTIMER_SEC, &_wakeup_sender_ztimer, _wakeup_sender_cb, (void*)NULL, GUARD_SENDER_CHECK_PERIOD_S);
-    ztimer_periodic_start(&_wakeup_sender_ztimer);
-
-    if (!ztimer_is_set(ZTIMER_SEC, &_wakeup_sender_ztimer.timer)) {
-    	printf("[%s] ERROR\n", __FUNCTION__);
-        return -1;
+/*
+ * Payload of PORT_DN_SCHEDULE_ACTION: <action id (1 byte)><delay in sec (4 bytes, little endian)>[arguments]
+ * The arguments of SCHED_ACTION_CONFIG_APPLY are the TLV of the configuration.
+ */
+static void _schedule_action_downlink(const uint8_t *payload, uint8_t len)
+{
+    if (len < 1 + sizeof(uint32_t)) {
+        DEBUG("[dn] Schedule action: bad size\n");
+        return;
     }
-    DEBUG("[%s] started\n", __FUNCTION__);
+    sched_action_id_t id = payload[0];
+    uint32_t delay_sec = payload[1] | (payload[2] << 8) | (payload[3] << 16) | ((uint32_t)payload[4] << 24);
 
-	return 0;
+    if (id == SCHED_ACTION_CONFIG_APPLY
+        && config_stage_tlv(payload + 5, len - 5) != CONFIG_OK) {
+        DEBUG("[dn] Schedule action: config rejected\n");
+        return;
+    }
+    if (sched_action_schedule(id, delay_sec) != SCHED_ACTION_OK) {
+        DEBUG("[dn] Schedule action: unknown action %d\n", id);
+    }
 }
 
-#endif
-
+/*
+ * The sender is idle (not monitored by the liveness monitor) during the sleep
+ */
+static void _sender_sleep_next_tx(ztimer_now_t tx_start)
+{
+    liveness_idle(LIVENESS_TASK_SENDER);
+    loramac_utils_sleep_next_tx(&loramac, config.txperiod_at_dr0, tx_start);
+    liveness_busy(LIVENESS_TASK_SENDER);
+}
 
+/*
+ * The restored session is unknown by the network server: rejoin after the reboot
+ */
+static void _rejoin_if_invalid_session(void)
+{
+    if (!session_valid()) {
+        DEBUG("[sender] rebooting for rejoining ...\n");
+        rebooting = true;
+        pm_reboot();
+    }
+}
 
-static bool rebooting = false;
+static void _send_stats(ztimer_now_t *tx_start)
+{
+    uint8_t buf[STATS_UPLINK_MAX_SIZE];
+    uint8_t size = stats_encode(buf);
+    DEBUG("[sender] Send stats @ port=%d size=%d\n", STATS_PORT, size);
+
+    semtech_loramac_set_tx_mode(&loramac, LORAMAC_TX_UNCNF);
+    semtech_loramac_set_tx_port(&loramac, STATS_PORT);
+
+    uint8_t dr = semtech_loramac_get_dr(&loramac);
+    *tx_start = ztimer_now(ZTIMER_MSEC);
+    stats_tx_start(dr, size);
+    liveness_busy(LIVENESS_TASK_SENDER);
+    session_before_uplink(&loramac);
+    uint8_t ret = semtech_loramac_send(&loramac, buf, size);
+    wdt_ztimer_kick();
+    session_after_uplink(&loramac, ret);
+    stats_tx_end(ret);
+    if (ret == SEMTECH_LORAMAC_TX_DONE || ret == SEMTECH_LORAMAC_TX_CNF_FAILED) {
+        loramac_dutycycle_register_tx(dr, size, *tx_start);
+    } else {
+        DEBUG("[sender] ERROR: Cannot send stats: ret code: %d (%s)\n", ret, loramac_utils_err_message(ret));
+    }
+}
 
 static void sender(void)
 {
 
-#if GUARD_SENDER_WAKEUP == 1
-	sender_pid = thread_getpid();
-    wakeup_sender_ztimer();
-#endif
+    liveness_register(LIVENESS_TASK_SENDER, "sender", LIVENESS_SENDER_MAX_BUSY_MS);
+    liveness_busy(LIVENESS_TASK_SENDER);
+
+    // the first transmission is delayed by the phase of the endpoint into a short window after the first
+    // measure: the warm-up of the sensors (as long as the window) would synchronize the endpoints again
+    bool first_frame = true;
 
     uint32_t cnt_sent_messages=0;
+    uint32_t cnt_data_frames=0;
     uint8_t payload[241];
+    // error flags of the previous frame: a change is an alarm
+    uint8_t last_error_flags = 0;
 
     semtech_loramac_set_class(&loramac, ENDPOINT_CLASS);
-    semtech_loramac_set_adr(&loramac, ADR_ON);
+    semtech_loramac_set_adr(&loramac, config.adr_on);
+    link_adapt_init(&loramac, TX_POWER);
 
-#if APP_CLOCK_SYNC == 1
-	// request for clock synchronization
-	app_clock_send_app_time_req(&loramac);
-    cnt_sent_messages++;
-
-    sleep_period_dr(&loramac);
-#endif
+    // start time of the last transmission for the duty-cycle scheduler
+    ztimer_now_t tx_start;
 
     while(!rebooting) {
+            // progress point of the sender
+            wdt_ztimer_kick();
         	DEBUG("[sender] Encoding payload ...\n");
             //start_time = ztimer_now(ZTIMER_MSEC);
         	uint8_t size = encode_sensors(payload);
@@ -193,31 +342,84 @@ static void sender(void)
             printf_ba(payload, size);
         	DEBUG("\n");
 
-        	DEBUG("[sender] Send @ port=%d size=%d\n", DATA_PORT, size);
+            if (first_frame) {
+                first_frame = false;
+                uint32_t phase_ms = tx_slot_first_delay_ms(TX_SLOT_FIRST_WINDOW_SEC * 1000U);
+                DEBUG("[sender] first transmission in %ld msec\n", phase_ms);
+                liveness_idle(LIVENESS_TASK_SENDER);
+                wdt_ztimer_sleep(ZTIMER_MSEC, phase_ms);
+                liveness_busy(LIVENESS_TASK_SENDER);
+            }
 
-            // WARNING : If LORAMAC_TX_CNF, the firmware is blocked when the network server does not confirmed the message
-            semtech_loramac_set_tx_mode(&loramac, TXCNF ? LORAMAC_TX_CNF : LORAMAC_TX_UNCNF);
-            semtech_loramac_set_tx_port(&loramac, DATA_PORT);
+            // the presence of the position is not an error
+            uint8_t error_flags = payload[0] & ~SENSORS_FLAG_GPS_POSITION;
+            bool alarm = (error_flags != last_error_flags);
+            last_error_flags = error_flags;
 
-#if GUARD_SENDER_WAKEUP == 1
-            start_time = ztimer_now(ZTIMER_MSEC);
+#if GPS == 1
+            // the GNSS time (after the acquisition of the position) replaces the AppTimeReq
+            uint64_t gnss_ms;
+            if (gps_mgr_get_time(&gnss_ms)) {
+                app_clock_gnss_time(gnss_ms);
+            }
 #endif
-            uint8_t ret = semtech_loramac_send(&loramac, payload, size);
 
-#if GUARD_SENDER_WAKEUP == 1
-            uint32_t duration = ztimer_now(ZTIMER_MSEC) - start_time;
-            start_time = 0;
+#ifndef DRPWSZ_SEQUENCE
+            // the DR of the uplink is chosen before the trailer is sized
+            link_adapt_before_uplink(&loramac);
 #endif
+
+#if APP_CLOCK_SYNC == 1 && !defined(DRPWSZ_SEQUENCE)
+            // the AppTimeReq (at the periodicity of the clock discipline) and the answers to the clock sync
+            // downlinks are piggybacked into a trailer <commands><length of the commands> of the data frame
+            app_clock_discipline();
+            bool time_req = app_clock_time_req_due(config.app_time_req_period) || clock_resync_requested;
+            clock_resync_requested = false;
+            // the frame (with the trailer and the FOpts) should fit into the max payload of the DR
+            uint8_t max_len = loramac_dutycycle_max_payload_len(semtech_loramac_get_dr(&loramac));
+            uint8_t trailer_max_len = 0;
+            if (max_len > size + 1 + APP_CLOCK_TRAILER_FOPTS_LEN) {
+                trailer_max_len = max_len - size - 1 - APP_CLOCK_TRAILER_FOPTS_LEN;
+            }
+            if (trailer_max_len > sizeof(payload) - size - 1) {
+                trailer_max_len = sizeof(payload) - size - 1;
+            }
+            uint8_t trailer_len = app_clock_encode_trailer(payload + size, trailer_max_len, time_req);
+            if (trailer_len != 0) {
+                payload[size + trailer_len] = trailer_len;
+                size += trailer_len + 1;
+                payload[0] |= FLAG_CLOCK_TRAILER;
+            }
+#endif
+
+        	DEBUG("[sender] Send @ port=%d size=%d\n", DATA_PORT, size);
+
+            ztimer_now_t start_time = ztimer_now(ZTIMER_MSEC);
+#ifdef DRPWSZ_SEQUENCE
+            // survey: the DR, the TX power and the size are given by the sequence
+            size = drpwsz_before_uplink(&loramac, payload, size, sizeof(payload));
+#endif
+            uint8_t ret = cnf_policy_send(&loramac, DATA_PORT, payload, size, alarm, &tx_start);
+            wdt_ztimer_kick();
+            cnt_data_frames++;
+#ifdef DRPWSZ_SEQUENCE
+            drpwsz_after_uplink(ret);
+#else
+            link_adapt_after_uplink(ret);
+#endif
+#if APP_CLOCK_SYNC == 1 && !defined(DRPWSZ_SEQUENCE)
+            app_clock_trailer_sent(ret);
+#endif
+            _rejoin_if_invalid_session();
+
+            uint32_t duration = ztimer_now(ZTIMER_MSEC) - start_time;
             if (ret == SEMTECH_LORAMAC_TX_DONE || ret == SEMTECH_LORAMAC_TX_CNF_FAILED) {
                 uint32_t uplink_counter = semtech_loramac_get_uplink_counter(&loramac);
-#if GUARD_SENDER_WAKEUP == 1
             	DEBUG("[sender] Tx Done ret=%d fcnt=%ld duration=%ld\n", ret, uplink_counter, duration);
-#else
-            	DEBUG("[sender] Tx Done ret=%d fcnt=%ld\n", ret, uplink_counter);
-#endif
             	if(ret == SEMTECH_LORAMAC_TX_CNF_FAILED) {
 
                     DEBUG("[sender] message was transmitted but no ACK  was received for Confirmed\n");
+                    cnf_policy_print();
                 }
                 cnt_sent_messages++;
 
@@ -228,24 +430,19 @@ static void sender(void)
                 * @return SEMTECH_LORAMAC_DUTYCYCLE_RESTRICTED when the send is rejected because of dutycycle restriction
                 * @return SEMTECH_LORAMAC_TX_ERROR when an invalid parameter is given
                 */
-#if GUARD_SENDER_WAKEUP == 1
                 DEBUG("[sender] ERROR: Cannot send payload: ret code: %d (%s) duration=%ld\n", ret, loramac_utils_err_message(ret), duration);
-#else
-                DEBUG("[sender] ERROR: Cannot send payload: ret code: %d (%s)\n", ret, loramac_utils_err_message(ret));
-#endif
             }
-            loramac_utils_sleep_adaptative_period_dr(&loramac, TX_PERIOD);
+            _sender_sleep_next_tx(tx_start);
 
-#if APP_CLOCK_SYNC == 1
-            // send a APP_TIME_REQ request every APP_TIME_REQ_PERIOD message
-            if(cnt_sent_messages%APP_TIME_REQ_PERIOD == 0)
+            // send the diagnostics uplink every STATS_PERIOD data frames
+            if(config.stats_period != 0 && cnt_data_frames%config.stats_period == 0)
             {
-            	app_clock_send_app_time_req(&loramac);
+                _send_stats(&tx_start);
                 cnt_sent_messages++;
+                _rejoin_if_invalid_session();
 
-                loramac_utils_sleep_adaptative_period_dr(&loramac, TX_PERIOD);
+                _sender_sleep_next_tx(tx_start);
             }
-#endif
     }
 
 	DEBUG("[sender] Exiting ...\n");
@@ -260,12 +457,17 @@ static void *receiver(void *arg)
     msg_init_queue(_receiver_queue, RECEIVER_MSG_QUEUE);
 
     (void)arg;
+    liveness_register(LIVENESS_TASK_RECEIVER, "receiver", LIVENESS_RECEIVER_MAX_BUSY_MS);
     while (1) {
         app_clock_print_rtc();
 
         /* blocks until something is received */
-        switch (semtech_loramac_recv(&loramac)) {
+        liveness_idle(LIVENESS_TASK_RECEIVER);
+        uint8_t rx_ret = semtech_loramac_recv(&loramac);
+        liveness_busy(LIVENESS_TASK_RECEIVER);
+        switch (rx_ret) {
             case SEMTECH_LORAMAC_RX_DATA:
+                stats_rx(loramac.rx_data.payload_len);
                 // TODO process Downlink payload
                 switch(loramac.rx_data.port) {
                     case PORT_DN_TEXT:
@@ -274,15 +476,25 @@ static void *receiver(void *arg)
                             (char *)loramac.rx_data.payload, loramac.rx_data.port);
                         break;
                     case PORT_DN_SET_TX_PERIOD:
-                        if(loramac.rx_data.payload_len == sizeof(tx_period)) {
+                        if(loramac.rx_data.payload_len == sizeof(uint16_t)) {
+                            uint16_t tx_period;
                         	memcpy(&tx_period, loramac.rx_data.payload, sizeof(uint16_t));
                             DEBUG("[dn] Data received: tx_period=%d, port: %d\n",
                                 tx_period, loramac.rx_data.port);
+                            if (config_set(CONFIG_ID_TXPERIOD_AT_DR0, tx_period) != CONFIG_OK) {
+                                DEBUG("[dn] tx_period not saved\n");
+                            }
                         } else {
                             DEBUG("[dn] Data received: bad size for tx_period, port: %d\n",
                                  loramac.rx_data.port);
                         }
                         break;
+                    case PORT_DN_CONFIG:
+                        DEBUG("[dn] Config received: ");
+                        printf_ba(loramac.rx_data.payload, loramac.rx_data.payload_len);
+                        DEBUG(", port: %d\n",loramac.rx_data.port);
+                        _config_changed(config_set_tlv(loramac.rx_data.payload, loramac.rx_data.payload_len));
+                        break;
                     case APP_CLOCK_PORT:
                     	(void)app_clock_process_downlink(&loramac);
                     	break;
@@ -294,16 +506,28 @@ static void *receiver(void *arg)
                     	break;
                     case PORT_DN_REBOOT_ONE_MINUTE:
                         DEBUG("[dn] Reboot in 60 sec. port: %d\n", loramac.rx_data.port);
-                        rebooting = true;
-                        ztimer_sleep(ZTIMER_SEC, 60U);
-            			pm_reboot();
+                        sched_action_schedule(SCHED_ACTION_REBOOT, 60U);
                     	break;
                     case PORT_DN_REBOOT_ONE_HOUR:
                         DEBUG("[dn] Reboot in 3600 sec. port: %d\n", loramac.rx_data.port);
-                        rebooting = true;
-                        ztimer_sleep(ZTIMER_SEC, 3600U);
-            			pm_reboot();
+                        sched_action_schedule(SCHED_ACTION_REBOOT, 3600U);
                     	break;
+                    case PORT_DN_SCHEDULE_ACTION:
+                        DEBUG("[dn] Schedule action. port: %d\n", loramac.rx_data.port);
+                        _schedule_action_downlink(loramac.rx_data.payload, loramac.rx_data.payload_len);
+                        break;
+                    case PORT_DN_CLASS_C_WINDOW:
+                        DEBUG("[dn] Class C window. port: %d\n", loramac.rx_data.port);
+                        _class_c_window_downlink(loramac.rx_data.payload, loramac.rx_data.payload_len);
+                        break;
+                    case PORT_DN_CANCEL_ACTION:
+                        DEBUG("[dn] Cancel action. port: %d\n", loramac.rx_data.port);
+                        if (loramac.rx_data.payload_len == 0) {
+                            sched_action_cancel_all();
+                        } else {
+                            sched_action_cancel(loramac.rx_data.payload[0]);
+                        }
+                        break;
 
                     default:
                         DEBUG("[dn] Data received: ");
@@ -314,6 +538,9 @@ static void *receiver(void *arg)
                 break;
 
 			case SEMTECH_LORAMAC_RX_LINK_CHECK:
+				stats_link_check(loramac.link_chk.demod_margin, loramac.link_chk.nb_gateways);
+				session_link_check_received();
+				link_adapt_link_check(&loramac, config.adr_on, loramac.link_chk.demod_margin);
 				DEBUG("[dn] Link check information:\n"
 				   "  - Demodulation margin: %d\n"
 				   "  - Number of gateways: %d\n",
@@ -322,6 +549,7 @@ static void *receiver(void *arg)
 				break;
 
 			case SEMTECH_LORAMAC_RX_CONFIRMED:
+				stats_rx(0);
 				DEBUG("[dn] Received ACK from network\n");
 				break;
 
@@ -336,6 +564,75 @@ static void *receiver(void *arg)
     return NULL;
 }
 
+#if ENABLE_SHELL == 1
+
+#if OTAA == 1
+static int _join_cmd(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    join_sched_print();
+    return 0;
+}
+#endif
+
+static int _link_cmd(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    link_adapt_print();
+    return 0;
+}
+
+#if APP_CLOCK_SYNC == 1
+static int _clock_cmd(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    app_clock_print_rtc();
+    app_clock_print_discipline();
+    return 0;
+}
+#endif
+
+#if GPS == 1
+static int _gps_cmd(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    gps_mgr_print();
+    return 0;
+}
+#endif
+
+static const shell_command_t shell_commands[] = {
+        { "git", "Print the git info", git_cmd },
+        { "stats", "Print the statistics (stats [reset|save])", stats_cmd },
+#if OTAA == 1
+        { "join", "Print the statistics of the joins", _join_cmd },
+#endif
+        { "link", "Print the state of the link adaptation", _link_cmd },
+#if APP_CLOCK_SYNC == 1
+        { "clock", "Print the RTC and the state of the clock discipline", _clock_cmd },
+#endif
+#if GPS == 1
+        { "gps", "Print the statistics of the time to fix", _gps_cmd },
+#endif
+        { NULL, NULL, NULL }
+};
+
+static char _shell_stack[THREAD_STACKSIZE_DEFAULT];
+
+static void *_shell_thread(void *arg)
+{
+    (void)arg;
+    char line_buf[SHELL_DEFAULT_BUFSIZE];
+    shell_run(shell_commands, line_buf, SHELL_DEFAULT_BUFSIZE);
+    return NULL;
+}
+
+#endif
+
 static void cpuid_info(void) {
 	uint8_t id[CPUID_LEN];
 	/* read the CPUID */
@@ -364,19 +661,26 @@ int main(void)
 {
 
 	git_cmd(0, NULL);
+    liveness_report_reboot();
 	//wdt_cmd(2, wdt_cmdline);
 #if ENABLE_WDT_ZTIMER == 1
 	start_wdt_ztimer();
 #endif
 
-
+    /* the time base is read from the RTC once */
+    timebase_init();
 #if APP_CLOCK_SYNC == 1
     app_clock_print_rtc();
 #endif
     cpuid_info();
     loramac_info();
 
-    /* initialize the sensors */
+    /* load the runtime configuration */
+    persist_init();
+    config_init();
+    stats_init();
+
+    /* initialize the sensors: the warm-up of the sensors runs in parallel with the join */
     init_sensors();
 
     /* initialize the loramac stack */
@@ -401,15 +705,25 @@ int main(void)
 
     /* set the LoRaWAN keys */
     semtech_loramac_set_deveui(&loramac, deveui);
+    tx_slot_init(deveui, LORAMAC_DEVEUI_LEN);
     semtech_loramac_set_appeui(&loramac, appeui);
     semtech_loramac_set_appkey(&loramac, appkey);
 
-    /* start the OTAA join procedure (and retries in required) */
-    /*uint8_t joinRes = */ loramac_utils_join_retry_loop(&loramac, DR_INIT, JOIN_NEXT_RETRY_TIME, SECONDS_PER_DAY);
+    /* the identity of the session is the DevEUI and the AppKey */
+    uint8_t identity[LORAMAC_DEVEUI_LEN + LORAMAC_APPKEY_LEN];
+    memcpy(identity, deveui, LORAMAC_DEVEUI_LEN);
+    memcpy(identity + LORAMAC_DEVEUI_LEN, appkey, LORAMAC_APPKEY_LEN);
 
     //random_init_by_array(uint32_t init_key[], int key_length)
+    // the seed is specific to the device before the random backoff of the join
     random_init_by_array((void*)appkey, LORAMAC_APPKEY_LEN/sizeof(uint32_t));
 
+    /* restore the saved session or start the OTAA join procedure (and retries in required) */
+    if (!session_restore(&loramac, identity, sizeof(identity), true)) {
+        /*uint8_t joinRes = */ loramac_utils_join_retry_loop(&loramac, DR_INIT, JOIN_NEXT_RETRY_TIME, SECONDS_PER_DAY);
+        session_save(&loramac, identity, sizeof(identity));
+    }
+
 #else
     /* Convert identifiers and application key */
 
@@ -425,6 +739,7 @@ int main(void)
 
     /* set the LoRaWAN keys */
     semtech_loramac_set_devaddr(&loramac, devaddr);
+    tx_slot_init(devaddr, LORAMAC_DEVADDR_LEN);
     semtech_loramac_set_appskey(&loramac, appskey);
     semtech_loramac_set_nwkskey(&loramac, nwkskey);
 
@@ -432,24 +747,38 @@ int main(void)
     /* start the ABP join procedure (and retries in required) */
     /*uint8_t joinRes = */ loramac_utils_abp_join_retry_loop(&loramac, DR_INIT, JOIN_NEXT_RETRY_TIME, SECONDS_PER_DAY);
 
+    /* restore the uplink counter of the session: the identity of the session is the DevAddr and the NwkSKey */
+    uint8_t identity[LORAMAC_DEVADDR_LEN + LORAMAC_NWKSKEY_LEN];
+    memcpy(identity, devaddr, LORAMAC_DEVADDR_LEN);
+    memcpy(identity + LORAMAC_DEVADDR_LEN, nwkskey, LORAMAC_NWKSKEY_LEN);
+    if (!session_restore(&loramac, identity, sizeof(identity), false)) {
+        session_save(&loramac, identity, sizeof(identity));
+    }
+
     //random_init_by_array(uint32_t init_key[], int key_length)
     random_init_by_array((void*)appskey, LORAMAC_APPSKEY_LEN/sizeof(uint32_t));
 
 #endif
 
-#ifdef FCNT_UP
-    semtech_loramac_set_uplink_counter(&loramac, FCNT_UP);
+
+    /* start the scheduler of the deferred actions */
+    sched_action_register(SCHED_ACTION_REBOOT, _reboot_action);
+    sched_action_register(SCHED_ACTION_CONFIG_APPLY, _config_apply_action);
+    sched_action_register(SCHED_ACTION_CLOCK_RESYNC, _clock_resync_action);
+    sched_action_register(SCHED_ACTION_CLASS_REVERT, _class_revert_action);
+    sched_action_init();
+
+#if ENABLE_SHELL == 1
+    /* start the shell thread */
+    thread_create(_shell_stack, sizeof(_shell_stack),
+                  THREAD_PRIORITY_MAIN + 1, 0, _shell_thread, NULL, "SHELL");
 #endif
 
     /* start the receiver thread */
     thread_create(_receiver_stack, sizeof(_receiver_stack),
                   THREAD_PRIORITY_MAIN - 1, 0, receiver, NULL, "RECEIVER");
 
-    /* sleep */
-    loramac_utils_sleep_adaptative_period_dr(&loramac, FIRST_TX_PERIOD);
-
-
-    /* call the sender */
+    /* call the sender: the first uplink is sent as soon as the data of the sensors are valid */
     sender();
     
     return 0; /* should never be reached */
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Lookup of the LoRaWAN network (NetID, operator, region) of a DevAddr.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#include <stddef.h>
+
+#include "netid.h"
+#include "netid_table.h"
+
+#define NELEMS(x)  (sizeof(x) / sizeof((x)[0]))
+
+const netid_entry_t *netid_lookup(uint32_t devaddr)
+{
+    // find the last entry with a prefix lower or equal to the DevAddr
+    size_t lo = 0;
+    size_t hi = NELEMS(netid_table);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (netid_table[mid].prefix <= devaddr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) {
+        return NULL;
+    }
+
+    // the prefixes do not overlap: only this entry can contain the DevAddr
+    const netid_entry_t *e = netid_table + lo - 1;
+    uint32_t mask = 0xFFFFFFFFUL << (32 - e->prefix_len);
+    return ((devaddr & mask) == e->prefix) ? e : NULL;
+}
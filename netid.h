@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Lookup of the LoRaWAN network (NetID, operator, region) of a DevAddr.
+ *
+ * The table is generated from tools/netid/netid.csv (make netid-table) and sorted by
+ * DevAddr prefix. This file has no dependency on RIOT: it is shared with the host CLI
+ * (tools/netid/netid_cli.c) so the firmware and the backend agree on the operators.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef NETID_H
+#define NETID_H
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct {
+    uint32_t prefix;        /**< DevAddr prefix */
+    uint8_t prefix_len;     /**< length of the prefix in bits */
+    uint32_t netid;         /**< NetID */
+    const char *name;       /**< name of the operator */
+    const char *region;     /**< region of the operator (empty if none) */
+} netid_entry_t;
+
+/**
+ * Find the network of a DevAddr (binary search into the table)
+ *
+ * @param devaddr   the DevAddr (MSB first)
+ *
+ * @return the entry of the network or NULL if the DevAddr belongs to no known network
+ */
+const netid_entry_t *netid_lookup(uint32_t devaddr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
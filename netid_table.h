@@ -0,0 +1,33 @@
+/*
+ * Generated by tools/netid/gen_netid_table.py from tools/netid/netid.csv: do not edit
+ */
+
+#ifndef NETID_TABLE_H
+#define NETID_TABLE_H
+
+#include "netid.h"
+
+/* sorted by DevAddr prefix */
+static const netid_entry_t netid_table[] = {
+    { 0x00000000,  7, 0x000000, "Experimental", "" },
+    { 0x02000000,  7, 0x000001, "Experimental", "" },
+    { 0x04000000,  7, 0x000002, "Actility", "Global" },
+    { 0x06000000,  7, 0x000003, "Proximus", "BE" },
+    { 0x08000000,  7, 0x000004, "Swisscom", "CH" },
+    { 0x0E000000,  7, 0x000007, "Bouygues Telecom", "FR" },
+    { 0x1E000000,  7, 0x00000F, "Orange", "FR" },
+    { 0x22000000,  7, 0x000011, "Tata Communications", "IN" },
+    { 0x24000000,  7, 0x000012, "Kerlink", "Global" },
+    { 0x26000000,  7, 0x000013, "The Things Network", "Global" },
+    { 0x2A000000,  7, 0x000015, "KPN", "NL" },
+    { 0x2E000000,  7, 0x000017, "Multitech", "Global" },
+    { 0x48000000,  7, 0x000024, "Helium", "Global" },
+    { 0xE0020000, 15, 0x600001, "Digita", "FI" },
+    { 0xE02E0000, 15, 0x600017, "Schneider Electric", "Global" },
+    { 0xFC006800, 22, 0xC0001A, "Requea", "FR" },
+    { 0xFC008400, 22, 0xC00021, "Hiber", "Global" },
+    { 0xFC00A000, 22, 0xC00028, "Lacuna Space", "Global" },
+    { 0xFC00AC00, 22, 0xC0002B, "Université Grenoble Alpes", "FR" },
+};
+
+#endif
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Streaming parser of NMEA 0183 sentences (one byte at a time).
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#include <stddef.h>
+
+#include "nmea.h"
+
+enum {
+    NMEA_STATE_IDLE = 0,    // waiting for '$'
+    NMEA_STATE_BODY,        // between '$' and '*'
+    NMEA_STATE_CK1,         // first digit of the checksum
+    NMEA_STATE_CK2,         // second digit of the checksum
+};
+
+// sentence types (after the 2 characters of the talker ID)
+static const struct {
+    char name[4];
+    nmea_type_t type;
+} nmea_types[] = {
+    { "GGA", NMEA_GGA },
+    { "RMC", NMEA_RMC },
+    { "GSA", NMEA_GSA },
+    { "VTG", NMEA_VTG },
+    { "ZDA", NMEA_ZDA },
+};
+
+#define NELEMS(x)  (sizeof(x) / sizeof((x)[0]))
+
+// max positions of the binary format (24-bit signed)
+#define MAX_NORTH_EAST_POSITION     (8388607LL)     // 2^23 - 1
+#define MAX_SOUTH_WEST_POSITION     (8388608LL)     // -2^23
+
+// minutes * 10^5 per degree
+#define MINUTES_E5_PER_DEGREE       (60L * 100000L)
+
+static int8_t hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+void nmea_init(nmea_parser_t *p)
+{
+    p->len = 0;
+    p->nb_fields = 0;
+    p->state = NMEA_STATE_IDLE;
+}
+
+bool nmea_parse_byte(nmea_parser_t *p, char c)
+{
+    if (c == '$') {
+        // a new sentence (the previous one is dropped if not complete)
+        p->len = 0;
+        p->nb_fields = 1;
+        p->field[0] = 0;
+        p->checksum = 0;
+        p->state = NMEA_STATE_BODY;
+        return false;
+    }
+
+    switch (p->state) {
+    case NMEA_STATE_BODY:
+        if (c == '*') {
+            p->buf[p->len] = '\0';
+            p->state = NMEA_STATE_CK1;
+        } else if (c == '\r' || c == '\n' || p->len >= NMEA_MAX_LEN) {
+            // no checksum or too long
+            p->state = NMEA_STATE_IDLE;
+        } else {
+            p->checksum ^= (uint8_t)c;
+            if (c == ',') {
+                if (p->nb_fields >= NMEA_MAX_FIELDS) {
+                    p->state = NMEA_STATE_IDLE;
+                    break;
+                }
+                p->buf[p->len++] = '\0';
+                p->field[p->nb_fields++] = p->len;
+            } else {
+                p->buf[p->len++] = c;
+            }
+        }
+        break;
+
+    case NMEA_STATE_CK1: {
+        int8_t v = hex_value(c);
+        p->checksum_rx = (uint8_t)(v << 4);
+        p->state = (v < 0) ? NMEA_STATE_IDLE : NMEA_STATE_CK2;
+        break;
+    }
+
+    case NMEA_STATE_CK2: {
+        int8_t v = hex_value(c);
+        p->state = NMEA_STATE_IDLE;
+        return v >= 0 && (p->checksum_rx | (uint8_t)v) == p->checksum;
+    }
+
+    default:
+        break;
+    }
+    return false;
+}
+
+nmea_type_t nmea_type(const nmea_parser_t *p)
+{
+    const char *addr = p->buf;
+    // talker ID (2 characters) + type (3 characters), proprietary sentences start with 'P'
+    if (addr[0] == 'P' || addr[0] == '\0' || addr[1] == '\0'
+        || addr[2] == '\0' || addr[3] == '\0' || addr[4] == '\0' || addr[5] != '\0') {
+        return NMEA_UNKNOWN;
+    }
+    for (size_t i = 0; i < NELEMS(nmea_types); i++) {
+        const char *name = nmea_types[i].name;
+        if (addr[2] == name[0] && addr[3] == name[1] && addr[4] == name[2]) {
+            return nmea_types[i].type;
+        }
+    }
+    return NMEA_UNKNOWN;
+}
+
+const char *nmea_field(const nmea_parser_t *p, uint8_t i)
+{
+    return (i < p->nb_fields) ? p->buf + p->field[i] : "";
+}
+
+bool nmea_fixed(const char *f, uint8_t decimals, int32_t *value)
+{
+    bool negative = false;
+    bool digits = false;
+    int32_t v = 0;
+
+    if (*f == '-') {
+        negative = true;
+        f++;
+    }
+    for (; *f >= '0' && *f <= '9'; f++) {
+        if (v > (INT32_MAX - 9) / 10) {
+            return false;
+        }
+        v = v * 10 + (*f - '0');
+        digits = true;
+    }
+    if (*f == '.') {
+        f++;
+    }
+    for (; decimals > 0; decimals--) {
+        if (v > (INT32_MAX - 9) / 10) {
+            return false;
+        }
+        v *= 10;
+        if (*f >= '0' && *f <= '9') {
+            v += *f - '0';
+            digits = true;
+            f++;
+        }
+    }
+    if (!digits) {
+        return false;
+    }
+    *value = negative ? -v : v;
+    return true;
+}
+
+bool nmea_coord_to_binary(const char *field, const char *hemisphere, int32_t max_degrees, int32_t *bin)
+{
+    int32_t value;
+    if (!nmea_fixed(field, 5, &value) || value < 0) {
+        return false;
+    }
+
+    // degrees * 10^7 + minutes * 10^5
+    int32_t degrees = value / 10000000;
+    int32_t minutes_e5 = value % 10000000;
+    if (minutes_e5 >= MINUTES_E5_PER_DEGREE) {
+        return false;
+    }
+
+    int64_t position_e5 = (int64_t)degrees * MINUTES_E5_PER_DEGREE + minutes_e5;
+    if (position_e5 > (int64_t)max_degrees * MINUTES_E5_PER_DEGREE) {
+        return false;
+    }
+
+    bool negative = (hemisphere[0] == 'S' || hemisphere[0] == 'W');
+    int64_t max_position = negative ? MAX_SOUTH_WEST_POSITION : MAX_NORTH_EAST_POSITION;
+
+    // truncated toward zero as the previous floating-point conversion
+    int32_t magnitude = (position_e5 * max_position) / ((int64_t)max_degrees * MINUTES_E5_PER_DEGREE);
+    *bin = negative ? -magnitude : magnitude;
+    return true;
+}
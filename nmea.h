@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Streaming parser of NMEA 0183 sentences (one byte at a time).
+ *
+ * The checksum is computed while the bytes are received. The commas are replaced by NUL
+ * characters into the sentence buffer: the fields are returned as C strings pointing into
+ * the buffer (no copy). Any talker ID is accepted (GP, GN, GL, GA, BD ...).
+ *
+ * This file has no dependency on RIOT.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef NMEA_H
+#define NMEA_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Max length of a sentence (82 characters for NMEA 0183, more for some receivers)
+ */
+#ifndef NMEA_MAX_LEN
+#define NMEA_MAX_LEN            (96U)
+#endif
+
+/*
+ * Max number of fields of a sentence (including the address field)
+ */
+#ifndef NMEA_MAX_FIELDS
+#define NMEA_MAX_FIELDS         (24U)
+#endif
+
+/**
+ * Types of the sentences
+ */
+typedef enum {
+    NMEA_UNKNOWN = 0,
+    NMEA_GGA,               /**< fix data */
+    NMEA_RMC,               /**< recommended minimum data */
+    NMEA_GSA,               /**< DOP and active satellites */
+    NMEA_VTG,               /**< course and speed over ground */
+    NMEA_ZDA,               /**< time and date */
+} nmea_type_t;
+
+/**
+ * State of the parser
+ */
+typedef struct {
+    char buf[NMEA_MAX_LEN + 1];             /**< sentence without '$' (fields separated by NUL) */
+    uint8_t len;                            /**< length of the sentence */
+    uint8_t field[NMEA_MAX_FIELDS];         /**< offsets of the fields into buf */
+    uint8_t nb_fields;                      /**< number of fields */
+    uint8_t checksum;                       /**< XOR of the characters between '$' and '*' */
+    uint8_t checksum_rx;                    /**< checksum received */
+    uint8_t state;                          /**< state of the parser */
+} nmea_parser_t;
+
+/**
+ * Initialize the parser
+ *
+ * @param p     the parser
+ */
+void nmea_init(nmea_parser_t *p);
+
+/**
+ * Parse a byte
+ *
+ * @param p     the parser
+ * @param c     the byte
+ *
+ * @return true if a sentence with a valid checksum is complete
+ */
+bool nmea_parse_byte(nmea_parser_t *p, char c);
+
+/**
+ * Get the type of the complete sentence
+ *
+ * @param p     the parser
+ *
+ * @return the type
+ */
+nmea_type_t nmea_type(const nmea_parser_t *p);
+
+/**
+ * Get a field of the complete sentence (the field 0 is the address, "GNGGA" for instance)
+ *
+ * @param p     the parser
+ * @param i     the index of the field
+ *
+ * @return the field ("" if the sentence has less fields)
+ */
+const char *nmea_field(const nmea_parser_t *p, uint8_t i);
+
+/**
+ * Convert a decimal field into a fixed-point integer ("12.345" with 2 decimals -> 1234)
+ *
+ * @param f         the field
+ * @param decimals  the number of decimals of the result (the next ones are truncated)
+ * @param value     the value
+ *
+ * @return false if the field is empty or not a number
+ */
+bool nmea_fixed(const char *f, uint8_t decimals, int32_t *value);
+
+/**
+ * Convert a coordinate ((d)ddmm.mmmmm) and its hemisphere into the 24-bit binary format
+ * (max_degrees is scaled to the max position of the hemisphere), with integers only
+ *
+ * @param field         the coordinate field
+ * @param hemisphere    the hemisphere field (N, S, E or W)
+ * @param max_degrees   90 for a latitude, 180 for a longitude
+ * @param bin           the position in the binary format
+ *
+ * @return false if the field is empty or out of range
+ */
+bool nmea_coord_to_binary(const char *field, const char *hemisphere, int32_t max_degrees, int32_t *bin);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ * Generated by tools/codec/gen_codec.py from tools/codec/payload.json: do not edit
+ */
+
+#include <string.h>
+
+#include "payload_codec.h"
+
+static void put_u16le(uint8_t *buf, uint16_t v)
+{
+    buf[0] = v & 0xFF;
+    buf[1] = v >> 8;
+}
+
+static void put_u16be(uint8_t *buf, uint16_t v)
+{
+    buf[0] = v >> 8;
+    buf[1] = v & 0xFF;
+}
+
+static void put_u24be(uint8_t *buf, uint32_t v)
+{
+    buf[0] = (v >> 16) & 0xFF;
+    buf[1] = (v >> 8) & 0xFF;
+    buf[2] = v & 0xFF;
+}
+
+static uint16_t get_u16le(const uint8_t *buf)
+{
+    return buf[0] | (buf[1] << 8);
+}
+
+static uint16_t get_u16be(const uint8_t *buf)
+{
+    return (buf[0] << 8) | buf[1];
+}
+
+static int32_t get_s24be(const uint8_t *buf)
+{
+    uint32_t v = ((uint32_t)buf[0] << 16) | ((uint32_t)buf[1] << 8) | buf[2];
+    // sign extension
+    return (v & 0x800000UL) ? (int32_t)(v | 0xFF000000UL) : (int32_t)v;
+}
+
+uint8_t codec_encode(const codec_data_t *data, uint8_t sensors, uint8_t *buf)
+{
+    // the trailer is appended by the caller
+    uint8_t flags = data->flags & ~CODEC_FLAG_CLOCK_TRAILER;
+    uint8_t i = 0;
+
+    buf[i++] = flags;
+
+    if ((sensors & CODEC_SENSOR_BMX280) && !(flags & CODEC_FLAG_BMX280_ERROR)) {
+        put_u16le(buf + i, (uint16_t)data->temperature);
+        i += 2;
+        put_u16le(buf + i, data->pressure);
+        i += 2;
+        if (sensors & CODEC_SENSOR_HUMIDITY) {
+            put_u16le(buf + i, data->humidity);
+            i += 2;
+        }
+    }
+
+    if ((sensors & CODEC_SENSOR_PMS7003) && !(flags & CODEC_FLAG_PMS7003_ERROR)) {
+        put_u16le(buf + i, data->pm1_0Standard);
+        i += 2;
+        put_u16le(buf + i, data->pm2_5Standard);
+        i += 2;
+        put_u16le(buf + i, data->pm10Standard);
+        i += 2;
+        put_u16le(buf + i, data->pm1_0Atmospheric);
+        i += 2;
+        put_u16le(buf + i, data->pm2_5Atmospheric);
+        i += 2;
+        put_u16le(buf + i, data->pm10Atmospheric);
+        i += 2;
+        put_u16le(buf + i, data->particuleGT0_3);
+        i += 2;
+        put_u16le(buf + i, data->particuleGT0_5);
+        i += 2;
+        put_u16le(buf + i, data->particuleGT1_0);
+        i += 2;
+        put_u16le(buf + i, data->particuleGT2_5);
+        i += 2;
+        put_u16le(buf + i, data->particuleGT10);
+        i += 2;
+    }
+
+    if ((sensors & CODEC_SENSOR_DS75LX) && !(flags & CODEC_FLAG_DS75LX_ERROR)) {
+        put_u16be(buf + i, (uint16_t)data->ds75lx_temperature);
+        i += 2;
+    }
+
+    if ((sensors & CODEC_SENSOR_AT30TSE75X) && !(flags & CODEC_FLAG_AT30TSE75X_ERROR)) {
+        put_u16be(buf + i, (uint16_t)data->at30tse75x_temperature);
+        i += 2;
+    }
+
+    if (flags & CODEC_FLAG_POSITION) {
+        put_u24be(buf + i, (uint32_t)data->latitude);
+        i += 3;
+        put_u24be(buf + i, (uint32_t)data->longitude);
+        i += 3;
+        put_u16be(buf + i, (uint16_t)data->altitude);
+        i += 2;
+    }
+    return i;
+}
+
+int8_t codec_decode(const uint8_t *buf, uint8_t len, uint8_t sensors, codec_data_t *data)
+{
+    memset(data, 0, sizeof(*data));
+    if (len < 1) {
+        return CODEC_ERROR_LENGTH;
+    }
+    uint8_t flags = data->flags = buf[0];
+    uint8_t end = len;
+    uint8_t i = 1;
+
+    if (flags & CODEC_FLAG_CLOCK_TRAILER) {
+        // <commands><length of the commands>
+        uint8_t n = buf[len - 1];
+        if (n + 2 > len) {
+            return CODEC_ERROR_TRAILER;
+        }
+        end = len - 1 - n;
+        data->trailer_offset = end;
+        data->trailer_len = n;
+    }
+
+    if ((sensors & CODEC_SENSOR_BMX280) && !(flags & CODEC_FLAG_BMX280_ERROR)) {
+        if (end - i < 4 + ((sensors & CODEC_SENSOR_HUMIDITY) ? 2 : 0)) {
+            return CODEC_ERROR_LENGTH;
+        }
+        data->temperature = (int16_t)get_u16le(buf + i);
+        i += 2;
+        data->pressure = get_u16le(buf + i);
+        i += 2;
+        if (sensors & CODEC_SENSOR_HUMIDITY) {
+            data->humidity = get_u16le(buf + i);
+            i += 2;
+        }
+    }
+
+    if ((sensors & CODEC_SENSOR_PMS7003) && !(flags & CODEC_FLAG_PMS7003_ERROR)) {
+        if (end - i < 22) {
+            return CODEC_ERROR_LENGTH;
+        }
+        data->pm1_0Standard = get_u16le(buf + i);
+        i += 2;
+        data->pm2_5Standard = get_u16le(buf + i);
+        i += 2;
+        data->pm10Standard = get_u16le(buf + i);
+        i += 2;
+        data->pm1_0Atmospheric = get_u16le(buf + i);
+        i += 2;
+        data->pm2_5Atmospheric = get_u16le(buf + i);
+        i += 2;
+        data->pm10Atmospheric = get_u16le(buf + i);
+        i += 2;
+        data->particuleGT0_3 = get_u16le(buf + i);
+        i += 2;
+        data->particuleGT0_5 = get_u16le(buf + i);
+        i += 2;
+        data->particuleGT1_0 = get_u16le(buf + i);
+        i += 2;
+        data->particuleGT2_5 = get_u16le(buf + i);
+        i += 2;
+        data->particuleGT10 = get_u16le(buf + i);
+        i += 2;
+    }
+
+    if ((sensors & CODEC_SENSOR_DS75LX) && !(flags & CODEC_FLAG_DS75LX_ERROR)) {
+        if (end - i < 2) {
+            return CODEC_ERROR_LENGTH;
+        }
+        data->ds75lx_temperature = (int16_t)get_u16be(buf + i);
+        i += 2;
+    }
+
+    if ((sensors & CODEC_SENSOR_AT30TSE75X) && !(flags & CODEC_FLAG_AT30TSE75X_ERROR)) {
+        if (end - i < 2) {
+            return CODEC_ERROR_LENGTH;
+        }
+        data->at30tse75x_temperature = (int16_t)get_u16be(buf + i);
+        i += 2;
+    }
+
+    if (flags & CODEC_FLAG_POSITION) {
+        if (end - i < 8) {
+            return CODEC_ERROR_LENGTH;
+        }
+        data->latitude = get_s24be(buf + i);
+        i += 3;
+        data->longitude = get_s24be(buf + i);
+        i += 3;
+        data->altitude = (int16_t)get_u16be(buf + i);
+        i += 2;
+    }
+
+    if (i < end && !(flags & CODEC_FLAG_CLOCK_TRAILER)) {
+        // zero padding of the frames of a survey (DRPWSZ_SEQUENCE)
+        for (uint8_t k = i; k < end; k++) {
+            if (buf[k] != 0) {
+                return CODEC_ERROR_LENGTH;
+            }
+        }
+        data->padding_len = end - i;
+        return CODEC_OK;
+    }
+    return (i == end) ? CODEC_OK : CODEC_ERROR_LENGTH;
+}
@@ -0,0 +1,134 @@
+/*
+ * Generated by tools/codec/gen_codec.py from tools/codec/payload.json: do not edit
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Codec of the data uplinks (encoder and decoder), shared by the firmware and the backend.
+ *
+ * The blocks of the payload depend on the flags (byte 0) and on the sensors of the endpoint.
+ * This file has no dependency on RIOT.
+ *
+ * @}
+ */
+
+#ifndef PAYLOAD_CODEC_H
+#define PAYLOAD_CODEC_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CODEC_PORT                      (101)
+
+/*
+ * Flags (byte 0)
+ */
+#define CODEC_FLAG_BMX280_ERROR         (0x01)   /**< no BMX280 measure */
+#define CODEC_FLAG_PMS7003_ERROR        (0x02)   /**< no PMS7003 measure */
+#define CODEC_FLAG_GPS_ERROR            (0x04)   /**< no GPS fix */
+#define CODEC_FLAG_DS75LX_ERROR         (0x08)   /**< no DS75LX measure */
+#define CODEC_FLAG_AT30TSE75X_ERROR     (0x10)   /**< no AT30TSE75X measure */
+#define CODEC_FLAG_POSITION             (0x40)   /**< the payload includes the position */
+#define CODEC_FLAG_CLOCK_TRAILER        (0x80)   /**< the payload ends with a clock sync trailer */
+
+/*
+ * Sensors of the endpoint
+ */
+#define CODEC_SENSOR_BMX280             (0x01)   /**< BMP280 or BME280 */
+#define CODEC_SENSOR_HUMIDITY           (0x02)   /**< BME280 (humidity) */
+#define CODEC_SENSOR_PMS7003            (0x04)   /**< PMS7003 */
+#define CODEC_SENSOR_DS75LX             (0x08)   /**< DS75LX */
+#define CODEC_SENSOR_AT30TSE75X         (0x10)   /**< AT30TSE75X */
+#define CODEC_SENSOR_GPS                (0x20)   /**< GNSS module */
+#define CODEC_SENSORS_DEFAULT           (0x07)
+
+/*
+ * Max size of the payload (without the clock sync trailer)
+ */
+#define CODEC_MAX_SIZE                  (41U)
+
+#define CODEC_OK                        (int8_t)0
+#define CODEC_ERROR_LENGTH              (int8_t)-1
+#define CODEC_ERROR_TRAILER             (int8_t)-2
+
+/**
+ * Content of a data uplink (raw values)
+ */
+typedef struct {
+    uint8_t flags;                          /**< flags */
+    int16_t temperature;                    /**< bmx280 (°C * 100) */
+    uint16_t pressure;                      /**< bmx280 (hPa * 10) */
+    uint16_t humidity;                      /**< bmx280 (% * 100) */
+    uint16_t pm1_0Standard;                 /**< pms7003 (ug/m3) */
+    uint16_t pm2_5Standard;                 /**< pms7003 (ug/m3) */
+    uint16_t pm10Standard;                  /**< pms7003 (ug/m3) */
+    uint16_t pm1_0Atmospheric;              /**< pms7003 (ug/m3) */
+    uint16_t pm2_5Atmospheric;              /**< pms7003 (ug/m3) */
+    uint16_t pm10Atmospheric;               /**< pms7003 (ug/m3) */
+    uint16_t particuleGT0_3;                /**< pms7003 (1/0.1L) */
+    uint16_t particuleGT0_5;                /**< pms7003 (1/0.1L) */
+    uint16_t particuleGT1_0;                /**< pms7003 (1/0.1L) */
+    uint16_t particuleGT2_5;                /**< pms7003 (1/0.1L) */
+    uint16_t particuleGT10;                 /**< pms7003 (1/0.1L) */
+    int16_t ds75lx_temperature;             /**< ds75lx (°C * 100) */
+    int16_t at30tse75x_temperature;         /**< at30tse75x (°C * 100) */
+    int32_t latitude;                       /**< position (2^23 for 90 degrees) */
+    int32_t longitude;                      /**< position (2^23 for 180 degrees) */
+    int16_t altitude;                       /**< position (m) */
+    uint8_t trailer_offset;                 /**< offset of the clock sync trailer (decoder) */
+    uint8_t trailer_len;                    /**< length of the clock sync trailer (decoder) */
+    uint8_t padding_len;                    /**< length of the zero padding (decoder) */
+} codec_data_t;
+
+/**
+ * Encode a data uplink (without the clock sync trailer)
+ *
+ * @param data      the content (the flags select the blocks)
+ * @param sensors   the sensors of the endpoint (CODEC_SENSOR_*)
+ * @param buf       the buffer (CODEC_MAX_SIZE bytes)
+ *
+ * @return the size of the payload
+ */
+uint8_t codec_encode(const codec_data_t *data, uint8_t sensors, uint8_t *buf);
+
+/**
+ * Decode a data uplink
+ *
+ * @param buf       the payload
+ * @param len       the size of the payload
+ * @param sensors   the sensors of the endpoint (CODEC_SENSOR_*)
+ * @param data      the content
+ *
+ * Without a clock sync trailer, the payload can be padded with zeros (the frames of a survey
+ * DRPWSZ_SEQUENCE have the size of the sequence): the padding is skipped.
+ *
+ * @return CODEC_OK, CODEC_ERROR_LENGTH (the size does not match the flags and the sensors) or
+ *         CODEC_ERROR_TRAILER
+ */
+int8_t codec_decode(const uint8_t *buf, uint8_t len, uint8_t sensors, codec_data_t *data);
+
+/**
+ * Decode a data uplink into a JSON object (same keys as codec/decoder.js, tools/codec/codec_json.c)
+ *
+ * @param buf       the payload
+ * @param len       the size of the payload
+ * @param sensors   the sensors of the endpoint (CODEC_SENSOR_*)
+ * @param out       the JSON object (with "_errors" if the payload is not valid)
+ * @param size      the size of out
+ *
+ * @return the error of codec_decode
+ */
+int8_t codec_decode_json(const uint8_t *buf, uint8_t len, uint8_t sensors, char *out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Persistent records stored into wear-levelled flash pages.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "mutex.h"
+
+#include "persist.h"
+
+#if MODULE_PERIPH_FLASHPAGE == 1
+
+#include "periph/flashpage.h"
+
+#if PERSIST_NB_PAGES < 2
+#error "PERSIST_NB_PAGES should be at least 2"
+#endif
+
+#define PERSIST_FIRST_PAGE              (FLASHPAGE_NUMOF - PERSIST_NB_PAGES)
+
+// "AQS1"
+#define PERSIST_PAGE_MAGIC              (0x31535141UL)
+
+#define PERSIST_ERASED_ID               (0xFF)
+#define PERSIST_MAX_IDS                 (16U)
+
+#define ALIGN_UP(x)                     ((((x) + FLASHPAGE_WRITE_BLOCK_SIZE - 1) / FLASHPAGE_WRITE_BLOCK_SIZE) * FLASHPAGE_WRITE_BLOCK_SIZE)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+} page_header_t;
+
+typedef struct {
+    uint8_t id;
+    uint8_t rfu;
+    uint16_t len;
+    uint16_t crc;
+    uint16_t rfu2;
+} record_header_t;
+
+#define RECORDS_OFFSET                  ALIGN_UP(sizeof(page_header_t))
+
+static mutex_t persist_mutex = MUTEX_INIT;
+
+static bool initialized = false;
+static unsigned active_page;
+static uint32_t active_seq;
+static size_t write_offset;
+
+// aligned buffer for the flash writes
+static uint64_t write_buffer[(sizeof(record_header_t) + PERSIST_RECORD_MAX_SIZE + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+
+static uint16_t crc16(uint8_t id, const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF ^ id;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static inline const uint8_t *page_addr(unsigned page)
+{
+    return (const uint8_t *)flashpage_addr(page);
+}
+
+static inline bool is_valid_page(unsigned page)
+{
+    const page_header_t *ph = (const page_header_t *)page_addr(page);
+    return ph->magic == PERSIST_PAGE_MAGIC;
+}
+
+/*
+ * Find the last valid version of the record in the page
+ * (and the end of the records into the page)
+ */
+static const record_header_t *find_record(unsigned page, uint8_t id, size_t *end)
+{
+    const uint8_t *base = page_addr(page);
+    const record_header_t *found = NULL;
+    size_t offset = RECORDS_OFFSET;
+
+    while (offset + sizeof(record_header_t) <= FLASHPAGE_SIZE) {
+        const record_header_t *rh = (const record_header_t *)(base + offset);
+        if (rh->id == PERSIST_ERASED_ID) {
+            break;
+        }
+        if (rh->len > PERSIST_RECORD_MAX_SIZE
+            || offset + sizeof(record_header_t) + rh->len > FLASHPAGE_SIZE) {
+            // corrupted record : the rest of the page is unusable
+            offset = FLASHPAGE_SIZE;
+            break;
+        }
+        if (rh->id == id && rh->crc == crc16(rh->id, (const uint8_t *)(rh + 1), rh->len)) {
+            found = rh;
+        }
+        offset += ALIGN_UP(sizeof(record_header_t) + rh->len);
+    }
+
+    if (end != NULL) {
+        *end = offset;
+    }
+    return found;
+}
+
+static void append_record(unsigned page, size_t *offset, uint8_t id, const void *data, size_t len)
+{
+    record_header_t *rh = (record_header_t *)write_buffer;
+    size_t size = ALIGN_UP(sizeof(record_header_t) + len);
+
+    memset(write_buffer, 0xFF, size);
+    rh->id = id;
+    rh->rfu = 0;
+    rh->len = len;
+    rh->crc = crc16(id, data, len);
+    rh->rfu2 = 0;
+    if (len != 0) {
+        memcpy(rh + 1, data, len);
+    }
+
+    flashpage_write((uint8_t *)flashpage_addr(page) + *offset, write_buffer, size);
+    *offset += size;
+}
+
+/*
+ * Copy the last version of the records (except skip_id) into the next page
+ */
+static int8_t compact(uint8_t skip_id)
+{
+    unsigned next_page = PERSIST_FIRST_PAGE + ((active_page - PERSIST_FIRST_PAGE + 1) % PERSIST_NB_PAGES);
+    uint8_t ids[PERSIST_MAX_IDS];
+    unsigned nb_ids = 0;
+
+    // collect the identifiers of the active page
+    const uint8_t *base = page_addr(active_page);
+    size_t offset = RECORDS_OFFSET;
+    while (offset + sizeof(record_header_t) <= write_offset) {
+        const record_header_t *rh = (const record_header_t *)(base + offset);
+        bool known = (rh->id == skip_id);
+        for (unsigned i = 0; i < nb_ids && !known; i++) {
+            known = (ids[i] == rh->id);
+        }
+        if (!known && nb_ids < PERSIST_MAX_IDS) {
+            ids[nb_ids++] = rh->id;
+        }
+        offset += ALIGN_UP(sizeof(record_header_t) + rh->len);
+    }
+
+    DEBUG("[persist] compact page %d into page %d (%d records)\n", active_page, next_page, nb_ids);
+    flashpage_erase(next_page);
+
+    size_t next_offset = RECORDS_OFFSET;
+    for (unsigned i = 0; i < nb_ids; i++) {
+        const record_header_t *rh = find_record(active_page, ids[i], NULL);
+        if (rh != NULL && rh->len != 0) {
+            // the record is copied into RAM since flashpage_write requires aligned data
+            uint8_t tmp[PERSIST_RECORD_MAX_SIZE];
+            uint16_t len = rh->len;
+            memcpy(tmp, rh + 1, len);
+            append_record(next_page, &next_offset, ids[i], tmp, len);
+        }
+    }
+
+    // the page header is written at last: the page is valid only if the copy is complete
+    page_header_t *ph = (page_header_t *)write_buffer;
+    memset(write_buffer, 0xFF, RECORDS_OFFSET);
+    ph->magic = PERSIST_PAGE_MAGIC;
+    ph->seq = active_seq + 1;
+    flashpage_write((void *)page_addr(next_page), write_buffer, RECORDS_OFFSET);
+
+    active_page = next_page;
+    active_seq++;
+    write_offset = next_offset;
+
+    return PERSIST_OK;
+}
+
+static int8_t _write(uint8_t id, const void *data, size_t len)
+{
+    if (len > PERSIST_RECORD_MAX_SIZE || id == PERSIST_ERASED_ID) {
+        return PERSIST_ERROR_SIZE;
+    }
+
+    if (write_offset + ALIGN_UP(sizeof(record_header_t) + len) > FLASHPAGE_SIZE) {
+        compact(id);
+        if (write_offset + ALIGN_UP(sizeof(record_header_t) + len) > FLASHPAGE_SIZE) {
+            return PERSIST_ERROR_FULL;
+        }
+    }
+
+    // data is copied since the caller buffer can be unaligned
+    uint8_t tmp[PERSIST_RECORD_MAX_SIZE];
+    if (len != 0) {
+        memcpy(tmp, data, len);
+    }
+    append_record(active_page, &write_offset, id, tmp, len);
+
+    return PERSIST_OK;
+}
+
+int8_t persist_init(void)
+{
+    mutex_lock(&persist_mutex);
+
+    if (initialized) {
+        mutex_unlock(&persist_mutex);
+        return PERSIST_OK;
+    }
+
+    bool found = false;
+    for (unsigned page = PERSIST_FIRST_PAGE; page < FLASHPAGE_NUMOF; page++) {
+        if (is_valid_page(page)) {
+            uint32_t seq = ((const page_header_t *)page_addr(page))->seq;
+            if (!found || (int32_t)(seq - active_seq) > 0) {
+                active_page = page;
+                active_seq = seq;
+                found = true;
+            }
+        }
+    }
+
+    if (found) {
+        find_record(active_page, PERSIST_ERASED_ID, &write_offset);
+        DEBUG("[persist] active page %d seq=%ld used=%d bytes\n", active_page, active_seq, write_offset);
+    } else {
+        DEBUG("[persist] formatting pages %d-%d\n", PERSIST_FIRST_PAGE, FLASHPAGE_NUMOF - 1);
+        // format the last page: the compaction will switch to the first one
+        active_page = FLASHPAGE_NUMOF - 1;
+        active_seq = 0;
+        write_offset = RECORDS_OFFSET;
+        compact(PERSIST_ERASED_ID);
+    }
+    initialized = true;
+
+    mutex_unlock(&persist_mutex);
+    return PERSIST_OK;
+}
+
+int persist_read(uint8_t id, void *data, size_t len)
+{
+    if (!initialized) {
+        persist_init();
+    }
+
+    mutex_lock(&persist_mutex);
+
+    int ret;
+    const record_header_t *rh = find_record(active_page, id, NULL);
+    if (rh == NULL || rh->len == 0) {
+        ret = PERSIST_ERROR_NOT_FOUND;
+    } else if (rh->len > len) {
+        ret = PERSIST_ERROR_SIZE;
+    } else {
+        memcpy(data, rh + 1, rh->len);
+        ret = rh->len;
+    }
+
+    mutex_unlock(&persist_mutex);
+    return ret;
+}
+
+int8_t persist_write(uint8_t id, const void *data, size_t len)
+{
+    if (!initialized) {
+        persist_init();
+    }
+
+    mutex_lock(&persist_mutex);
+    int8_t ret = _write(id, data, len);
+    mutex_unlock(&persist_mutex);
+
+    DEBUG("[persist] write id=%d len=%d ret=%d\n", id, len, ret);
+    return ret;
+}
+
+int8_t persist_erase(uint8_t id)
+{
+    // a record with a null length is a tombstone
+    return persist_write(id, NULL, 0);
+}
+
+#else
+
+int8_t persist_init(void)
+{
+    DEBUG("[persist] no flashpage support\n");
+    return PERSIST_ERROR_NOT_SUPPORTED;
+}
+
+int persist_read(uint8_t id, void *data, size_t len)
+{
+    (void)id;
+    (void)data;
+    (void)len;
+    return PERSIST_ERROR_NOT_SUPPORTED;
+}
+
+int8_t persist_write(uint8_t id, const void *data, size_t len)
+{
+    (void)id;
+    (void)data;
+    (void)len;
+    return PERSIST_ERROR_NOT_SUPPORTED;
+}
+
+int8_t persist_erase(uint8_t id)
+{
+    (void)id;
+    return PERSIST_ERROR_NOT_SUPPORTED;
+}
+
+#endif
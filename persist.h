@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Persistent records stored into wear-levelled flash pages.
+ *
+ * The records are appended into the active page. When the active page is full,
+ * the last version of each record is copied into the next page which becomes the active one.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Number of flash pages used for the records (at the end of the flash)
+ */
+#ifndef PERSIST_NB_PAGES
+#define PERSIST_NB_PAGES                (2U)
+#endif
+
+/*
+ * Maximum size of a record
+ */
+#ifndef PERSIST_RECORD_MAX_SIZE
+#define PERSIST_RECORD_MAX_SIZE         (192U)
+#endif
+
+/*
+ * Identifiers of the records
+ */
+#define PERSIST_ID_CONFIG               (uint8_t)0x01
+#define PERSIST_ID_STATS                (uint8_t)0x02
+#define PERSIST_ID_SESSION              (uint8_t)0x03
+#define PERSIST_ID_JOIN                 (uint8_t)0x04
+
+#define PERSIST_OK                      (int8_t)0
+#define PERSIST_ERROR_NOT_FOUND         (int8_t)-1
+#define PERSIST_ERROR_SIZE              (int8_t)-2
+#define PERSIST_ERROR_NOT_SUPPORTED     (int8_t)-3
+#define PERSIST_ERROR_FULL              (int8_t)-4
+
+/**
+ * Initialize the persistent storage (select the active page)
+ */
+int8_t persist_init(void);
+
+/**
+ * Read the last version of a record
+ *
+ * @param id    the identifier of the record
+ * @param data  the buffer to fill
+ * @param len   the size of the buffer
+ *
+ * @return the size of the record or an error (< 0)
+ */
+int persist_read(uint8_t id, void *data, size_t len);
+
+/**
+ * Write a new version of a record
+ *
+ * @param id    the identifier of the record
+ * @param data  the content of the record
+ * @param len   the size of the record
+ *
+ * @return PERSIST_OK or an error
+ */
+int8_t persist_write(uint8_t id, const void *data, size_t len);
+
+/**
+ * Erase a record
+ *
+ * @param id    the identifier of the record
+ *
+ * @return PERSIST_OK or an error
+ */
+int8_t persist_erase(uint8_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
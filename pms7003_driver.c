@@ -21,6 +21,9 @@
 #define ENABLE_DEBUG (1)
 #include "debug.h"
 
+#include "liveness.h"
+#include "wdt_ztimer.h"
+
 
 #ifndef PMS7003_RESET_SLEEP_TIME
 #define PMS7003_RESET_SLEEP_TIME (10000U) // 10 ms
@@ -28,6 +31,13 @@
 
 #define USED_UART UART_DEV(1)
 
+#ifndef PMS7003_MEASURE_TIMEOUT_MARGIN_SEC
+#define PMS7003_MEASURE_TIMEOUT_MARGIN_SEC (10U)
+#endif
+
+#define PMS7003_IGNITION_TIMEOUT_MSEC (5000U)
+#define PMS7003_IGNITION_POLL_MSEC (100U)
+
 #define RCV_QUEUE_SIZE 8
 char pms7003_thread_stack[THREAD_STACKSIZE_MAIN];
 static msg_t rcv_queue[RCV_QUEUE_SIZE];
@@ -36,6 +46,7 @@ kernel_pid_t pms7003_pid = 0;
 static struct pms7003Data lastMesure;
 
 static enum state currentState = uninitialized;
+static volatile bool ignited = false;
 static uint8_t useTheSleepMode = 0;
 
 static msg_t msgNoResponseFromSensor = {0};
@@ -101,7 +112,10 @@ void queue_print(void)
 }
 
 //-------- timers -------
+#ifndef VALID_DATA_AFTER_WAKEUP_SEC
 #define VALID_DATA_AFTER_WAKEUP_SEC 30
+#endif
+static uint16_t validDataAfterWakeupSec = VALID_DATA_AFTER_WAKEUP_SEC;
 #define TIME_BEFORE_GOING_BACK_TO_SLEEP_SEC 5
 #define TIME_BETWEEN_TWO_MEASURES_MSEC 100
 
@@ -291,11 +305,12 @@ static inline enum state _pms7003_handle_error(char *debugMessage)
 
 void *_pms7003_event_loop(void *arg)
 {
-    kernel_pid_t initedFromPid = *(kernel_pid_t *)arg;
-
-    uint8_t firstIgnition = 1;
+    (void)arg;
 
     static ztimer_t backIntoSleepModeTimer = {0};
+    // the timers should outlive the handling of the message which sets them
+    static ztimer_t cooldownTimer = {0};
+    static ztimer_t validDataTimer = {0};
 
     msg_init_queue(rcv_queue, RCV_QUEUE_SIZE);
 
@@ -304,7 +319,9 @@ void *_pms7003_event_loop(void *arg)
         DEBUG("[pms7003] loop\n");
         msg_t msgSend;
         msg_t msg;
+        liveness_idle(LIVENESS_TASK_PMS7003);
         msg_receive(&msg);
+        liveness_busy(LIVENESS_TASK_PMS7003);
 
         switch (msg.type)
         {
@@ -341,12 +358,10 @@ void *_pms7003_event_loop(void *arg)
             switch (currentState)
             {
             case initialization:
-                if (firstIgnition)
+                if (!ignited)
                 {
-                    msg_t msgInited;
-                    msgInited.type = MSG_TYPE_PMS_IGNITED; // TODO change this, the message will be sent every time pms resets, it shouldn't...
-                    msg_send(&msgInited, initedFromPid);
-                    firstIgnition = 0;
+                    DEBUG("[pms7003] Sensor ignited\n");
+                    ignited = true;
                 }
                 if (useTheSleepMode && queue_empty_pid())
                 {
@@ -377,7 +392,6 @@ void *_pms7003_event_loop(void *arg)
 
             case readAsked:
                 msgSend.type = MSG_TYPE_TIMER_READ_COOLDOWN;
-                ztimer_t cooldownTimer = {0};
                 ztimer_set_msg(ZTIMER_MSEC, &cooldownTimer, TIME_BETWEEN_TWO_MEASURES_MSEC, &msgSend, pms7003_pid);
                 DEBUG("[pms7003] Cooldown between two reads set.\n");
 
@@ -390,9 +404,13 @@ void *_pms7003_event_loop(void *arg)
                 {
                     DEBUG("[pms7003] Sent data to user thread\n");
                     msg_t msgSend;
-                    msg.type = EVENT_LOOP_RESPONSE_SUCCESS;
+                    msgSend.type = EVENT_LOOP_RESPONSE_SUCCESS;
                     msgSend.content.ptr = &lastMesure;
-                    msg_send(&msgSend, respondTo);
+                    // the user may have given up waiting: never block the event loop
+                    if (msg_try_send(&msgSend, respondTo) != 1)
+                    {
+                        DEBUG("[pms7003] WARNING : User thread %i is not waiting anymore\n", respondTo);
+                    }
                 }
 
                 if (useTheSleepMode)
@@ -441,9 +459,8 @@ void *_pms7003_event_loop(void *arg)
             {
             case passiveNotConfirmed:
                 msgSend.type = MSG_TYPE_TIMER_VALID_DATA;
-                ztimer_t timer = {0};
-                ztimer_set_msg(ZTIMER_MSEC, &timer, VALID_DATA_AFTER_WAKEUP_SEC * 1000, &msgSend, pms7003_pid);
-                DEBUG("[pms7003] now in passive mode, it will be ready in %i seconds\n", VALID_DATA_AFTER_WAKEUP_SEC);
+                ztimer_set_msg(ZTIMER_MSEC, &validDataTimer, validDataAfterWakeupSec * 1000, &msgSend, pms7003_pid);
+                DEBUG("[pms7003] now in passive mode, it will be ready in %i seconds\n", validDataAfterWakeupSec);
                 currentState = passive;
                 break;
 
@@ -564,9 +581,9 @@ void *_pms7003_event_loop(void *arg)
             {
                 DEBUG("[pms7003] user read event could not be added, queue full!\n");
                 msg_t msgSend;
-                msg.type = EVENT_LOOP_RESPONSE_ERROR;
+                msgSend.type = EVENT_LOOP_RESPONSE_ERROR;
                 msgSend.content.ptr = NULL;
-                msg_send(&msgSend, msg.sender_pid);
+                msg_try_send(&msgSend, msg.sender_pid);
             }
             else
             {
@@ -626,7 +643,7 @@ static uint8_t pms7003_reset(void)
 }
 
 
-uint8_t pms7003_init(uint8_t useSleepMode)
+uint8_t pms7003_init_async(uint8_t useSleepMode)
 {
     DEBUG("[pms7003] Initializing\n");
 
@@ -636,12 +653,13 @@ uint8_t pms7003_init(uint8_t useSleepMode)
 
     uart_init(USED_UART, 9600, _pms7003_rx_handler, NULL);
 
-    kernel_pid_t pid = getpid();
+    liveness_register(LIVENESS_TASK_PMS7003, "pms7003", LIVENESS_PMS7003_MAX_BUSY_MS);
+
     pms7003_pid = thread_create(pms7003_thread_stack,
                                 sizeof(pms7003_thread_stack),
                                 THREAD_PRIORITY_MAIN - 1,
                                 THREAD_CREATE_STACKTEST,
-                                _pms7003_event_loop, &pid,
+                                _pms7003_event_loop, NULL,
                                 "pms7003_thread");
 
     msg_t msg;
@@ -649,15 +667,37 @@ uint8_t pms7003_init(uint8_t useSleepMode)
     msg.content.value = useSleepMode;
     msg_send(&msg, pms7003_pid);
 
-    msg_t msgRcv;
-    if (ztimer_msg_receive_timeout(ZTIMER_SEC, &msgRcv, 5) > 0)
+    return 0;
+}
+
+uint8_t pms7003_init(uint8_t useSleepMode)
+{
+    if (pms7003_init_async(useSleepMode) != 0)
     {
-        return 0;
+        return 1;
     }
-    else
+
+    // wait for the ignition of the sensor
+    for (uint32_t t = 0; t < PMS7003_IGNITION_TIMEOUT_MSEC; t += PMS7003_IGNITION_POLL_MSEC)
     {
-        return 1;
+        if (ignited)
+        {
+            return 0;
+        }
+        ztimer_sleep(ZTIMER_MSEC, PMS7003_IGNITION_POLL_MSEC);
     }
+    return 1;
+}
+
+bool pms7003_is_ignited(void)
+{
+    return ignited;
+}
+
+void pms7003_set_valid_data_delay(uint16_t sec)
+{
+    DEBUG("[pms7003] Valid data %i seconds after wakeup\n", sec);
+    validDataAfterWakeupSec = sec;
 }
 
 void pms7003_print(struct pms7003Data *data)
@@ -727,7 +767,19 @@ uint8_t pms7003_measure(struct pms7003Data *data)
     DEBUG("[pms7003] USER : pid %i asked mesure\n", thread_getpid());
     msg_t msgRecieve;
     msg_send(&msgSend, pms7003_pid);
-    msg_receive(&msgRecieve);
+    // the wait for the valid data is cut into chunks for kicking the WDT
+    uint32_t timeout = validDataAfterWakeupSec + PMS7003_MEASURE_TIMEOUT_MARGIN_SEC;
+    uint32_t chunk = WDT_UTILS_SLEEP_CHUNK_MS / 1000;
+    while (ztimer_msg_receive_timeout(ZTIMER_SEC, &msgRecieve, timeout < chunk ? timeout : chunk) < 0)
+    {
+        if (timeout <= chunk)
+        {
+            DEBUG("[pms7003] USER : pid %i timeout\n", thread_getpid());
+            return 1;
+        }
+        timeout -= chunk;
+        wdt_ztimer_kick();
+    }
     DEBUG("[pms7003] USER : pid %i received response\n", thread_getpid());
 
     memcpy(data, msgRecieve.content.ptr, sizeof(struct pms7003Data));
@@ -11,6 +11,9 @@
 #ifndef PMS7003_DRIVER_H
 #define PMS7003_DRIVER_H    (1)
 
+#include <stdbool.h>
+#include <stdint.h>
+
 /**
  * Data measured by the pms7003 sensor
  */
@@ -91,9 +94,30 @@ void pms7003_print_csv(struct pms7003Data *data);
 uint8_t pms7003_init(uint8_t useSleepMode);
 
 /**
- * Get the last valid mesure.
+ * Init the uart 1 and start the pms thread without waiting for the ignition of the sensor
+ * (the warm-up of the sensor runs in parallel with the caller)
+ * @param useSleepMode set to true if you want to set the sensor sleep when not in use
+ * @return 0 if the pms thread was started, 1 otherwise
+ */
+uint8_t pms7003_init_async(uint8_t useSleepMode);
+
+/**
+ * Check if the sensor has answered once since the initialization
+ * @return true if the sensor is ignited
+ */
+bool pms7003_is_ignited(void);
+
+/**
+ * Set the delay before the measurements are valid after the wakeup of the sensor
+ * @param sec the delay in seconds
+ */
+void pms7003_set_valid_data_delay(uint16_t sec);
+
+/**
+ * Get the last valid mesure. The call waits for the valid data after the wakeup of the sensor
+ * (at most the valid data delay + PMS7003_MEASURE_TIMEOUT_MARGIN_SEC).
  * @param data a pointer to the pms7003Data to fill in
- * @return 1 if pms was not initialised and data not filled in, 0 if everything went well
+ * @return 1 if pms was not initialised (or did not answer in time) and data not filled in, 0 if everything went well
  */
 uint8_t pms7003_measure(struct pms7003Data *data);
 
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Movement filter of the reported positions.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#include "pos_filter.h"
+
+// 2^23 - 1: max position of the binary format (90 degrees of latitude, 180 degrees of longitude)
+#define POS_MAX                     (8388607L)
+
+// decimeters (Q10) per unit of the binary format: 90 and 180 degrees * 111194.93 m / POS_MAX
+#define LAT_UNIT_DM_Q10             (12216LL)
+#define LON_UNIT_DM_Q10             (24432LL)
+
+// cos(latitude) (Q15) every 5 degrees
+static const uint16_t cos_q15[] = {
+    32767, 32642, 32269, 31650, 30791, 29697, 28377, 26841, 25101, 23170,
+    21062, 18794, 16384, 13848, 11207, 8481, 5690, 2856, 0
+};
+
+static bool has_reported = false;
+static int32_t reported_lat = 0;
+static int32_t reported_lon = 0;
+static uint16_t checks_since_report = 0;
+
+// cos of a latitude (binary format) with a linear interpolation of the table
+static uint32_t cos_lat_q15(int32_t lat)
+{
+    uint32_t a = (uint32_t)(lat < 0 ? -lat : lat);
+    if (a > POS_MAX) {
+        a = POS_MAX;
+    }
+    // index of the 5-degree step (Q8)
+    uint32_t pos = (uint32_t)(((uint64_t)a * 18 * 256) / POS_MAX);
+    uint32_t idx = pos >> 8;
+    uint32_t frac = pos & 0xFF;
+    if (idx >= 18) {
+        return cos_q15[18];
+    }
+    return (cos_q15[idx] * (256 - frac) + cos_q15[idx + 1] * frac) >> 8;
+}
+
+// integer square root
+static uint32_t isqrt64(uint64_t v)
+{
+    uint64_t r = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)r;
+}
+
+uint32_t pos_filter_distance_dm(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2)
+{
+    int64_t dlat = (int64_t)lat2 - lat1;
+    int64_t dlon = (int64_t)lon2 - lon1;
+    // shortest way across the antimeridian
+    if (dlon > POS_MAX) {
+        dlon -= 2 * POS_MAX + 1;
+    } else if (dlon < -POS_MAX) {
+        dlon += 2 * POS_MAX + 1;
+    }
+    int64_t dy = (dlat * LAT_UNIT_DM_Q10) >> 10;
+    int64_t dx = (dlon * LON_UNIT_DM_Q10 * cos_lat_q15((int32_t)(((int64_t)lat1 + lat2) / 2))) >> 25;
+    // |dx| and |dy| are below 2^28: no overflow of the sum of the squares
+    return isqrt64((uint64_t)(dx * dx) + (uint64_t)(dy * dy));
+}
+
+// record the position as the last reported one
+static void record(int32_t lat, int32_t lon)
+{
+    has_reported = true;
+    reported_lat = lat;
+    reported_lon = lon;
+    checks_since_report = 0;
+}
+
+bool pos_filter_check(int32_t lat, int32_t lon, uint16_t threshold_m, uint16_t refresh)
+{
+    pos_filter_skip();
+    if (has_reported && checks_since_report < refresh
+        && pos_filter_distance_dm(reported_lat, reported_lon, lat, lon) < threshold_m * 10UL) {
+        return false;
+    }
+    record(lat, lon);
+    return true;
+}
+
+bool pos_filter_refresh(int32_t lat, int32_t lon, uint16_t refresh)
+{
+    pos_filter_skip();
+    if (has_reported && checks_since_report < refresh) {
+        return false;
+    }
+    record(lat, lon);
+    return true;
+}
+
+void pos_filter_skip(void)
+{
+    if (checks_since_report < UINT16_MAX) {
+        checks_since_report++;
+    }
+}
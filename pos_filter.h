@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Movement filter of the reported positions.
+ *
+ * A fix is reported when it is the first one, when the distance from the last reported
+ * position is above a threshold or when the last report is too old (slow refresh). The
+ * distance is computed with the equirectangular approximation, with integers only (the
+ * error is below 1% for distances up to a few tens of kilometers).
+ *
+ * This file has no dependency on RIOT.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef POS_FILTER_H
+#define POS_FILTER_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Distance between two positions
+ *
+ * @param lat1  the latitude of the first position (24-bit binary format)
+ * @param lon1  the longitude of the first position (24-bit binary format)
+ * @param lat2  the latitude of the second position (24-bit binary format)
+ * @param lon2  the longitude of the second position (24-bit binary format)
+ *
+ * @return the distance in decimeters
+ */
+uint32_t pos_filter_distance_dm(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2);
+
+/**
+ * Check if a fix has to be reported (and record it as the last reported position)
+ *
+ * @param lat           the latitude (24-bit binary format)
+ * @param lon           the longitude (24-bit binary format)
+ * @param threshold_m   the min distance (in meters) of a movement
+ * @param refresh       the max number of checks between two reports
+ *
+ * @return true if the fix has to be reported
+ */
+bool pos_filter_check(int32_t lat, int32_t lon, uint16_t threshold_m, uint16_t refresh);
+
+/**
+ * Check if the last known position has to be reported after an acquisition without a fix
+ * (and record it as the last reported position): only for the slow refresh
+ *
+ * @param lat           the last known latitude (24-bit binary format)
+ * @param lon           the last known longitude (24-bit binary format)
+ * @param refresh       the max number of checks between two reports
+ *
+ * @return true if the last known position has to be reported
+ */
+bool pos_filter_refresh(int32_t lat, int32_t lon, uint16_t refresh);
+
+/**
+ * Count a frame without a fix (for the slow refresh)
+ */
+void pos_filter_skip(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Deferred actions scheduled by downlink commands.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include "irq.h"
+#include "thread.h"
+#include "ztimer.h"
+
+#include "sched_action.h"
+
+#define SCHED_ACTION_MSG_QUEUE          (4U)
+
+static const char *action_names[SCHED_ACTION_NUMOF] = {
+        "reboot",
+        "config apply",
+        "clock resync",
+        "class revert",
+};
+
+typedef struct {
+    sched_action_handler_t handler;
+    ztimer_t timer;
+    msg_t msg;
+    bool pending;
+    /*
+     * @brief Incremented at each (re)scheduling for discarding the messages of cancelled timers
+     */
+    uint16_t generation;
+} sched_action_t;
+
+static sched_action_t actions[SCHED_ACTION_NUMOF];
+
+static msg_t _sched_queue[SCHED_ACTION_MSG_QUEUE];
+static char _sched_stack[THREAD_STACKSIZE_DEFAULT];
+static kernel_pid_t sched_pid = KERNEL_PID_UNDEF;
+
+static void *_sched_action_loop(void *arg)
+{
+    (void)arg;
+    msg_init_queue(_sched_queue, SCHED_ACTION_MSG_QUEUE);
+
+    while (1) {
+        msg_t msg;
+        msg_receive(&msg);
+
+        sched_action_id_t id = msg.type;
+        if (id >= SCHED_ACTION_NUMOF) {
+            continue;
+        }
+
+        sched_action_t *action = actions + id;
+        unsigned state = irq_disable();
+        bool run = action->pending && (action->generation == msg.content.value);
+        if (run) {
+            action->pending = false;
+        }
+        irq_restore(state);
+
+        if (run) {
+            DEBUG("[sched] run action: %s\n", action_names[id]);
+            action->handler(id);
+        } else {
+            DEBUG("[sched] discard cancelled action: %s\n", action_names[id]);
+        }
+    }
+    return NULL;
+}
+
+void sched_action_init(void)
+{
+    if (sched_pid != KERNEL_PID_UNDEF) {
+        return;
+    }
+    sched_pid = thread_create(_sched_stack, sizeof(_sched_stack),
+                  THREAD_PRIORITY_MAIN - 1, 0, _sched_action_loop, NULL, "SCHED");
+}
+
+int8_t sched_action_register(sched_action_id_t id, sched_action_handler_t handler)
+{
+    if (id >= SCHED_ACTION_NUMOF) {
+        return SCHED_ACTION_ERROR_UNKNOWN;
+    }
+    actions[id].handler = handler;
+    return SCHED_ACTION_OK;
+}
+
+int8_t sched_action_schedule(sched_action_id_t id, uint32_t delay_sec)
+{
+    if (id >= SCHED_ACTION_NUMOF) {
+        return SCHED_ACTION_ERROR_UNKNOWN;
+    }
+    sched_action_t *action = actions + id;
+    if (action->handler == NULL) {
+        return SCHED_ACTION_ERROR_NO_HANDLER;
+    }
+
+    ztimer_remove(ZTIMER_SEC, &action->timer);
+
+    unsigned state = irq_disable();
+    action->generation++;
+    action->pending = true;
+    action->msg.type = id;
+    action->msg.content.value = action->generation;
+    irq_restore(state);
+
+    ztimer_set_msg(ZTIMER_SEC, &action->timer, delay_sec, &action->msg, sched_pid);
+    DEBUG("[sched] action %s in %ld sec\n", action_names[id], delay_sec);
+
+    return SCHED_ACTION_OK;
+}
+
+bool sched_action_cancel(sched_action_id_t id)
+{
+    if (id >= SCHED_ACTION_NUMOF) {
+        return false;
+    }
+    sched_action_t *action = actions + id;
+
+    ztimer_remove(ZTIMER_SEC, &action->timer);
+
+    unsigned state = irq_disable();
+    bool was_pending = action->pending;
+    action->pending = false;
+    irq_restore(state);
+
+    if (was_pending) {
+        DEBUG("[sched] action %s cancelled\n", action_names[id]);
+    }
+    return was_pending;
+}
+
+void sched_action_cancel_all(void)
+{
+    for (unsigned i = 0; i < SCHED_ACTION_NUMOF; i++) {
+        sched_action_cancel(i);
+    }
+}
+
+bool sched_action_is_pending(sched_action_id_t id)
+{
+    return (id < SCHED_ACTION_NUMOF) && actions[id].pending;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Deferred actions (reboot, config apply, clock resync ...) scheduled by downlink commands.
+ *
+ * The actions are run from a dedicated thread when their timer fires, so the receiver
+ * thread returns immediately to semtech_loramac_recv. A pending action can be cancelled
+ * or rescheduled.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef SCHED_ACTION_H
+#define SCHED_ACTION_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Identifiers of the actions
+ */
+typedef enum {
+    SCHED_ACTION_REBOOT         = 0,
+    SCHED_ACTION_CONFIG_APPLY   = 1,
+    SCHED_ACTION_CLOCK_RESYNC   = 2,
+    SCHED_ACTION_CLASS_REVERT   = 3,
+    SCHED_ACTION_NUMOF
+} sched_action_id_t;
+
+/**
+ * Handler of an action (run by the thread of the scheduler)
+ */
+typedef void (*sched_action_handler_t)(sched_action_id_t id);
+
+#define SCHED_ACTION_OK                 (int8_t)0
+#define SCHED_ACTION_ERROR_UNKNOWN      (int8_t)-1
+#define SCHED_ACTION_ERROR_NO_HANDLER   (int8_t)-2
+
+/**
+ * Start the thread of the scheduler
+ */
+void sched_action_init(void);
+
+/**
+ * Register the handler of an action
+ *
+ * @param id        the identifier of the action
+ * @param handler   the handler
+ */
+int8_t sched_action_register(sched_action_id_t id, sched_action_handler_t handler);
+
+/**
+ * Schedule an action (a pending action with the same identifier is rescheduled)
+ *
+ * @param id        the identifier of the action
+ * @param delay_sec the delay in seconds before running the action
+ */
+int8_t sched_action_schedule(sched_action_id_t id, uint32_t delay_sec);
+
+/**
+ * Cancel a pending action
+ *
+ * @param id        the identifier of the action
+ *
+ * @return true if the action was pending
+ */
+bool sched_action_cancel(sched_action_id_t id);
+
+/**
+ * Cancel all the pending actions
+ */
+void sched_action_cancel_all(void);
+
+/**
+ * Check if an action is pending
+ *
+ * @param id        the identifier of the action
+ */
+bool sched_action_is_pending(sched_action_id_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
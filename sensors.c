@@ -14,6 +14,10 @@
 #include <string.h>
 
 #include "sensors.h"
+#include "payload_codec.h"
+#include "config.h"
+#include "liveness.h"
+#include "timebase.h"
 
 // TODO add LM75 (for lora-e5-dev)
 
@@ -22,7 +26,6 @@
 #include "fmt.h"
 #include "bmx280.h"
 #include "bmx280_params.h"
-#define FLAG_ERROR_BMX280           0x01
 
 static bmx280_t bmx280_dev;
 static bool bmx280_error;
@@ -108,7 +111,6 @@ static int read_bmx280(void)
 
 #if PMS7003 == 1
 #include "pms7003_driver.h"
-#define FLAG_ERROR_PMS7003          0x02
 
 static struct pms7003Data pms7003_data;
 static bool pms7003_error;
@@ -117,7 +119,8 @@ static bool pms7003_error;
 
 #if GPS == 1
 #include "gps.h"
-#define FLAG_ERROR_GPS           0x04
+#include "gps_mgr.h"
+#include "pos_filter.h"
 
 #endif
 
@@ -126,13 +129,13 @@ static bool pms7003_error;
 #include "ds75lx.h"
 #include "ds75lx_params.h"
 static ds75lx_t ds75lx;
-#define FLAG_ERROR_DS75LX           0x08
+static bool ds75lx_error;
 #endif
 
 #if AT30TES75X == 1
 #include "at30tse75x.h"
 static at30tse75x_t at30tse75x;
-#define FLAG_ERROR_AT30TES75X           0x10
+static bool at30tse75x_error;
 #endif
 
 
@@ -146,34 +149,37 @@ uint8_t init_sensors(void) {
 #if BMX280 == 1
     int ret = init_bmx280();
     bmx280_error = (ret!=0);
-    init_error_flags = init_error_flags | FLAG_ERROR_BMX280;
+    init_error_flags = init_error_flags | CODEC_FLAG_BMX280_ERROR;
 #endif
 
 #if PMS7003 == 1
-    int ret2 = pms7003_init(false);
+    pms7003_set_valid_data_delay(config.valid_data_after_wakeup_sec);
+    // the warm-up of the sensor runs during the join: the first measure waits for the valid data
+    int ret2 = pms7003_init_async(false);
     pms7003_error = (ret2!=0);
-    if(ret2==0){
-        pms7003_measure(&pms7003_data);
-        pms7003_print(&pms7003_data);
-
-    } else {
-        pms7003_error = (ret!=0);
-        init_error_flags = init_error_flags | FLAG_ERROR_PMS7003;
+    if(ret2!=0){
+        init_error_flags = init_error_flags | CODEC_FLAG_PMS7003_ERROR;
     }
 #endif
 
 #if GPS == 1
     DEBUG("[gps] GPS is enabled (baudrate=%d)\n",STD_BAUDRATE);
+    // the GPS is monitored after the first valid NMEA sentence
+    liveness_register(LIVENESS_TASK_GPS, "gps", LIVENESS_GPS_MAX_BUSY_MS);
+    gps_init();
+    // the receiver is powered off until the first acquisition
+    gps_mgr_init();
 #endif
 
 #if DS75LX == 1
     DEBUG("[ds75lx] DS75LX sensor is enabled\n");
 
     int result = ds75lx_init(&ds75lx, &ds75lx_params[0]);
+    ds75lx_error = (result != DS75LX_OK);
     if (result != DS75LX_OK)
     {
         DEBUG("[error] Failed to initialize DS75LX sensor\n");
-        init_error_flags = init_error_flags | FLAG_ERROR_DS75LX;
+        init_error_flags = init_error_flags | CODEC_FLAG_DS75LX_ERROR;
     }
 #endif
 
@@ -181,97 +187,119 @@ uint8_t init_sensors(void) {
     DEBUG("[at30tse75x] AT30TES75X sensor is enabled\n");
 
     int result = at30tse75x_init(&at30tse75x, PORT_A, AT30TSE75X_TEMP_ADDR);
+    at30tse75x_error = (result != 0);
     if (result != 0)
     {
         DEBUG("[error] Failed to initialize AT30TES75X sensor\n");
-        init_error_flags = init_error_flags | FLAG_ERROR_AT30TES75X;
+        init_error_flags = init_error_flags | CODEC_FLAG_AT30TSE75X_ERROR;
     }
 #endif
 
 	return init_error_flags;
 }
 
+/**
+ * Apply the runtime configuration to the endpoint's sensors
+ */
+void sensors_apply_config(void) {
+#if PMS7003 == 1
+    pms7003_set_valid_data_delay(config.valid_data_after_wakeup_sec);
+#endif
+}
+
+/*
+ * Sensors of the endpoint (the blocks of the payload)
+ */
+#if BMX280 == 1
+#define SENSORS_BMX280_MASK      CODEC_SENSOR_BMX280
+#else
+#define SENSORS_BMX280_MASK      0
+#endif
+#if defined(MODULE_BME280_SPI) || defined(MODULE_BME280_I2C)
+#define SENSORS_HUMIDITY_MASK    CODEC_SENSOR_HUMIDITY
+#else
+#define SENSORS_HUMIDITY_MASK    0
+#endif
+#if PMS7003 == 1
+#define SENSORS_PMS7003_MASK     CODEC_SENSOR_PMS7003
+#else
+#define SENSORS_PMS7003_MASK     0
+#endif
+#if DS75LX == 1
+#define SENSORS_DS75LX_MASK      CODEC_SENSOR_DS75LX
+#else
+#define SENSORS_DS75LX_MASK      0
+#endif
+#if AT30TES75X == 1
+#define SENSORS_AT30TSE75X_MASK  CODEC_SENSOR_AT30TSE75X
+#else
+#define SENSORS_AT30TSE75X_MASK  0
+#endif
+#if GPS == 1
+#define SENSORS_GPS_MASK         CODEC_SENSOR_GPS
+#else
+#define SENSORS_GPS_MASK         0
+#endif
+
+#define SENSORS_MASK            (SENSORS_BMX280_MASK | SENSORS_HUMIDITY_MASK | SENSORS_PMS7003_MASK \
+                                 | SENSORS_DS75LX_MASK | SENSORS_AT30TSE75X_MASK | SENSORS_GPS_MASK)
+
 /**
  *  Encode message data to the payload.
  *
  */
 uint8_t encode_sensors(uint8_t *payload) {
 
-	payload[0] = 0; // For error flags
+	codec_data_t data;
+	memset(&data, 0, sizeof(data));
 
-	uint8_t i = 1;
+#if GPS == 1
+    // the acquisition of the fix runs during the measures of the other sensors
+    gps_mgr_start();
+#endif
 
 #if BMX280 == 1
     if(!bmx280_error) {
-
         read_bmx280();
-
-        // Encode temperature.
-        memcpy(payload+i, &temperature, sizeof(int16_t));
-        i+=sizeof(int16_t);
-
-        // Encode pressure.
-        uint16_t _pressure = pressure / 10;
-        memcpy(payload+i, &_pressure, sizeof(uint16_t));
-        i+=sizeof(uint16_t);
-
+        data.temperature = temperature;
+        data.pressure = pressure / 10;
 #if defined(MODULE_BME280_SPI) || defined(MODULE_BME280_I2C)
-        // Encode humidity.
-        memcpy(payload+i, &humidity, sizeof(uint16_t));
-        i+=sizeof(uint16_t);
+        data.humidity = humidity;
 #endif
     }  else {
-        payload[0] = payload[0] | FLAG_ERROR_BMX280;
+        data.flags |= CODEC_FLAG_BMX280_ERROR;
     }
-
 #endif
 
 #if PMS7003 == 1
+    bool pms7003_measured = false;
     if(!pms7003_error) {
-
-        pms7003_measure(&pms7003_data);
+        // the measure waits for the wakeup of the sensor
+        liveness_busy_for(LIVENESS_TASK_SENDER, config.valid_data_after_wakeup_sec * 1000U + LIVENESS_SENDER_MAX_BUSY_MS);
+        // a timeout only flags the error for this frame
+        pms7003_measured = (pms7003_measure(&pms7003_data) == 0);
+        liveness_busy(LIVENESS_TASK_SENDER);
+    }
+    if(pms7003_measured) {
         pms7003_print(&pms7003_data);
 #ifdef PMS7003_OUTPUT_CSV
-        // TODO: prefix CSV by timestamp
+        // CSV prefixed by the GPS time in milliseconds
+        printf("%llu;", (unsigned long long)timebase_now_ms());
         pms7003_print_csv(&pms7003_data);
 #endif
-
-        memcpy(payload+i, &pms7003_data.pm1_0Standard, sizeof(uint16_t));
-        i+=sizeof(uint16_t);
-
-        memcpy(payload+i, &pms7003_data.pm2_5Standard, sizeof(uint16_t));
-        i+=sizeof(uint16_t);
-
-        memcpy(payload+i, &pms7003_data.pm10Standard, sizeof(uint16_t));
-        i+=sizeof(uint16_t);
-
-
-        memcpy(payload+i, &pms7003_data.pm1_0Atmospheric, sizeof(uint16_t));
-        i+=sizeof(uint16_t);
-
-        memcpy(payload+i, &pms7003_data.pm2_5Atmospheric, sizeof(uint16_t));
-        i+=sizeof(uint16_t);
-
-        memcpy(payload+i, &pms7003_data.pm10Atmospheric, sizeof(uint16_t));
-        i+=sizeof(uint16_t);
-
-
-        memcpy(payload+i, &pms7003_data.particuleGT0_3, sizeof(uint16_t));
-        i+=sizeof(uint16_t);
-
-        memcpy(payload+i, &pms7003_data.particuleGT0_5, sizeof(uint16_t));
-        i+=sizeof(uint16_t);
-
-        memcpy(payload+i, &pms7003_data.particuleGT1_0, sizeof(uint16_t));
-        i+=sizeof(uint16_t);
-
-        memcpy(payload+i, &pms7003_data.particuleGT2_5, sizeof(uint16_t));
-        i+=sizeof(uint16_t);
-
-        memcpy(payload+i, &pms7003_data.particuleGT10, sizeof(uint16_t));
-        i+=sizeof(uint16_t);
+        data.pm1_0Standard = pms7003_data.pm1_0Standard;
+        data.pm2_5Standard = pms7003_data.pm2_5Standard;
+        data.pm10Standard = pms7003_data.pm10Standard;
+        data.pm1_0Atmospheric = pms7003_data.pm1_0Atmospheric;
+        data.pm2_5Atmospheric = pms7003_data.pm2_5Atmospheric;
+        data.pm10Atmospheric = pms7003_data.pm10Atmospheric;
+        data.particuleGT0_3 = pms7003_data.particuleGT0_3;
+        data.particuleGT0_5 = pms7003_data.particuleGT0_5;
+        data.particuleGT1_0 = pms7003_data.particuleGT1_0;
+        data.particuleGT2_5 = pms7003_data.particuleGT2_5;
+        data.particuleGT10 = pms7003_data.particuleGT10;
     }  else {
-        payload[0] = payload[0] | FLAG_ERROR_PMS7003;
+        data.flags |= CODEC_FLAG_PMS7003_ERROR;
     }
 #endif
 
@@ -285,14 +313,9 @@ uint8_t encode_sensors(uint8_t *payload) {
 		ds75lx_read_temperature(&ds75lx, &temperature);
 		ds75lx_shutdown(&ds75lx);
 		DEBUG("[ds75lx] get temperature : temperature=%d\n",temperature);
-
-		// Encode temperature.
-		payload[i++] = (temperature >> 8) & 0xFF;
-		payload[i++] = (temperature >> 0) & 0xFF;
-
-		if(len < sizeof(int16_t) + (2*3)+ sizeof(int16_t)) {
-			return sizeof(int16_t);
-		}
+		data.ds75lx_temperature = temperature;
+    } else {
+        data.flags |= CODEC_FLAG_DS75LX_ERROR;
     }
 #endif
 
@@ -308,14 +331,9 @@ uint8_t encode_sensors(uint8_t *payload) {
 		temperature = (int16_t)(ftemp * 100);
 		//at30tse75x_shutdown(&at30tse75x);
 		DEBUG("[at30tse75x] get temperature : temperature=%d\n",temperature);
-
-		// Encode temperature.
-		payload[i++] = (temperature >> 8) & 0xFF;
-		payload[i++] = (temperature >> 0) & 0xFF;
-
-		if(len < sizeof(int16_t) + (2*3)+ sizeof(int16_t)) {
-			return sizeof(int16_t);
-		}
+		data.at30tse75x_temperature = temperature;
+    } else {
+        data.flags |= CODEC_FLAG_AT30TSE75X_ERROR;
     }
 #endif
 
@@ -324,24 +342,29 @@ uint8_t encode_sensors(uint8_t *payload) {
 	int32_t lon = 0;
 	int16_t alt = 0;
 
-	gps_get_binary(&lat, &lon, &alt);
-    DEBUG("[gps] get position : lat=%ld, lon=%ld, alt=%d\n",lat,lon,alt);
-
-    // Encode latitude (on 24 bits).
-	payload[i++] = ((uint32_t)lat >> 16) & 0xFF;
-	payload[i++] = ((uint32_t)lat >> 8)  & 0xFF;
-	payload[i++] = ((uint32_t)lat >> 0)  & 0xFF;
-
-    // Encode longitude (on 24 bits).
-	payload[i++] = ((uint32_t)lon >> 16) & 0xFF;
-	payload[i++] = ((uint32_t)lon >> 8)  & 0xFF;
-	payload[i++] = ((uint32_t)lon >> 0)  & 0xFF;
-
-    // Encode altitude (on 16 bits);
-	payload[i++] = ((int16_t)alt >> 8) & 0xFF;
-	payload[i++] = ((int16_t)alt >> 0) & 0xFF;
-
+	uint8_t gps_ret = gps_mgr_get_position(&lat, &lon, &alt);
+	if(gps_ret != GPS_MGR_FIX) {
+        data.flags |= CODEC_FLAG_GPS_ERROR;
+        if(gps_ret != GPS_MGR_LAST_KNOWN) {
+            pos_filter_skip();
+        } else if(pos_filter_refresh(lat, lon, config.gps_refresh_frames)) {
+            DEBUG("[gps] report last known position : lat=%ld, lon=%ld, alt=%d\n",lat,lon,alt);
+            // slow refresh without a fix: the last known position with the GPS error flag
+            data.flags |= CODEC_FLAG_POSITION;
+            data.latitude = lat;
+            data.longitude = lon;
+            data.altitude = alt;
+        }
+	} else if(pos_filter_check(lat, lon, config.gps_move_threshold_m, config.gps_refresh_frames)) {
+        DEBUG("[gps] report position : lat=%ld, lon=%ld, alt=%d\n",lat,lon,alt);
+        // after a movement or for the slow refresh
+        data.flags |= CODEC_FLAG_POSITION;
+        data.latitude = lat;
+        data.longitude = lon;
+        data.altitude = alt;
+	}
 #endif
 
-	return i;
+	// same codec as the backend (generated from tools/codec/payload.json)
+	return codec_encode(&data, SENSORS_MASK, payload);
 }
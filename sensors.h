@@ -13,11 +13,21 @@
 
 #include <stdint.h>
 
+/**
+ * Flag of the first byte of the payload: the payload includes the position (not an error)
+ */
+#define SENSORS_FLAG_GPS_POSITION       0x40
+
 /**
  * Initialize the endpoint's sensors
  */
 uint8_t init_sensors(void);
 
+/**
+ * Apply the runtime configuration to the endpoint's sensors
+ */
+void sensors_apply_config(void);
+
 /**
  *  Encode message data to the payload.
  *
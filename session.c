@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Persistence of the LoRaWAN session across the reboots.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include <string.h>
+
+#include "net/loramac.h"
+#include "semtech_loramac.h"
+
+#include "loramac_utils.h"
+#include "persist.h"
+#include "session.h"
+
+typedef struct {
+    /*
+     * @brief Hash of the identity of the device: a session of another identity is discarded
+     */
+    uint32_t owner;
+    uint8_t devaddr[LORAMAC_DEVADDR_LEN];
+    uint8_t nwkskey[LORAMAC_NWKSKEY_LEN];
+    uint8_t appskey[LORAMAC_APPSKEY_LEN];
+    /*
+     * @brief FCntUp reserved by the last save: the next uplinks use counters above it
+     */
+    uint32_t fcnt_up;
+    /*
+     * @brief RX2 frequency and DR of the Join Accept (DLSettings) or of the last RXParamSetupReq
+     */
+    uint32_t rx2_freq;
+    uint8_t rx2_dr;
+    /*
+     * @brief DR at the last save (the DR changes by ADR are saved with the FCntUp only)
+     */
+    uint8_t dr;
+    /*
+     * @brief Number of the next boots without restore (backoff after a restored session not validated)
+     */
+    uint8_t skip_boots;
+    /*
+     * @brief Number of the consecutive restored sessions not validated
+     */
+    uint8_t failures;
+} session_t;
+
+static session_t session;
+static bool saved = false;
+static uint8_t skip_boots = 0;
+static uint8_t failures = 0;
+
+static bool restored = false;
+static bool validated = false;
+static bool invalid = false;
+static uint8_t cnt_validation_uplinks = 0;
+
+static uint32_t fnv1a(const uint8_t *data, size_t len)
+{
+    uint32_t h = 2166136261UL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+static void write_session(void)
+{
+    if (persist_write(PERSIST_ID_SESSION, &session, sizeof(session)) == PERSIST_OK) {
+        saved = true;
+        DEBUG("[session] saved fcnt_up=%ld dr=%d\n", session.fcnt_up, session.dr);
+    }
+}
+
+bool session_restore(semtech_loramac_t *loramac, const uint8_t *id, size_t id_len, bool otaa)
+{
+    if (persist_read(PERSIST_ID_SESSION, &session, sizeof(session)) != sizeof(session)) {
+        DEBUG("[session] no saved session\n");
+        return false;
+    }
+    if (session.owner != fnv1a(id, id_len)) {
+        DEBUG("[session] saved session of another identity\n");
+        session_erase();
+        return false;
+    }
+
+    if (otaa) {
+        failures = session.failures;
+        if (!SESSION_RESTORE_OTAA) {
+            // the RxDelay, the RX1DROffset and the CFList of the network cannot be restored
+            DEBUG("[session] restore disabled: join\n");
+            return false;
+        }
+        if (session.skip_boots > 0) {
+            // the record of the joined session (session_save) counts this boot
+            skip_boots = session.skip_boots - 1;
+            DEBUG("[session] restore skipped after %d invalid sessions (%d boots left): join\n", failures,
+                  skip_boots);
+            return false;
+        }
+        semtech_loramac_set_devaddr(loramac, session.devaddr);
+        semtech_loramac_set_nwkskey(loramac, session.nwkskey);
+        semtech_loramac_set_appskey(loramac, session.appskey);
+        // the session keys are activated like an ABP session
+        uint8_t ret = semtech_loramac_join(loramac, LORAMAC_JOIN_ABP);
+        if (ret != SEMTECH_LORAMAC_JOIN_SUCCEEDED) {
+            DEBUG("[session] cannot activate the session: %d (%s)\n", ret, loramac_utils_err_message(ret));
+            return false;
+        }
+        semtech_loramac_set_dr(loramac, session.dr);
+        semtech_loramac_set_rx2_freq(loramac, session.rx2_freq);
+        semtech_loramac_set_rx2_dr(loramac, session.rx2_dr);
+    }
+    semtech_loramac_set_uplink_counter(loramac, session.fcnt_up);
+
+    // reserve the next counters before any uplink
+    session.fcnt_up += SESSION_FCNT_GAP;
+    write_session();
+
+    // the keys of an ABP session are static: only an OTAA session should be validated
+    restored = otaa;
+    validated = false;
+    cnt_validation_uplinks = 0;
+    DEBUG("[session] restored: DevAddr:"); printf_ba(session.devaddr, LORAMAC_DEVADDR_LEN);
+    DEBUG(" fcnt_up=%ld dr=%d rx2_freq=%ld rx2_dr=%d\n", semtech_loramac_get_uplink_counter(loramac), session.dr,
+          session.rx2_freq, session.rx2_dr);
+    return true;
+}
+
+void session_save(semtech_loramac_t *loramac, const uint8_t *id, size_t id_len)
+{
+    session.owner = fnv1a(id, id_len);
+    semtech_loramac_get_devaddr(loramac, session.devaddr);
+    semtech_loramac_get_nwkskey(loramac, session.nwkskey);
+    semtech_loramac_get_appskey(loramac, session.appskey);
+    session.fcnt_up = semtech_loramac_get_uplink_counter(loramac) + SESSION_FCNT_GAP;
+    session.rx2_freq = semtech_loramac_get_rx2_freq(loramac);
+    session.rx2_dr = semtech_loramac_get_rx2_dr(loramac);
+    session.dr = semtech_loramac_get_dr(loramac);
+    session.skip_boots = skip_boots;
+    session.failures = failures;
+    write_session();
+
+    // a fresh session does not need to be validated
+    restored = false;
+}
+
+void session_before_uplink(semtech_loramac_t *loramac)
+{
+    if (restored && !validated) {
+        semtech_loramac_request_link_check(loramac);
+    }
+}
+
+bool session_after_uplink(semtech_loramac_t *loramac, uint8_t ret)
+{
+    if (!saved) {
+        return !invalid;
+    }
+
+    // the DR (changed by ADR, link_adapt or DRPWSZ) is saved with the FCntUp only
+    uint32_t fcnt_up = semtech_loramac_get_uplink_counter(loramac);
+    if (fcnt_up + 1 >= session.fcnt_up) {
+        session.fcnt_up = fcnt_up + SESSION_FCNT_GAP;
+        session.dr = semtech_loramac_get_dr(loramac);
+        session.rx2_freq = semtech_loramac_get_rx2_freq(loramac);
+        session.rx2_dr = semtech_loramac_get_rx2_dr(loramac);
+        write_session();
+    }
+
+    // only the transmitted uplinks carry the LinkCheckReq
+    bool transmitted = (ret == SEMTECH_LORAMAC_TX_DONE || ret == SEMTECH_LORAMAC_TX_CNF_FAILED);
+    if (restored && !validated && transmitted && ++cnt_validation_uplinks >= SESSION_VALIDATION_UPLINKS) {
+        DEBUG("[session] no LinkCheckAns after %d uplinks: the restored session is invalid\n", cnt_validation_uplinks);
+        // the network may use RX parameters which cannot be restored (or the gateways are down):
+        // join at the next boots, for twice as many boots after each invalid session
+        if (failures < SESSION_RESTORE_MAX_FAILURES) {
+            failures++;
+        }
+        session.failures = failures;
+        session.skip_boots = (uint8_t)((1U << failures) - 1);
+        persist_write(PERSIST_ID_SESSION, &session, sizeof(session));
+        saved = false;
+        restored = false;
+        invalid = true;
+    }
+    return !invalid;
+}
+
+bool session_valid(void)
+{
+    return !invalid;
+}
+
+void session_link_check_received(void)
+{
+    if (restored && !validated) {
+        DEBUG("[session] restored session validated\n");
+        // the backoff of the restore is reset
+        if (saved && session.failures != 0) {
+            failures = 0;
+            session.failures = 0;
+            write_session();
+        }
+    }
+    validated = true;
+}
+
+void session_erase(void)
+{
+    persist_erase(PERSIST_ID_SESSION);
+    saved = false;
+    restored = false;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Persistence of the LoRaWAN session across the reboots.
+ *
+ * The session (DevAddr, session keys, FCntUp, DR) is saved into the flash after the join.
+ * At boot, a valid session is restored without a new join. The FCntUp is saved with a gap
+ * (SESSION_FCNT_GAP) so the flash is written once every SESSION_FCNT_GAP uplinks and a
+ * counter is never reused after a reboot. The restored session is validated by LinkCheckReq
+ * on the first uplinks: without any answer, the session is erased and the endpoint rejoins.
+ *
+ * The RX2 frequency and DR (DLSettings of the Join Accept) are saved and restored. The DR is
+ * saved with the FCntUp only (no flash write at each DR change by ADR).
+ *
+ * Remark: semtech_loramac does not expose the DevNonce and the FCntDown: they are not saved.
+ * The FCntDown restarts at 0 and the next downlinks are accepted within the MAX_FCNT_GAP.
+ * semtech_loramac does not expose the RxDelay, the RX1DROffset and the CFList channels either:
+ * the restore of the OTAA sessions is disabled when the network sets them (SESSION_RESTORE_OTAA=0).
+ * Otherwise, after a restored session which is not validated, the endpoint joins at the next
+ * 1, 3, 7 ... boots (backoff doubled after each invalid session, reset by a validated session).
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "semtech_loramac.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Number of uplinks reserved at each save of the FCntUp
+ */
+#ifndef SESSION_FCNT_GAP
+#define SESSION_FCNT_GAP                (64U)
+#endif
+
+/*
+ * Number of uplinks with a LinkCheckReq for validating a restored session
+ */
+#ifndef SESSION_VALIDATION_UPLINKS
+#define SESSION_VALIDATION_UPLINKS      (3U)
+#endif
+
+/*
+ * Max number of the consecutive invalid sessions counted by the backoff of the restore
+ * (2^SESSION_RESTORE_MAX_FAILURES - 1 boots without restore)
+ */
+#ifndef SESSION_RESTORE_MAX_FAILURES
+#define SESSION_RESTORE_MAX_FAILURES    (6U)
+#endif
+
+/*
+ * Restore the OTAA sessions (0 when the network sets a RxDelay, a RX1DROffset or a CFList
+ * which differ from the defaults of the region)
+ */
+#ifndef SESSION_RESTORE_OTAA
+#define SESSION_RESTORE_OTAA            (1)
+#endif
+
+/**
+ * Restore the session saved into the flash
+ *
+ * @param loramac   the loramac descriptor
+ * @param id        the identity of the device (DevEUI + AppKey for OTAA, DevAddr + NwkSKey for ABP)
+ * @param id_len    the length of the identity
+ * @param otaa      true for restoring the DevAddr and the session keys of an OTAA session
+ *
+ * @return true if the session is restored
+ */
+bool session_restore(semtech_loramac_t *loramac, const uint8_t *id, size_t id_len, bool otaa);
+
+/**
+ * Save the session after a join
+ *
+ * @param loramac   the loramac descriptor
+ * @param id        the identity of the device
+ * @param id_len    the length of the identity
+ */
+void session_save(semtech_loramac_t *loramac, const uint8_t *id, size_t id_len);
+
+/**
+ * Prepare an uplink: a LinkCheckReq is requested when the restored session is not validated yet
+ * (called before each semtech_loramac_send)
+ *
+ * @param loramac   the loramac descriptor
+ */
+void session_before_uplink(semtech_loramac_t *loramac);
+
+/**
+ * Update the saved FCntUp after an uplink and check the validation of a restored session
+ * (called after each semtech_loramac_send: data frames, retries and stats frames)
+ *
+ * Only the transmitted uplinks (SEMTECH_LORAMAC_TX_DONE, SEMTECH_LORAMAC_TX_CNF_FAILED) count
+ * for the validation.
+ *
+ * @param loramac   the loramac descriptor
+ * @param ret       the return code of semtech_loramac_send
+ *
+ * @return false if the restored session is invalid (the endpoint should rejoin)
+ */
+bool session_after_uplink(semtech_loramac_t *loramac, uint8_t ret);
+
+/**
+ * Check the restored session after the uplinks
+ *
+ * @return false if the restored session is invalid (the endpoint should rejoin)
+ */
+bool session_valid(void);
+
+/**
+ * Report a LinkCheckAns (the restored session is valid)
+ */
+void session_link_check_received(void);
+
+/**
+ * Erase the saved session
+ */
+void session_erase(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
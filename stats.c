@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Statistics of the uplinks and the downlinks.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include <string.h>
+
+#include "mutex.h"
+#include "semtech_loramac.h"
+#include "ztimer.h"
+
+#include "loramac_dutycycle.h"
+#include "persist.h"
+#include "stats.h"
+
+#define STATS_VERSION                   (2U)
+
+// RECEIVE_DELAY1 and RECEIVE_DELAY2 of LoRaWAN
+#define STATS_RX1_DELAY_MS              (1000U)
+#define STATS_RX2_DELAY_MS              (2000U)
+
+// a downlink received later than this delay after the start of the uplink is not counted into RX1/RX2
+#define STATS_RX_MAX_DELAY_MS           (10000U)
+
+// upper bounds (in msec) of the buckets of the histogram of the send durations
+static const uint32_t bucket_bounds[STATS_NB_BUCKETS] = {
+        1000, 2000, 3000, 4000, 6000, 8000, 16000, UINT32_MAX
+};
+
+typedef struct {
+    uint16_t send_duration[STATS_NB_DR][STATS_NB_BUCKETS];
+    uint32_t ret_codes[STATS_RET_NUMOF];
+    uint32_t rx1;
+    uint32_t rx2;
+    uint32_t rx_other;
+    uint32_t link_checks;
+    uint32_t margin_sum;
+    uint32_t class_c_sec;
+    uint8_t margin_min;
+    uint8_t margin_max;
+    uint8_t gw_max;
+    uint8_t rfu;
+} stats_t;
+
+static stats_t stats;
+static mutex_t stats_mutex = MUTEX_INIT;
+
+// the last uplink
+static ztimer_now_t tx_start = 0;
+static uint8_t tx_dr = 0;
+static uint8_t tx_len = 0;
+static bool tx_valid = false;
+static uint16_t cnt_tx_since_save = 0;
+
+// start of the Class C window in progress (0 if none)
+static ztimer_now_t class_c_start = 0;
+
+static inline void inc16(uint16_t *cnt)
+{
+    if (*cnt < UINT16_MAX) {
+        (*cnt)++;
+    }
+}
+
+static inline uint16_t sat16(uint32_t v)
+{
+    return (v > UINT16_MAX) ? UINT16_MAX : v;
+}
+
+static stats_ret_t map_ret(uint8_t ret)
+{
+    switch (ret) {
+        case SEMTECH_LORAMAC_TX_DONE:
+            return STATS_RET_TX_DONE;
+        case SEMTECH_LORAMAC_TX_CNF_FAILED:
+            return STATS_RET_TX_CNF_FAILED;
+        case SEMTECH_LORAMAC_DUTYCYCLE_RESTRICTED:
+            return STATS_RET_DUTYCYCLE_RESTRICTED;
+        case SEMTECH_LORAMAC_BUSY:
+            return STATS_RET_BUSY;
+        case SEMTECH_LORAMAC_NOT_JOINED:
+            return STATS_RET_NOT_JOINED;
+        default:
+            return STATS_RET_OTHER;
+    }
+}
+
+void stats_reset(void)
+{
+    mutex_lock(&stats_mutex);
+    memset(&stats, 0, sizeof(stats));
+    stats.margin_min = UINT8_MAX;
+    mutex_unlock(&stats_mutex);
+}
+
+void stats_init(void)
+{
+    stats_reset();
+    if (persist_read(PERSIST_ID_STATS, &stats, sizeof(stats)) == sizeof(stats)) {
+        DEBUG("[stats] statistics loaded from flash\n");
+    } else {
+        stats_reset();
+    }
+}
+
+int8_t stats_save(void)
+{
+    mutex_lock(&stats_mutex);
+    int8_t ret = persist_write(PERSIST_ID_STATS, &stats, sizeof(stats));
+    cnt_tx_since_save = 0;
+    mutex_unlock(&stats_mutex);
+    return ret;
+}
+
+void stats_tx_start(uint8_t dr, uint8_t len)
+{
+    mutex_lock(&stats_mutex);
+    tx_start = ztimer_now(ZTIMER_MSEC);
+    tx_dr = dr;
+    tx_len = len;
+    tx_valid = true;
+    mutex_unlock(&stats_mutex);
+}
+
+void stats_tx_end(uint8_t ret)
+{
+    mutex_lock(&stats_mutex);
+    uint32_t duration = ztimer_now(ZTIMER_MSEC) - tx_start;
+
+    uint8_t dr = (tx_dr < STATS_NB_DR) ? tx_dr : STATS_NB_DR - 1;
+    uint8_t b = 0;
+    while (duration > bucket_bounds[b]) {
+        b++;
+    }
+    inc16(&stats.send_duration[dr][b]);
+    stats.ret_codes[map_ret(ret)]++;
+
+    bool save = (++cnt_tx_since_save >= STATS_SAVE_PERIOD);
+    mutex_unlock(&stats_mutex);
+
+    DEBUG("[stats] send dr=%d ret=%d duration=%ld msec\n", tx_dr, ret, duration);
+    if (save) {
+        stats_save();
+    }
+}
+
+void stats_rx(uint8_t len)
+{
+    ztimer_now_t now = ztimer_now(ZTIMER_MSEC);
+
+    mutex_lock(&stats_mutex);
+    uint32_t offset = now - tx_start;
+    if (!tx_valid || offset > STATS_RX_MAX_DELAY_MS) {
+        // Class C downlink or too late for the RX windows of the last uplink
+        stats.rx_other++;
+    } else {
+        // compare the arrival time with the end of the expected RX1 and RX2 receptions
+        uint32_t up_toa = loramac_dutycycle_time_on_air_ms(tx_dr, tx_len);
+        uint32_t rx1_end = up_toa + STATS_RX1_DELAY_MS + loramac_dutycycle_time_on_air_ms(tx_dr, len);
+        uint32_t rx2_end = up_toa + STATS_RX2_DELAY_MS + loramac_dutycycle_time_on_air_ms(STATS_RX2_DR, len);
+        uint32_t d1 = (offset > rx1_end) ? offset - rx1_end : rx1_end - offset;
+        uint32_t d2 = (offset > rx2_end) ? offset - rx2_end : rx2_end - offset;
+        if (d1 <= d2) {
+            stats.rx1++;
+        } else {
+            stats.rx2++;
+        }
+        DEBUG("[stats] downlink %ld msec after the uplink: RX%d\n", offset, (d1 <= d2) ? 1 : 2);
+    }
+    mutex_unlock(&stats_mutex);
+}
+
+void stats_link_check(uint8_t demod_margin, uint8_t nb_gateways)
+{
+    mutex_lock(&stats_mutex);
+    stats.link_checks++;
+    stats.margin_sum += demod_margin;
+    if (demod_margin < stats.margin_min) {
+        stats.margin_min = demod_margin;
+    }
+    if (demod_margin > stats.margin_max) {
+        stats.margin_max = demod_margin;
+    }
+    if (nb_gateways > stats.gw_max) {
+        stats.gw_max = nb_gateways;
+    }
+    mutex_unlock(&stats_mutex);
+}
+
+void stats_class_c_start(void)
+{
+    mutex_lock(&stats_mutex);
+    if (class_c_start == 0) {
+        class_c_start = ztimer_now(ZTIMER_SEC);
+    }
+    mutex_unlock(&stats_mutex);
+}
+
+void stats_class_c_end(void)
+{
+    mutex_lock(&stats_mutex);
+    if (class_c_start != 0) {
+        stats.class_c_sec += ztimer_now(ZTIMER_SEC) - class_c_start;
+        class_c_start = 0;
+    }
+    mutex_unlock(&stats_mutex);
+    DEBUG("[stats] time in Class C: %ld sec\n", stats.class_c_sec);
+}
+
+/*
+ * Index of the bucket containing the given percentile of the samples of a DR
+ */
+static uint8_t percentile_bucket(const uint16_t *hist, uint32_t total, uint8_t percent)
+{
+    uint32_t threshold = (total * percent + 99) / 100;
+    uint32_t cumul = 0;
+    for (uint8_t b = 0; b < STATS_NB_BUCKETS; b++) {
+        cumul += hist[b];
+        if (cumul >= threshold) {
+            return b;
+        }
+    }
+    return STATS_NB_BUCKETS - 1;
+}
+
+static inline void put16(uint8_t *buf, uint8_t *i, uint32_t v)
+{
+    uint16_t s = sat16(v);
+    buf[(*i)++] = s & 0xFF;
+    buf[(*i)++] = (s >> 8) & 0xFF;
+}
+
+/*
+ * Payload (little endian):
+ * <version><6 x return code counts (2 bytes)><rx1 (2)><rx2 (2)><rx other (2)><link checks (2)>
+ * <margin min><margin avg><margin max><gateways max><class C time in minutes (2)><nb DR entries>
+ * then for each DR with samples: <dr><count (2)><median bucket (4 bits) | p90 bucket (4 bits)>
+ */
+uint8_t stats_encode(uint8_t *buf)
+{
+    uint8_t i = 0;
+
+    mutex_lock(&stats_mutex);
+    buf[i++] = STATS_VERSION;
+    for (unsigned r = 0; r < STATS_RET_NUMOF; r++) {
+        put16(buf, &i, stats.ret_codes[r]);
+    }
+    put16(buf, &i, stats.rx1);
+    put16(buf, &i, stats.rx2);
+    put16(buf, &i, stats.rx_other);
+    put16(buf, &i, stats.link_checks);
+    buf[i++] = stats.link_checks ? stats.margin_min : 0;
+    buf[i++] = stats.link_checks ? stats.margin_sum / stats.link_checks : 0;
+    buf[i++] = stats.margin_max;
+    buf[i++] = stats.gw_max;
+    put16(buf, &i, stats.class_c_sec / 60);
+
+    uint8_t nb_dr_idx = i++;
+    buf[nb_dr_idx] = 0;
+    for (uint8_t dr = 0; dr < STATS_NB_DR; dr++) {
+        uint32_t total = 0;
+        for (uint8_t b = 0; b < STATS_NB_BUCKETS; b++) {
+            total += stats.send_duration[dr][b];
+        }
+        if (total == 0) {
+            continue;
+        }
+        buf[i++] = dr;
+        put16(buf, &i, total);
+        buf[i++] = (percentile_bucket(stats.send_duration[dr], total, 50) << 4)
+                 | percentile_bucket(stats.send_duration[dr], total, 90);
+        buf[nb_dr_idx]++;
+    }
+    mutex_unlock(&stats_mutex);
+
+    return i;
+}
+
+void stats_print(void)
+{
+    static const char *ret_names[STATS_RET_NUMOF] = {
+            "TX_DONE", "TX_CNF_FAILED", "DUTYCYCLE_RESTRICTED", "BUSY", "NOT_JOINED", "OTHER"
+    };
+
+    mutex_lock(&stats_mutex);
+    printf("[stats] send duration (msec):");
+    for (uint8_t b = 0; b < STATS_NB_BUCKETS - 1; b++) {
+        printf(" <=%ld", bucket_bounds[b]);
+    }
+    printf(" >%ld\n", bucket_bounds[STATS_NB_BUCKETS - 2]);
+    for (uint8_t dr = 0; dr < STATS_NB_DR; dr++) {
+        printf("[stats]   DR%d:", dr);
+        for (uint8_t b = 0; b < STATS_NB_BUCKETS; b++) {
+            printf(" %d", stats.send_duration[dr][b]);
+        }
+        printf("\n");
+    }
+    for (unsigned r = 0; r < STATS_RET_NUMOF; r++) {
+        printf("[stats] %s: %ld\n", ret_names[r], stats.ret_codes[r]);
+    }
+    printf("[stats] RX1: %ld RX2: %ld other: %ld\n", stats.rx1, stats.rx2, stats.rx_other);
+    printf("[stats] time in Class C: %ld sec\n", stats.class_c_sec);
+    if (stats.link_checks) {
+        printf("[stats] link checks: %ld margin min/avg/max: %d/%ld/%d dB gateways max: %d\n",
+                stats.link_checks, stats.margin_min, stats.margin_sum / stats.link_checks,
+                stats.margin_max, stats.gw_max);
+    } else {
+        printf("[stats] link checks: 0\n");
+    }
+    mutex_unlock(&stats_mutex);
+}
+
+int stats_cmd(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        stats_reset();
+        stats_save();
+        puts("[stats] reset");
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "save") == 0) {
+        return stats_save();
+    }
+    stats_print();
+    return 0;
+}
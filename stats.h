@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Statistics of the uplinks and the downlinks.
+ *
+ * The statistics contain an histogram of the duration of the semtech_loramac_send calls per DR,
+ * the counts per return code, the RX1/RX2 hits and a summary of the link check answers.
+ * They are saved periodically into the flash and sent into a diagnostics uplink.
+ *
+ * Remark: semtech_loramac does not expose the RSSI/SNR of the downlinks nor the RX slot.
+ * The RX slot is estimated from the arrival time of the downlink and the link quality is
+ * summarized from the demodulation margin of the LinkCheckAns.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Port of the diagnostics uplink
+ */
+#ifndef STATS_PORT
+#define STATS_PORT                      (103U)
+#endif
+
+/*
+ * Number of uplinks between two saves of the statistics into the flash
+ */
+#ifndef STATS_SAVE_PERIOD
+#define STATS_SAVE_PERIOD               (48U)
+#endif
+
+/*
+ * Datarate of the RX2 window (DR0 for EU868 by default, DR3 for TTN EU868)
+ */
+#ifndef STATS_RX2_DR
+#define STATS_RX2_DR                    (0U)
+#endif
+
+/*
+ * Number of datarates and number of buckets of the histogram of the send durations
+ */
+#define STATS_NB_DR                     (8U)
+#define STATS_NB_BUCKETS                (8U)
+
+/*
+ * Max size of the diagnostics uplink
+ */
+#define STATS_UPLINK_MAX_SIZE           (28U + 4U * STATS_NB_DR)
+
+/**
+ * Return codes counted by the statistics
+ */
+typedef enum {
+    STATS_RET_TX_DONE = 0,
+    STATS_RET_TX_CNF_FAILED,
+    STATS_RET_DUTYCYCLE_RESTRICTED,
+    STATS_RET_BUSY,
+    STATS_RET_NOT_JOINED,
+    STATS_RET_OTHER,
+    STATS_RET_NUMOF
+} stats_ret_t;
+
+/**
+ * Load the statistics from the flash
+ */
+void stats_init(void);
+
+/**
+ * Record the start of a semtech_loramac_send call
+ *
+ * @param dr    the datarate of the uplink
+ * @param len   the length of the application payload
+ */
+void stats_tx_start(uint8_t dr, uint8_t len);
+
+/**
+ * Record the end of a semtech_loramac_send call
+ *
+ * @param ret   the return code of semtech_loramac_send
+ */
+void stats_tx_end(uint8_t ret);
+
+/**
+ * Record a downlink (the RX slot is estimated from the start of the last uplink)
+ *
+ * @param len   the length of the application payload
+ */
+void stats_rx(uint8_t len);
+
+/**
+ * Record a link check answer
+ *
+ * @param demod_margin  the demodulation margin in dB
+ * @param nb_gateways   the number of gateways
+ */
+void stats_link_check(uint8_t demod_margin, uint8_t nb_gateways);
+
+/**
+ * Record the start of a Class C window
+ */
+void stats_class_c_start(void);
+
+/**
+ * Record the end of a Class C window
+ */
+void stats_class_c_end(void);
+
+/**
+ * Encode the diagnostics uplink
+ *
+ * @param buf   the buffer (at least STATS_UPLINK_MAX_SIZE bytes)
+ *
+ * @return the size of the payload
+ */
+uint8_t stats_encode(uint8_t *buf);
+
+/**
+ * Save the statistics into the flash
+ */
+int8_t stats_save(void);
+
+/**
+ * Reset the statistics
+ */
+void stats_reset(void);
+
+/**
+ * Print the statistics
+ */
+void stats_print(void);
+
+/**
+ * Shell command for printing (or resetting with "reset") the statistics
+ */
+int stats_cmd(int argc, char *argv[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Time base in milliseconds since the GPS epoch (Sunday 6th of January 1980).
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include "irq.h"
+#include "ztimer.h"
+
+#if MODULE_PERIPH_RTC == 1
+#include "periph/rtc.h"
+#endif
+
+#include "timebase.h"
+
+#define SEC_PER_DAY                 (24UL * 60UL * 60UL)
+
+// days between 1970-01-01 and 1980-01-06 (the GPS epoch)
+#define GPS_EPOCH_UNIX_DAYS         (3657L)
+
+// default time when the RTC is not available: 2021-01-01 00:00:00
+#define TIMEBASE_DEFAULT_GPS_SEC    (1293494400UL)
+
+#define TM_YEAR_OFFSET              (1900)
+
+// 64-bit extension of ZTIMER_MSEC
+static uint32_t last_ticks = 0;
+static uint64_t uptime_ms = 0;
+
+// time - uptime
+static int64_t offset_ms = 0;
+
+// last time returned (monotonic)
+static uint64_t last_stamp_ms = 0;
+
+/*
+ * Days since 1970-01-01 of a date of the proleptic Gregorian calendar
+ * (H. Hinnant, chrono-Compatible Low-Level Date Algorithms)
+ */
+static int32_t days_from_civil(int32_t y, uint32_t m, uint32_t d)
+{
+    y -= (m <= 2);
+    int32_t era = (y >= 0 ? y : y - 399) / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+static void civil_from_days(int32_t z, int32_t *y, uint32_t *m, uint32_t *d)
+{
+    z += 719468;
+    int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    uint32_t doe = (uint32_t)(z - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    *d = doy - (153 * mp + 2) / 5 + 1;
+    *m = mp < 10 ? mp + 3 : mp - 9;
+    *y = (int32_t)yoe + era * 400 + (*m <= 2);
+}
+
+void timebase_to_civil(uint32_t gps_sec, timebase_civil_t *civil)
+{
+    uint32_t days = gps_sec / SEC_PER_DAY;
+    uint32_t secs = gps_sec % SEC_PER_DAY;
+    int32_t y;
+    uint32_t m, d;
+    civil_from_days((int32_t)days + GPS_EPOCH_UNIX_DAYS, &y, &m, &d);
+    civil->year = (uint16_t)y;
+    civil->month = (uint8_t)m;
+    civil->day = (uint8_t)d;
+    civil->hour = (uint8_t)(secs / 3600);
+    civil->min = (uint8_t)((secs / 60) % 60);
+    civil->sec = (uint8_t)(secs % 60);
+    // the GPS epoch is a Sunday
+    civil->wday = (uint8_t)(days % 7);
+}
+
+uint32_t timebase_from_civil(const timebase_civil_t *civil)
+{
+    int32_t days = days_from_civil(civil->year, civil->month, civil->day) - GPS_EPOCH_UNIX_DAYS;
+    if (days < 0) {
+        return 0;
+    }
+    return (uint32_t)days * SEC_PER_DAY + civil->hour * 3600UL + civil->min * 60UL + civil->sec;
+}
+
+#if MODULE_PERIPH_RTC == 1
+static void write_rtc(uint32_t gps_sec)
+{
+    timebase_civil_t civil;
+    timebase_to_civil(gps_sec, &civil);
+    struct tm time = {
+        .tm_year = civil.year - TM_YEAR_OFFSET,
+        .tm_mon = civil.month - 1,
+        .tm_mday = civil.day,
+        .tm_hour = civil.hour,
+        .tm_min = civil.min,
+        .tm_sec = civil.sec,
+        .tm_wday = civil.wday,
+        .tm_yday = days_from_civil(civil.year, civil.month, civil.day)
+                   - days_from_civil(civil.year, 1, 1),
+    };
+    rtc_set_time(&time);
+}
+#endif
+
+/*
+ * Update the 64-bit uptime (to call with the interrupts disabled)
+ */
+static uint64_t update_uptime_ms(void)
+{
+    uint32_t ticks = ztimer_now(ZTIMER_MSEC);
+    uptime_ms += (uint32_t)(ticks - last_ticks);
+    last_ticks = ticks;
+    return uptime_ms;
+}
+
+void timebase_init(void)
+{
+    uint32_t gps_sec = TIMEBASE_DEFAULT_GPS_SEC;
+#if MODULE_PERIPH_RTC == 1
+    struct tm time;
+    if (rtc_get_time(&time) == 0) {
+        timebase_civil_t civil = {
+            .year = time.tm_year + TM_YEAR_OFFSET,
+            .month = time.tm_mon + 1,
+            .day = time.tm_mday,
+            .hour = time.tm_hour,
+            .min = time.tm_min,
+            .sec = time.tm_sec,
+        };
+        gps_sec = timebase_from_civil(&civil);
+    }
+#endif
+    unsigned state = irq_disable();
+    last_ticks = ztimer_now(ZTIMER_MSEC);
+    uptime_ms = 0;
+    offset_ms = (int64_t)gps_sec * 1000;
+    last_stamp_ms = 0;
+    irq_restore(state);
+    DEBUG("[time] GPS time=%lu sec\n", (unsigned long)gps_sec);
+}
+
+uint64_t timebase_now_ms(void)
+{
+    unsigned state = irq_disable();
+    uint64_t now = update_uptime_ms() + offset_ms;
+    if (now < last_stamp_ms) {
+        // frozen after a backward correction
+        now = last_stamp_ms;
+    } else {
+        last_stamp_ms = now;
+    }
+    irq_restore(state);
+    return now;
+}
+
+uint32_t timebase_now_sec(void)
+{
+    return (uint32_t)(timebase_now_ms() / 1000);
+}
+
+void timebase_set(uint32_t gps_sec)
+{
+    unsigned state = irq_disable();
+    offset_ms = (int64_t)gps_sec * 1000 - (int64_t)update_uptime_ms();
+    // the time may go backward
+    last_stamp_ms = 0;
+    irq_restore(state);
+#if MODULE_PERIPH_RTC == 1
+    write_rtc(gps_sec);
+#endif
+}
+
+void timebase_adjust(int32_t delta_sec)
+{
+    if (delta_sec < -TIMEBASE_MAX_FREEZE_SEC) {
+        timebase_set(timebase_now_sec() + delta_sec);
+        return;
+    }
+    unsigned state = irq_disable();
+    offset_ms += (int64_t)delta_sec * 1000;
+    uint64_t now = update_uptime_ms() + offset_ms;
+    irq_restore(state);
+#if MODULE_PERIPH_RTC == 1
+    write_rtc((uint32_t)(now / 1000));
+#else
+    (void)now;
+#endif
+}
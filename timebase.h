@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Time base in milliseconds since the GPS epoch (Sunday 6th of January 1980).
+ *
+ * The RTC is read once at the initialization: the time is then the 64-bit extension of
+ * ZTIMER_MSEC plus an offset, so reading the time costs no RTC access and no libc time call.
+ * The time is monotonic: a small backward correction (up to TIMEBASE_MAX_FREEZE_SEC) freezes
+ * the time until it is caught up. The RTC is written at each correction for keeping the
+ * time across the reboots.
+ *
+ * The RTC holds the GPS time as a civil date (no leap seconds). The civil dates are converted
+ * with integer arithmetic (no mktime/localtime, no TZ).
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Max backward correction (in seconds) keeping the time monotonic (larger ones set the time)
+ */
+#ifndef TIMEBASE_MAX_FREEZE_SEC
+#define TIMEBASE_MAX_FREEZE_SEC         (60)
+#endif
+
+/**
+ * Civil date (GPS time)
+ */
+typedef struct {
+    uint16_t year;      /**< year (1980 - 2115) */
+    uint8_t month;      /**< month (1 - 12) */
+    uint8_t day;        /**< day of the month (1 - 31) */
+    uint8_t hour;       /**< hours (0 - 23) */
+    uint8_t min;        /**< minutes (0 - 59) */
+    uint8_t sec;        /**< seconds (0 - 59) */
+    uint8_t wday;       /**< day of the week (0 for Sunday) */
+} timebase_civil_t;
+
+/**
+ * Initialize the time base from the RTC
+ */
+void timebase_init(void);
+
+/**
+ * Get the time
+ *
+ * @return the time in milliseconds since the GPS epoch
+ */
+uint64_t timebase_now_ms(void);
+
+/**
+ * Get the time
+ *
+ * @return the time in seconds since the GPS epoch (modulo 2^32)
+ */
+uint32_t timebase_now_sec(void);
+
+/**
+ * Set the time (and the RTC)
+ *
+ * @param gps_sec   the time in seconds since the GPS epoch
+ */
+void timebase_set(uint32_t gps_sec);
+
+/**
+ * Correct the time (and the RTC)
+ *
+ * @param delta_sec the correction in seconds
+ */
+void timebase_adjust(int32_t delta_sec);
+
+/**
+ * Convert a time into a civil date
+ *
+ * @param gps_sec   the time in seconds since the GPS epoch
+ * @param civil     the civil date
+ */
+void timebase_to_civil(uint32_t gps_sec, timebase_civil_t *civil);
+
+/**
+ * Convert a civil date into a time
+ *
+ * @param civil     the civil date (wday is ignored)
+ *
+ * @return the time in seconds since the GPS epoch
+ */
+uint32_t timebase_from_civil(const timebase_civil_t *civil);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Fuzz driver of the App Clock Sync downlinks (app_clock_parse and app_clock_process_downlink).
+ *
+ * Each input is parsed from a buffer of its exact size (the sanitizers catch the reads
+ * beyond the payload), checked against the invariants of the parser, processed as a
+ * port 202 downlink and followed by the trailer of a data frame.
+ *
+ * Built with -DAPP_CLOCK_FUZZ_LIBFUZZER, this is a libFuzzer target (clang -fsanitize=fuzzer).
+ * Otherwise, a standalone driver replays the corpus then mutates it:
+ *
+ * Usage: app_clock_fuzz [-n MUTATIONS] [-r SEED] CORPUS_FILE_OR_DIR...
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app_clock.h"
+#include "timebase.h"
+#include "ztimer.h"
+
+#define KNOWN_FLAGS     (APP_CLOCK_CMD_PACKAGE_VERSION | APP_CLOCK_CMD_APP_TIME | APP_CLOCK_CMD_PERIODICITY \
+                         | APP_CLOCK_CMD_FORCE_RESYNC | APP_CLOCK_CMD_APP_TIME_SET)
+
+static semtech_loramac_t loramac;
+
+void printf_ba(const uint8_t *ba, size_t len)
+{
+    (void)ba;
+    (void)len;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static bool initialized = false;
+    if (!initialized) {
+        timebase_init();
+        initialized = true;
+    }
+    if (size > sizeof(loramac.rx_data.payload)) {
+        return 0;
+    }
+
+    // exact size: a read beyond the payload is reported by the sanitizers
+    uint8_t *payload = malloc(size ? size : 1);
+    memcpy(payload, data, size);
+
+    app_clock_cmds_t cmds;
+    int8_t ret = app_clock_parse(payload, (uint8_t)size, &cmds);
+    assert(ret == APP_CLOCK_OK || ret == APP_CLOCK_UNKNOWN_CID || ret == APP_CLOCK_ERROR_OVERFLOW
+           || ret == APP_CLOCK_CID_ALREADY_PROCESS);
+    assert((cmds.flags & ~KNOWN_FLAGS) == 0);
+    assert(cmds.token_ans <= 0x0F && cmds.period <= 0x0F && cmds.nb_transmissions <= 0x07);
+    assert(ret != APP_CLOCK_OK || size > 0 || cmds.flags == 0);
+    free(payload);
+
+    memcpy(loramac.rx_data.payload, data, size);
+    loramac.rx_data.payload_len = (uint8_t)size;
+    loramac.rx_data.port = APP_CLOCK_PORT;
+    ret = app_clock_process_downlink(&loramac);
+    assert(ret <= APP_CLOCK_OK && ret >= APP_CLOCK_TX_RETRY_LATER);
+
+    // the trailer of the next data frame fits into its max length
+    uint8_t trailer[64];
+    uint8_t max_len = size ? data[0] % sizeof(trailer) : 0;
+    memset(trailer, 0xA5, sizeof(trailer));
+    uint8_t len = app_clock_encode_trailer(trailer, max_len, app_clock_time_req_due(10));
+    assert(len <= max_len);
+    for (size_t i = len; i < sizeof(trailer); i++) {
+        assert(trailer[i] == 0xA5);
+    }
+    app_clock_discipline();
+    app_clock_trailer_sent((size & 1) ? SEMTECH_LORAMAC_TX_DONE : SEMTECH_LORAMAC_DUTYCYCLE_RESTRICTED);
+    ztimer_sleep(ZTIMER_SEC, 60);
+    return 0;
+}
+
+#ifndef APP_CLOCK_FUZZ_LIBFUZZER
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include "random.h"
+
+#define MAX_INPUTS      (256U)
+#define MAX_INPUT_LEN   (64U)
+
+static uint8_t inputs[MAX_INPUTS][MAX_INPUT_LEN];
+static size_t input_lens[MAX_INPUTS];
+static unsigned nb_inputs = 0;
+
+static void load_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL || nb_inputs >= MAX_INPUTS) {
+        if (f != NULL) {
+            fclose(f);
+        }
+        return;
+    }
+    input_lens[nb_inputs] = fread(inputs[nb_inputs], 1, MAX_INPUT_LEN, f);
+    fclose(f);
+    LLVMFuzzerTestOneInput(inputs[nb_inputs], input_lens[nb_inputs]);
+    nb_inputs++;
+}
+
+static void load(const char *path)
+{
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        load_file(path);
+        return;
+    }
+    struct dirent *e;
+    while ((e = readdir(dir)) != NULL) {
+        if (e->d_name[0] == '.') {
+            continue;
+        }
+        char file[1024];
+        snprintf(file, sizeof(file), "%s/%s", path, e->d_name);
+        load_file(file);
+    }
+    closedir(dir);
+}
+
+/*
+ * Mutation of a corpus input: flips, changes, insertions and removals of bytes
+ */
+static size_t mutate(uint8_t *buf, size_t len)
+{
+    unsigned nb = 1 + random_uint32_range(0, 4);
+    for (unsigned i = 0; i < nb; i++) {
+        uint32_t pos = len ? random_uint32_range(0, len) : 0;
+        switch (random_uint32_range(0, 5)) {
+        case 0:
+            if (len) {
+                buf[pos] ^= 1 << random_uint32_range(0, 8);
+            }
+            break;
+        case 1:
+            if (len) {
+                buf[pos] = (uint8_t)random_uint32();
+            }
+            break;
+        case 2:
+            if (len < MAX_INPUT_LEN) {
+                memmove(buf + pos + 1, buf + pos, len - pos);
+                buf[pos] = (uint8_t)random_uint32_range(0, 4);
+                len++;
+            }
+            break;
+        case 3:
+            if (len) {
+                memmove(buf + pos, buf + pos + 1, len - pos - 1);
+                len--;
+            }
+            break;
+        default:
+            // truncation
+            len = pos;
+            break;
+        }
+    }
+    return len;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long mutations = 100000;
+    uint32_t seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+        switch (opt) {
+        case 'n': mutations = strtoul(optarg, NULL, 0); break;
+        case 'r': seed = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-n MUTATIONS] [-r SEED] CORPUS_FILE_OR_DIR...\n", argv[0]);
+            return 1;
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        load(argv[i]);
+    }
+    if (nb_inputs == 0) {
+        fprintf(stderr, "empty corpus\n");
+        return 1;
+    }
+
+    random_init(seed);
+    for (unsigned long n = 0; n < mutations; n++) {
+        uint8_t buf[MAX_INPUT_LEN];
+        unsigned k = random_uint32_range(0, nb_inputs);
+        memcpy(buf, inputs[k], input_lens[k]);
+        size_t len = mutate(buf, input_lens[k]);
+        LLVMFuzzerTestOneInput(buf, len);
+    }
+    printf("app_clock_fuzz: %u corpus inputs, %lu mutations: no failure\n", nb_inputs, mutations);
+    return 0;
+}
+
+#endif
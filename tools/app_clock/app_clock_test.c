@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host test of the App Clock Sync package (app_clock.c, clock_disc.c and timebase.c).
+ *
+ * The sequences of the specification are replayed through app_clock_process_downlink with a
+ * mock MAC (the uplinks are the trailers of the data frames built like the sender of main.c)
+ * and a virtual RTC. The test checks the bytes of the uplinks and the corrections of the RTC,
+ * then measures the cost of app_clock_parse.
+ *
+ * Usage: app_clock_test (exit code 1 on failure)
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "app_clock.h"
+#include "periph/rtc.h"
+#include "timebase.h"
+#include "ztimer.h"
+
+// seconds between the Unix epoch and the GPS epoch (timebase has no leap seconds)
+#define GPS_EPOCH_UNIX_SEC      (315964800L)
+
+// same as main.c
+#define APP_TIME_REQ_PERIOD     (10U)
+
+static semtech_loramac_t loramac;
+static unsigned failures = 0;
+static unsigned checks = 0;
+
+// uplink of the mock MAC
+static uint8_t uplink[64];
+static uint8_t uplink_len;
+
+#define CHECK(cond, ...) \
+    do { \
+        checks++; \
+        if (!(cond)) { \
+            failures++; \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while (0)
+
+void printf_ba(const uint8_t *ba, size_t len)
+{
+    (void)ba;
+    (void)len;
+}
+
+static void put_u32le(uint8_t *buf, uint32_t v)
+{
+    buf[0] = (uint8_t)v;
+    buf[1] = (uint8_t)(v >> 8);
+    buf[2] = (uint8_t)(v >> 16);
+    buf[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_u32le(const uint8_t *buf)
+{
+    return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+static int8_t downlink(const uint8_t *payload, uint8_t len)
+{
+    memcpy(loramac.rx_data.payload, payload, len);
+    loramac.rx_data.payload_len = len;
+    loramac.rx_data.port = APP_CLOCK_PORT;
+    return app_clock_process_downlink(&loramac);
+}
+
+/*
+ * Data frame built like the sender: the trailer, the capture of the times before each
+ * attempt (the retries are delay_ms apart) and the result of the send
+ */
+static uint8_t send_frame(bool time_req, uint8_t max_len, uint8_t attempts, uint32_t delay_ms, uint8_t ret)
+{
+    uplink_len = app_clock_encode_trailer(uplink, max_len, time_req);
+    for (uint8_t i = 0; i < attempts; i++) {
+        if (i > 0) {
+            ztimer_sleep(ZTIMER_MSEC, delay_ms);
+        }
+        app_clock_restamp_trailer();
+    }
+    app_clock_trailer_sent(ret);
+    return uplink_len;
+}
+
+static bool uplink_equals(const uint8_t *expected, uint8_t len)
+{
+    return uplink_len == len && memcmp(uplink, expected, len) == 0;
+}
+
+static uint32_t rtc_gps_sec(void)
+{
+    struct tm time;
+    if (rtc_get_time(&time) != 0) {
+        return 0;
+    }
+    return (uint32_t)(timegm(&time) - GPS_EPOCH_UNIX_SEC);
+}
+
+static void test_package_version(void)
+{
+    const uint8_t req[] = { APP_CLOCK_CID_PackageVersionReq };
+    CHECK(downlink(req, sizeof(req)) == APP_CLOCK_OK, "PackageVersionReq");
+    CHECK(app_clock_is_pending_buffer(), "PackageVersionAns pending");
+
+    // not transmitted: the answer is kept for the next frame
+    send_frame(false, 32, 1, 0, SEMTECH_LORAMAC_DUTYCYCLE_RESTRICTED);
+    const uint8_t ans[] = { APP_CLOCK_CID_PackageVersionAns, APP_CLOCK_PACKAGE_IDENTIFIER, APP_CLOCK_PACKAGE_VERSION };
+    CHECK(uplink_equals(ans, sizeof(ans)), "PackageVersionAns (restricted)");
+    CHECK(app_clock_is_pending_buffer(), "PackageVersionAns kept after DUTYCYCLE_RESTRICTED");
+
+    send_frame(false, 32, 1, 0, SEMTECH_LORAMAC_TX_DONE);
+    CHECK(uplink_equals(ans, sizeof(ans)), "PackageVersionAns");
+    CHECK(!app_clock_is_pending_buffer(), "PackageVersionAns cleared after TX_DONE");
+
+    send_frame(false, 32, 1, 0, SEMTECH_LORAMAC_TX_DONE);
+    CHECK(uplink_len == 0, "no trailer without answer (len=%d)", uplink_len);
+}
+
+static void test_app_time(void)
+{
+    ztimer_sleep(ZTIMER_SEC, 100);
+    CHECK(app_clock_time_req_due(APP_TIME_REQ_PERIOD), "first AppTimeReq due");
+
+    // AppTimeReq DeviceTime TokenReq=0 AnsRequired=1, captured again at the retry 3 seconds later
+    uint32_t before = timebase_now_sec();
+    send_frame(true, 32, 2, 3000, SEMTECH_LORAMAC_TX_DONE);
+    CHECK(uplink_len == APP_CLOCK_APP_TIME_REQ_SIZE && uplink[0] == APP_CLOCK_CID_AppTimeReq,
+          "AppTimeReq (len=%d)", uplink_len);
+    CHECK(get_u32le(uplink + 1) == before + 3, "DeviceTime of the retry: %u expected %u",
+          get_u32le(uplink + 1), before + 3);
+    CHECK(uplink[5] == 0x10, "TokenReq=0 AnsRequired=1: %02x", uplink[5]);
+    CHECK(!app_clock_time_req_due(APP_TIME_REQ_PERIOD), "AppTimeReq not due while waiting the answer");
+
+    // AppTimeAns with a bad TokenAns: discarded
+    uint32_t writes = host_rtc_writes;
+    uint32_t now = timebase_now_sec();
+    uint8_t bad[1 + APP_CLOCK_APP_TIME_ANS_LEN] = { APP_CLOCK_CID_AppTimeAns };
+    put_u32le(bad + 1, 10);
+    bad[5] = 5;
+    CHECK(downlink(bad, sizeof(bad)) == APP_CLOCK_BAD_TOKEN, "AppTimeAns with a bad TokenAns");
+    CHECK(timebase_now_sec() == now && host_rtc_writes == writes, "RTC unchanged by a bad TokenAns");
+
+    // AppTimeAns TimeCorrection=+10 TokenAns=0
+    uint8_t good[1 + APP_CLOCK_APP_TIME_ANS_LEN] = { APP_CLOCK_CID_AppTimeAns };
+    put_u32le(good + 1, 10);
+    good[5] = 0;
+    CHECK(downlink(good, sizeof(good)) == APP_CLOCK_OK, "AppTimeAns");
+    CHECK(timebase_now_sec() == now + 10, "time corrected by +10: %u expected %u", timebase_now_sec(), now + 10);
+    CHECK(host_rtc_writes == writes + 1 && rtc_gps_sec() == now + 10, "RTC written: %u expected %u",
+          rtc_gps_sec(), now + 10);
+
+    // negative correction
+    ztimer_sleep(ZTIMER_SEC, 4000);
+    CHECK(app_clock_time_req_due(APP_TIME_REQ_PERIOD), "AppTimeReq due after the interval");
+    send_frame(true, 32, 1, 0, SEMTECH_LORAMAC_TX_CNF_FAILED);
+    CHECK(uplink_len == APP_CLOCK_APP_TIME_REQ_SIZE && uplink[5] == 0x11, "TokenReq=1 after a valid answer: %02x",
+          uplink[5]);
+    now = timebase_now_sec();
+    put_u32le(good + 1, (uint32_t)-3);
+    good[5] = 1;
+    CHECK(downlink(good, sizeof(good)) == APP_CLOCK_OK, "AppTimeAns -3");
+    CHECK(rtc_gps_sec() == now - 3, "RTC corrected by -3: %u expected %u", rtc_gps_sec(), now - 3);
+
+    // unanswered AppTimeReq: sent again after APP_TIME_REQ_PERIOD frames
+    ztimer_sleep(ZTIMER_SEC, 8000);
+    CHECK(app_clock_time_req_due(APP_TIME_REQ_PERIOD), "AppTimeReq due");
+    send_frame(true, 32, 1, 0, SEMTECH_LORAMAC_TX_DONE);
+    unsigned frames = 1;
+    while (!app_clock_time_req_due(APP_TIME_REQ_PERIOD) && frames < 100) {
+        frames++;
+    }
+    CHECK(frames == APP_TIME_REQ_PERIOD, "AppTimeReq sent again after %u frames", frames);
+    send_frame(true, 32, 1, 0, SEMTECH_LORAMAC_TX_DONE);
+    put_u32le(good + 1, 0);
+    good[5] = 2;
+    CHECK(downlink(good, sizeof(good)) == APP_CLOCK_OK, "AppTimeAns 0");
+}
+
+static void test_periodicity(void)
+{
+    // DeviceAppTimePeriodicityReq Period=3 (1024 seconds +/- 30)
+    const uint8_t req[] = { APP_CLOCK_CID_DeviceAppTimePeriodicityReq, 3 };
+    CHECK(downlink(req, sizeof(req)) == APP_CLOCK_OK, "DeviceAppTimePeriodicityReq");
+
+    // the Time is captured before the transmission, again at the retry
+    ztimer_sleep(ZTIMER_SEC, 7);
+    uint32_t before = timebase_now_sec();
+    send_frame(false, 32, 3, 2000, SEMTECH_LORAMAC_TX_DONE);
+    CHECK(uplink_len == 1 + APP_CLOCK_PERIODICITY_ANS_LEN && uplink[0] == APP_CLOCK_CID_DeviceAppTimePeriodicityAns
+          && uplink[1] == 0, "DeviceAppTimePeriodicityAns NotSupported=0 (len=%d)", uplink_len);
+    CHECK(get_u32le(uplink + 2) == before + 4, "Time of the last attempt: %u expected %u", get_u32le(uplink + 2),
+          before + 4);
+
+    // the next AppTimeReq follows the periodicity
+    ztimer_sleep(ZTIMER_SEC, 10);
+    CHECK(!app_clock_time_req_due(APP_TIME_REQ_PERIOD), "AppTimeReq not due before the period");
+    ztimer_sleep(ZTIMER_SEC, 1024);
+    CHECK(app_clock_time_req_due(APP_TIME_REQ_PERIOD), "AppTimeReq due after the period");
+    send_frame(true, 32, 1, 0, SEMTECH_LORAMAC_TX_DONE);
+    uint8_t ans[1 + APP_CLOCK_APP_TIME_ANS_LEN] = { APP_CLOCK_CID_AppTimeAns, 0, 0, 0, 0, 3 };
+    CHECK(downlink(ans, sizeof(ans)) == APP_CLOCK_OK, "AppTimeAns");
+    ztimer_sleep(ZTIMER_SEC, 1024 - 31);
+    CHECK(!app_clock_time_req_due(APP_TIME_REQ_PERIOD), "AppTimeReq not due before 1024-30 seconds");
+    ztimer_sleep(ZTIMER_SEC, 62);
+    CHECK(app_clock_time_req_due(APP_TIME_REQ_PERIOD), "AppTimeReq due after 1024+30 seconds");
+    send_frame(true, 32, 1, 0, SEMTECH_LORAMAC_TX_DONE);
+    ans[5] = 4;
+    CHECK(downlink(ans, sizeof(ans)) == APP_CLOCK_OK, "AppTimeAns");
+}
+
+static void test_force_resync(void)
+{
+    // NbTransmissions=0: silently discarded
+    const uint8_t none[] = { APP_CLOCK_CID_ForceDeviceResyncReq, 0 };
+    CHECK(downlink(none, sizeof(none)) == APP_CLOCK_OK, "ForceDeviceResyncReq NbTransmissions=0");
+    CHECK(!app_clock_is_pending_buffer(), "no answer to ForceDeviceResyncReq");
+    CHECK(!app_clock_time_req_due(APP_TIME_REQ_PERIOD), "no AppTimeReq for NbTransmissions=0");
+
+    // NbTransmissions=3: one AppTimeReq AnsRequired=0 per transmitted data frame
+    const uint8_t three[] = { APP_CLOCK_CID_ForceDeviceResyncReq, 3 | 0xF8 };
+    CHECK(downlink(three, sizeof(three)) == APP_CLOCK_OK, "ForceDeviceResyncReq NbTransmissions=3 (RFU set)");
+    unsigned sent = 0;
+    for (unsigned frame = 0; frame < 6; frame++) {
+        if (!app_clock_time_req_due(APP_TIME_REQ_PERIOD)) {
+            continue;
+        }
+        // the second frame is not transmitted: the AppTimeReq is not counted
+        uint8_t ret = (frame == 1) ? SEMTECH_LORAMAC_BUSY : SEMTECH_LORAMAC_TX_DONE;
+        send_frame(true, 32, 1, 0, ret);
+        CHECK(uplink_len == APP_CLOCK_APP_TIME_REQ_SIZE && uplink[5] == 5, "forced AppTimeReq TokenReq=5 "
+              "AnsRequired=0: %02x", uplink[5]);
+        sent += (ret == SEMTECH_LORAMAC_TX_DONE);
+    }
+    CHECK(sent == 3, "3 forced AppTimeReq transmitted (%u)", sent);
+
+    // a valid AppTimeAns stops the resynchronization
+    CHECK(downlink(three, sizeof(three)) == APP_CLOCK_OK, "ForceDeviceResyncReq NbTransmissions=3");
+    send_frame(app_clock_time_req_due(APP_TIME_REQ_PERIOD), 32, 1, 0, SEMTECH_LORAMAC_TX_DONE);
+    const uint8_t ans[1 + APP_CLOCK_APP_TIME_ANS_LEN] = { APP_CLOCK_CID_AppTimeAns, 0, 0, 0, 0, 5 };
+    CHECK(downlink(ans, sizeof(ans)) == APP_CLOCK_OK, "AppTimeAns");
+    CHECK(!app_clock_time_req_due(APP_TIME_REQ_PERIOD), "resync stopped by the AppTimeAns");
+}
+
+static void test_truncated(void)
+{
+    uint32_t writes = host_rtc_writes;
+    uint32_t now = timebase_now_sec();
+
+    const uint8_t time_ans[] = { APP_CLOCK_CID_AppTimeAns, 10, 0, 0 };
+    CHECK(downlink(time_ans, sizeof(time_ans)) == APP_CLOCK_ERROR_OVERFLOW, "truncated AppTimeAns");
+    const uint8_t periodicity[] = { APP_CLOCK_CID_DeviceAppTimePeriodicityReq };
+    CHECK(downlink(periodicity, sizeof(periodicity)) == APP_CLOCK_ERROR_OVERFLOW, "truncated PeriodicityReq");
+    const uint8_t resync[] = { APP_CLOCK_CID_ForceDeviceResyncReq };
+    CHECK(downlink(resync, sizeof(resync)) == APP_CLOCK_ERROR_OVERFLOW, "truncated ForceDeviceResyncReq");
+    const uint8_t set[] = { X_APP_CLOCK_CID_AppTimeSetReq, 1, 2 };
+    CHECK(downlink(set, sizeof(set)) == APP_CLOCK_ERROR_OVERFLOW, "truncated AppTimeSetReq");
+    CHECK(timebase_now_sec() == now && host_rtc_writes == writes, "RTC unchanged by the truncated commands");
+    CHECK(!app_clock_is_pending_buffer(), "no answer to the truncated commands");
+
+    // the commands before the error are processed
+    const uint8_t version_then_truncated[] = { APP_CLOCK_CID_PackageVersionReq, APP_CLOCK_CID_DeviceAppTimePeriodicityReq };
+    CHECK(downlink(version_then_truncated, sizeof(version_then_truncated)) == APP_CLOCK_ERROR_OVERFLOW,
+          "PackageVersionReq then truncated");
+    send_frame(false, 32, 1, 0, SEMTECH_LORAMAC_TX_DONE);
+    CHECK(uplink_len == 3 && uplink[0] == APP_CLOCK_CID_PackageVersionAns, "PackageVersionAns before the error");
+
+    const uint8_t unknown[] = { 0x7F, 0x00 };
+    CHECK(downlink(unknown, sizeof(unknown)) == APP_CLOCK_UNKNOWN_CID, "unknown CID");
+    const uint8_t twice[] = { APP_CLOCK_CID_PackageVersionReq, APP_CLOCK_CID_PackageVersionReq };
+    CHECK(downlink(twice, sizeof(twice)) == APP_CLOCK_CID_ALREADY_PROCESS, "duplicated command");
+    send_frame(false, 32, 1, 0, SEMTECH_LORAMAC_TX_DONE);
+    CHECK(uplink_len == 3, "a single PackageVersionAns (len=%d)", uplink_len);
+    CHECK(downlink(unknown, 0) == APP_CLOCK_OK, "empty payload");
+    CHECK(!app_clock_is_pending_buffer(), "no answer to an empty payload");
+}
+
+static void test_trailer_size(void)
+{
+    // the AppTimeReq does not fit: it is sent into the next frame
+    const uint8_t req[] = { APP_CLOCK_CID_PackageVersionReq };
+    CHECK(downlink(req, sizeof(req)) == APP_CLOCK_OK, "PackageVersionReq");
+    send_frame(true, 5, 1, 0, SEMTECH_LORAMAC_TX_DONE);
+    CHECK(uplink_len == 3, "AppTimeReq left out of a 5 bytes trailer (len=%d)", uplink_len);
+    CHECK(app_clock_time_req_due(APP_TIME_REQ_PERIOD), "AppTimeReq due at the next frame");
+    send_frame(true, 2, 1, 0, SEMTECH_LORAMAC_TX_DONE);
+    CHECK(uplink_len == 0, "nothing fits into a 2 bytes trailer (len=%d)", uplink_len);
+    CHECK(app_clock_time_req_due(APP_TIME_REQ_PERIOD), "AppTimeReq still due");
+    send_frame(true, 6, 1, 0, SEMTECH_LORAMAC_TX_DONE);
+    CHECK(uplink_len == APP_CLOCK_APP_TIME_REQ_SIZE, "AppTimeReq into a 6 bytes trailer (len=%d)", uplink_len);
+    const uint8_t ans[1 + APP_CLOCK_APP_TIME_ANS_LEN] = { APP_CLOCK_CID_AppTimeAns, 0, 0, 0, 0, uplink[5] & 0x0F };
+    CHECK(downlink(ans, sizeof(ans)) == APP_CLOCK_OK, "AppTimeAns");
+}
+
+static void test_app_time_set(void)
+{
+    // 2022-06-01 00:00:00
+    uint32_t t = 1338076800UL;
+    uint8_t set[1 + X_APP_CLOCK_APP_TIME_SET_REQ_LEN] = { X_APP_CLOCK_CID_AppTimeSetReq };
+    put_u32le(set + 1, t);
+    CHECK(downlink(set, sizeof(set)) == APP_CLOCK_OK, "AppTimeSetReq");
+    CHECK(timebase_now_sec() == t && rtc_gps_sec() == t, "time set: %u (RTC %u) expected %u", timebase_now_sec(),
+          rtc_gps_sec(), t);
+}
+
+static void measure_parse(void)
+{
+    // all the commands of the package
+    const uint8_t payload[] = {
+        APP_CLOCK_CID_PackageVersionReq,
+        APP_CLOCK_CID_AppTimeAns, 0x10, 0x00, 0x00, 0x00, 0x01,
+        APP_CLOCK_CID_DeviceAppTimePeriodicityReq, 0x03,
+        APP_CLOCK_CID_ForceDeviceResyncReq, 0x02,
+        X_APP_CLOCK_CID_AppTimeSetReq, 0x00, 0x00, 0x00, 0x50,
+    };
+    const unsigned loops = 10000000;
+    app_clock_cmds_t cmds;
+    unsigned flags = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned i = 0; i < loops; i++) {
+        app_clock_parse(payload, sizeof(payload) - (i & 1), &cmds);
+        flags += cmds.flags;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / loops;
+    printf("app_clock_parse: %.1f ns per payload of %u bytes (host) [%u]\n", ns, (unsigned)sizeof(payload),
+           flags & 1);
+}
+
+int main(void)
+{
+    timebase_init();
+
+    test_package_version();
+    test_app_time();
+    test_periodicity();
+    test_force_resync();
+    test_truncated();
+    test_trailer_size();
+    test_app_time_set();
+    measure_parse();
+
+    printf("app_clock_test: %u checks, %u failures\n", checks, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host CLI decoding the data uplinks (same codec as the firmware).
+ *
+ * Usage: codec_cli [-s SENSORS] PAYLOAD...  (or the payloads on the standard input, one per line)
+ * The payloads are in hexadecimal. SENSORS is the mask of the sensors of the endpoint
+ * (CODEC_SENSOR_*, 0x07 by default).
+ * Output: one JSON object per payload (same keys as codec/decoder.js)
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "payload_codec.h"
+
+// the payload and the clock sync trailer
+#define MAX_PAYLOAD     (255U)
+
+static int8_t hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static int print_payload(const char *arg, uint8_t sensors)
+{
+    uint8_t buf[MAX_PAYLOAD];
+    size_t len = 0;
+    const char *p = arg;
+
+    for (; p[0] != '\0' && p[0] != '\n' && p[0] != '\r'; p += 2) {
+        int8_t hi = hex_value(p[0]);
+        int8_t lo = hex_value(p[1]);
+        if (hi < 0 || lo < 0 || len >= sizeof(buf)) {
+            fprintf(stderr, "bad payload: %s\n", arg);
+            return 1;
+        }
+        buf[len++] = (uint8_t)((hi << 4) | lo);
+    }
+
+    char json[1024];
+    int8_t ret = codec_decode_json(buf, (uint8_t)len, sensors, json, sizeof(json));
+    printf("%s\n", json);
+    return ret == CODEC_OK ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t sensors = CODEC_SENSORS_DEFAULT;
+    int first = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-s") == 0) {
+        sensors = (uint8_t)strtoul(argv[2], NULL, 0);
+        first = 3;
+    }
+
+    int ret = 0;
+    if (argc > first) {
+        for (int i = first; i < argc; i++) {
+            ret |= print_payload(argv[i], sensors);
+        }
+    } else {
+        char line[2 * MAX_PAYLOAD + 4];
+        while (fgets(line, sizeof(line), stdin) != NULL) {
+            ret |= print_payload(line, sensors);
+        }
+    }
+    return ret;
+}
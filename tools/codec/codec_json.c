@@ -0,0 +1,134 @@
+/*
+ * Generated by tools/codec/gen_codec.py from tools/codec/payload.json: do not edit
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "payload_codec.h"
+
+typedef struct {
+    char *out;
+    size_t size;
+    size_t len;
+    const char *sep;
+} json_t;
+
+static void json_printf(json_t *j, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(j->out + j->len, j->len < j->size ? j->size - j->len : 0, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        j->len += n;
+    }
+}
+
+static void json_key(json_t *j, const char *key)
+{
+    json_printf(j, "%s\"%s\":", j->sep, key);
+    j->sep = ",";
+}
+
+// fixed-point value with the decimals of the scale
+static void json_fixed(json_t *j, const char *key, int32_t v, uint8_t decimals, int32_t scale)
+{
+    json_key(j, key);
+    if (decimals == 0) {
+        json_printf(j, "%ld", (long)v);
+        return;
+    }
+    uint32_t a = (uint32_t)(v < 0 ? -v : v);
+    json_printf(j, "%s%lu.%0*lu", v < 0 ? "-" : "", (unsigned long)(a / scale), decimals,
+                (unsigned long)(a % scale));
+}
+
+// position of the binary format (2^23 for max_degrees)
+static void json_angle(json_t *j, const char *key, int32_t v, int32_t max_degrees)
+{
+    json_key(j, key);
+    json_printf(j, "%.7f", (double)v * max_degrees / (v < 0 ? 8388608.0 : 8388607.0));
+}
+
+int8_t codec_decode_json(const uint8_t *buf, uint8_t len, uint8_t sensors, char *out, size_t size)
+{
+    json_t j = { out, size, 0, "" };
+    codec_data_t data;
+    int8_t ret = codec_decode(buf, len, sensors, &data);
+
+    if (size > 0) {
+        out[0] = '\0';
+    }
+    json_printf(&j, "{");
+    if (ret != CODEC_OK) {
+        json_printf(&j, "\"_errors\":[\"%s\"]}",
+                    ret == CODEC_ERROR_TRAILER ? "bad clock sync trailer" : "bad length for the sensors");
+        return ret;
+    }
+    uint8_t flags = data.flags;
+    if (flags & CODEC_FLAG_BMX280_ERROR) {
+        json_key(&j, "bmx280_error");
+        json_printf(&j, "true");
+    }
+    if (flags & CODEC_FLAG_PMS7003_ERROR) {
+        json_key(&j, "pms7003_error");
+        json_printf(&j, "true");
+    }
+    if (flags & CODEC_FLAG_GPS_ERROR) {
+        json_key(&j, "gps_error");
+        json_printf(&j, "true");
+    }
+    if (flags & CODEC_FLAG_DS75LX_ERROR) {
+        json_key(&j, "ds75lx_error");
+        json_printf(&j, "true");
+    }
+    if (flags & CODEC_FLAG_AT30TSE75X_ERROR) {
+        json_key(&j, "at30tse75x_error");
+        json_printf(&j, "true");
+    }
+    if (data.trailer_len > 0) {
+        json_key(&j, "clock_sync_payload");
+        json_printf(&j, "\"");
+        for (uint8_t k = 0; k < data.trailer_len; k++) {
+            json_printf(&j, "%02x", buf[data.trailer_offset + k]);
+        }
+        json_printf(&j, "\"");
+    }
+    if ((sensors & CODEC_SENSOR_BMX280) && !(flags & CODEC_FLAG_BMX280_ERROR)) {
+        json_fixed(&j, "temperature", data.temperature, 2, 100);
+        json_fixed(&j, "pressure", data.pressure, 1, 10);
+        if (sensors & CODEC_SENSOR_HUMIDITY) {
+            json_fixed(&j, "humidity", data.humidity, 2, 100);
+        }
+    }
+    if ((sensors & CODEC_SENSOR_PMS7003) && !(flags & CODEC_FLAG_PMS7003_ERROR)) {
+        json_fixed(&j, "pm1_0Standard", data.pm1_0Standard, 0, 1);
+        json_fixed(&j, "pm2_5Standard", data.pm2_5Standard, 0, 1);
+        json_fixed(&j, "pm10Standard", data.pm10Standard, 0, 1);
+        json_fixed(&j, "pm1_0Atmospheric", data.pm1_0Atmospheric, 0, 1);
+        json_fixed(&j, "pm2_5Atmospheric", data.pm2_5Atmospheric, 0, 1);
+        json_fixed(&j, "pm10Atmospheric", data.pm10Atmospheric, 0, 1);
+        json_fixed(&j, "particuleGT0_3", data.particuleGT0_3, 0, 1);
+        json_fixed(&j, "particuleGT0_5", data.particuleGT0_5, 0, 1);
+        json_fixed(&j, "particuleGT1_0", data.particuleGT1_0, 0, 1);
+        json_fixed(&j, "particuleGT2_5", data.particuleGT2_5, 0, 1);
+        json_fixed(&j, "particuleGT10", data.particuleGT10, 0, 1);
+    }
+    if ((sensors & CODEC_SENSOR_DS75LX) && !(flags & CODEC_FLAG_DS75LX_ERROR)) {
+        json_fixed(&j, "ds75lx_temperature", data.ds75lx_temperature, 2, 100);
+    }
+    if ((sensors & CODEC_SENSOR_AT30TSE75X) && !(flags & CODEC_FLAG_AT30TSE75X_ERROR)) {
+        json_fixed(&j, "at30tse75x_temperature", data.at30tse75x_temperature, 2, 100);
+    }
+    if (flags & CODEC_FLAG_POSITION) {
+        json_angle(&j, "latitude", data.latitude, 90);
+        json_angle(&j, "longitude", data.longitude, 180);
+        json_fixed(&j, "altitude", data.altitude, 0, 1);
+    }
+    if (data.padding_len > 0) {
+        json_fixed(&j, "padding_len", data.padding_len, 0, 1);
+    }
+    json_printf(&j, "}");
+    return CODEC_OK;
+}
@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host test of the codec of the data uplinks (payload_codec.c, codec_json.c).
+ *
+ * For the 64 masks of the sensors and the 256 values of the flags, random contents are encoded
+ * (with a clock sync trailer when the flag 0x80 is set) and decoded again. The truncated frames,
+ * the frames with an extra byte, the zero padding of the survey frames (DRPWSZ_SEQUENCE) and the
+ * bad trailers are checked against CODEC_ERROR_LENGTH and CODEC_ERROR_TRAILER. The payloads are
+ * decoded from a buffer of their exact size (the sanitizers catch the reads beyond the payload).
+ *
+ * With -j, the vectors <sensors>\t<payload>\t<JSON of codec_decode_json> are written into a file
+ * for the comparison with codec/decoder.js (tools/codec/decoder_test.js under node).
+ *
+ * Usage: codec_test [-n ROUNDS] [-r SEED] [-j VECTORS_FILE] (exit code 1 on failure)
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "payload_codec.h"
+#include "random.h"
+
+// the payload, a trailer of 3 commands and the padding
+#define MAX_FRAME           (CODEC_MAX_SIZE + 32U)
+#define NB_SENSORS_MASKS    (64U)
+#define NB_FLAGS            (256U)
+
+static unsigned long failures = 0;
+static unsigned long checks = 0;
+static FILE *vectors = NULL;
+
+#define CHECK(cond, sensors, frame, len, ...) \
+    do { \
+        checks++; \
+        if (!(cond)) { \
+            if (failures++ < 20) { \
+                printf("FAIL sensors=0x%02x frame=", sensors); \
+                print_hex(stdout, frame, len); \
+                printf(": " __VA_ARGS__); \
+                printf("\n"); \
+            } \
+        } \
+    } while (0)
+
+static void print_hex(FILE *f, const uint8_t *buf, uint8_t len)
+{
+    for (uint8_t i = 0; i < len; i++) {
+        fprintf(f, "%02x", buf[i]);
+    }
+}
+
+static uint16_t random_u16(void)
+{
+    return (uint16_t)random_uint32();
+}
+
+// decode from a buffer of the exact size of the payload
+static int8_t decode(const uint8_t *frame, uint8_t len, uint8_t sensors, codec_data_t *data)
+{
+    uint8_t *buf = malloc(len ? len : 1);
+    memcpy(buf, frame, len);
+    int8_t ret = codec_decode(buf, len, sensors, data);
+    free(buf);
+    return ret;
+}
+
+static void write_vector(const uint8_t *frame, uint8_t len, uint8_t sensors)
+{
+    if (vectors == NULL) {
+        return;
+    }
+    uint8_t *buf = malloc(len ? len : 1);
+    memcpy(buf, frame, len);
+    char json[1024];
+    codec_decode_json(buf, len, sensors, json, sizeof(json));
+    free(buf);
+    fprintf(vectors, "0x%02x\t", sensors);
+    print_hex(vectors, frame, len);
+    fprintf(vectors, "\t%s\n", json);
+}
+
+/*
+ * Content of the frame: random values, and the expected result of the decoder (the fields of
+ * the blocks which are absent are zero)
+ */
+static void random_data(uint8_t sensors, uint8_t flags, codec_data_t *data, codec_data_t *expected,
+                        uint8_t *size)
+{
+    memset(data, 0, sizeof(*data));
+    memset(expected, 0, sizeof(*expected));
+    data->flags = expected->flags = flags;
+    *size = 1;
+
+    data->temperature = (int16_t)random_u16();
+    data->pressure = random_u16();
+    data->humidity = random_u16();
+    if ((sensors & CODEC_SENSOR_BMX280) && !(flags & CODEC_FLAG_BMX280_ERROR)) {
+        expected->temperature = data->temperature;
+        expected->pressure = data->pressure;
+        *size += 4;
+        if (sensors & CODEC_SENSOR_HUMIDITY) {
+            expected->humidity = data->humidity;
+            *size += 2;
+        }
+    }
+
+    data->pm1_0Standard = random_u16();
+    data->pm2_5Standard = random_u16();
+    data->pm10Standard = random_u16();
+    data->pm1_0Atmospheric = random_u16();
+    data->pm2_5Atmospheric = random_u16();
+    data->pm10Atmospheric = random_u16();
+    data->particuleGT0_3 = random_u16();
+    data->particuleGT0_5 = random_u16();
+    data->particuleGT1_0 = random_u16();
+    data->particuleGT2_5 = random_u16();
+    data->particuleGT10 = random_u16();
+    if ((sensors & CODEC_SENSOR_PMS7003) && !(flags & CODEC_FLAG_PMS7003_ERROR)) {
+        expected->pm1_0Standard = data->pm1_0Standard;
+        expected->pm2_5Standard = data->pm2_5Standard;
+        expected->pm10Standard = data->pm10Standard;
+        expected->pm1_0Atmospheric = data->pm1_0Atmospheric;
+        expected->pm2_5Atmospheric = data->pm2_5Atmospheric;
+        expected->pm10Atmospheric = data->pm10Atmospheric;
+        expected->particuleGT0_3 = data->particuleGT0_3;
+        expected->particuleGT0_5 = data->particuleGT0_5;
+        expected->particuleGT1_0 = data->particuleGT1_0;
+        expected->particuleGT2_5 = data->particuleGT2_5;
+        expected->particuleGT10 = data->particuleGT10;
+        *size += 22;
+    }
+
+    data->ds75lx_temperature = (int16_t)random_u16();
+    if ((sensors & CODEC_SENSOR_DS75LX) && !(flags & CODEC_FLAG_DS75LX_ERROR)) {
+        expected->ds75lx_temperature = data->ds75lx_temperature;
+        *size += 2;
+    }
+
+    data->at30tse75x_temperature = (int16_t)random_u16();
+    if ((sensors & CODEC_SENSOR_AT30TSE75X) && !(flags & CODEC_FLAG_AT30TSE75X_ERROR)) {
+        expected->at30tse75x_temperature = data->at30tse75x_temperature;
+        *size += 2;
+    }
+
+    // 24-bit positions
+    data->latitude = (int32_t)random_uint32_range(0, 1UL << 24) - (1L << 23);
+    data->longitude = (int32_t)random_uint32_range(0, 1UL << 24) - (1L << 23);
+    data->altitude = (int16_t)random_u16();
+    if (flags & CODEC_FLAG_POSITION) {
+        expected->latitude = data->latitude;
+        expected->longitude = data->longitude;
+        expected->altitude = data->altitude;
+        *size += 8;
+    }
+}
+
+/*
+ * Clock sync trailer <commands><length of the commands> of the firmware: 1 to 3 commands
+ * (PackageVersionAns, AppTimeReq, DeviceAppTimePeriodicityAns)
+ */
+static uint8_t random_trailer(uint8_t *buf)
+{
+    static const uint8_t lens[] = { 3, 6, 6 };
+    uint8_t n = 0;
+    unsigned nb = 1 + random_uint32_range(0, 3);
+    for (unsigned c = 0; c < nb; c++) {
+        uint8_t cid = (uint8_t)random_uint32_range(0, 3);
+        buf[n] = cid;
+        for (uint8_t k = 1; k < lens[cid]; k++) {
+            buf[n + k] = (uint8_t)random_uint32();
+        }
+        n += lens[cid];
+    }
+    buf[n] = n;
+    return n + 1;
+}
+
+static void test_frame(uint8_t sensors, uint8_t flags, bool vector)
+{
+    codec_data_t data, expected, decoded;
+    uint8_t size;
+    uint8_t frame[MAX_FRAME];
+    uint8_t bad[MAX_FRAME];
+
+    random_data(sensors, flags, &data, &expected, &size);
+    memset(frame, 0xA5, sizeof(frame));
+    uint8_t len = codec_encode(&data, sensors, frame);
+    CHECK(len == size && frame[len] == 0xA5, sensors, frame, len, "encoded size %d expected %d", len, size);
+    CHECK(frame[0] == (flags & ~CODEC_FLAG_CLOCK_TRAILER), sensors, frame, len, "flags");
+
+    bool trailer = flags & CODEC_FLAG_CLOCK_TRAILER;
+    if (trailer) {
+        // appended by the sender
+        frame[0] |= CODEC_FLAG_CLOCK_TRAILER;
+        uint8_t n = random_trailer(frame + len);
+        expected.trailer_offset = len;
+        expected.trailer_len = n - 1;
+        len += n;
+    }
+
+    int8_t ret = decode(frame, len, sensors, &decoded);
+    CHECK(ret == CODEC_OK && memcmp(&decoded, &expected, sizeof(decoded)) == 0, sensors, frame, len,
+          "round trip (ret=%d)", ret);
+    if (vector) {
+        write_vector(frame, len, sensors);
+    }
+
+    if (!trailer) {
+        // truncated
+        for (uint8_t l = 0; l < len; l++) {
+            ret = decode(frame, l, sensors, &decoded);
+            CHECK(ret == CODEC_ERROR_LENGTH, sensors, frame, l, "truncated (ret=%d)", ret);
+        }
+        // extra byte
+        memcpy(bad, frame, len);
+        bad[len] = (uint8_t)random_uint32_range(1, 256);
+        ret = decode(bad, len + 1, sensors, &decoded);
+        CHECK(ret == CODEC_ERROR_LENGTH, sensors, bad, len + 1, "extra byte (ret=%d)", ret);
+        if (vector) {
+            write_vector(frame, len - 1, sensors);
+            write_vector(bad, len + 1, sensors);
+        }
+        // zero padding of a survey frame
+        uint8_t padding = (uint8_t)random_uint32_range(1, MAX_FRAME - len + 1);
+        memset(bad + len, 0, padding);
+        expected.padding_len = padding;
+        ret = decode(bad, len + padding, sensors, &decoded);
+        CHECK(ret == CODEC_OK && memcmp(&decoded, &expected, sizeof(decoded)) == 0, sensors, bad, len + padding,
+              "zero padding (ret=%d)", ret);
+        if (vector) {
+            write_vector(bad, len + padding, sensors);
+        }
+        return;
+    }
+
+    uint8_t n = frame[len - 1];
+    uint8_t end = len - 1 - n;
+    if (end > 1) {
+        // a byte removed before the trailer
+        memcpy(bad, frame, end - 1);
+        memcpy(bad + end - 1, frame + end, len - end);
+        ret = decode(bad, len - 1, sensors, &decoded);
+        CHECK(ret == CODEC_ERROR_LENGTH, sensors, bad, len - 1, "byte removed before the trailer (ret=%d)", ret);
+    }
+    // a zero byte inserted before the trailer: no padding with a trailer
+    memcpy(bad, frame, end);
+    bad[end] = 0;
+    memcpy(bad + end + 1, frame + end, len - end);
+    ret = decode(bad, len + 1, sensors, &decoded);
+    CHECK(ret == CODEC_ERROR_LENGTH, sensors, bad, len + 1, "byte inserted before the trailer (ret=%d)", ret);
+    if (vector) {
+        write_vector(bad, len + 1, sensors);
+    }
+    // length of the trailer beyond the flags
+    memcpy(bad, frame, len);
+    bad[len - 1] = len - 1;
+    ret = decode(bad, len, sensors, &decoded);
+    CHECK(ret == CODEC_ERROR_TRAILER, sensors, bad, len, "bad trailer length (ret=%d)", ret);
+    // the trailer flag alone
+    ret = decode(bad, 1, sensors, &decoded);
+    CHECK(ret == CODEC_ERROR_TRAILER, sensors, bad, 1, "trailer flag alone (ret=%d)", ret);
+    if (vector) {
+        write_vector(bad, len, sensors);
+        write_vector(bad, 1, sensors);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long rounds = 20;
+    uint32_t seed = 1;
+    const char *vectors_file = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:j:")) != -1) {
+        switch (opt) {
+        case 'n': rounds = strtoul(optarg, NULL, 0); break;
+        case 'r': seed = strtoul(optarg, NULL, 0); break;
+        case 'j': vectors_file = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-n ROUNDS] [-r SEED] [-j VECTORS_FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (vectors_file != NULL && (vectors = fopen(vectors_file, "w")) == NULL) {
+        perror(vectors_file);
+        return 1;
+    }
+    random_init(seed);
+
+    for (unsigned long r = 0; r < rounds; r++) {
+        for (unsigned sensors = 0; sensors < NB_SENSORS_MASKS; sensors++) {
+            for (unsigned flags = 0; flags < NB_FLAGS; flags++) {
+                // the vectors of the first round only
+                test_frame((uint8_t)sensors, (uint8_t)flags, r == 0);
+            }
+        }
+    }
+
+    if (vectors != NULL) {
+        fclose(vectors);
+    }
+    printf("codec_test: %lu checks, %lu failures\n", checks, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Comparison of codec/decoder.js with the C decoder (codec_decode_json) on the vectors
+ * written by tools/codec/codec_test -j: <sensors>\t<payload>\t<JSON of the C decoder>
+ *
+ * The errors are compared by their presence only (the messages of the decoders differ).
+ * The commands of the clock sync trailer are only decoded by decoder.js.
+ *
+ * Usage: node decoder_test.js codec/decoder.js VECTORS_FILE (exit code 1 on failure)
+ *  Author: Didier DONSEZ (Université Grenoble Alpes)
+ */
+
+var fs = require("fs");
+var vm = require("vm");
+
+var CLOCK_SYNC_KEYS = ["package_identifier", "package_version", "device_time", "token_req", "ans_required",
+                       "periodicity_not_supported"];
+// the C decoder prints the angles with 7 decimals
+var ANGLE_KEYS = ["latitude", "longitude"];
+
+vm.runInThisContext(fs.readFileSync(process.argv[2], "utf-8"), { filename: process.argv[2] });
+
+function fromHex(s) {
+    var bytes = [];
+    for (var i = 0; i < s.length; i += 2) {
+        bytes.push(parseInt(s.substr(i, 2), 16));
+    }
+    return bytes;
+}
+
+function compare(c, js) {
+    if (c._errors !== undefined || js._errors !== undefined) {
+        return (c._errors !== undefined && js._errors !== undefined) ? null : "error of one decoder only";
+    }
+    var keys = Object.keys(c);
+    for (var k = 0; k < keys.length; k++) {
+        var key = keys[k];
+        if (!(key in js)) {
+            return "missing " + key;
+        }
+        var tolerance = ANGLE_KEYS.indexOf(key) >= 0 ? 1e-7 : 0;
+        var equal = (typeof c[key] === "number") ? Math.abs(c[key] - js[key]) <= tolerance : c[key] === js[key];
+        if (!equal) {
+            return key + ": " + c[key] + " != " + js[key];
+        }
+    }
+    keys = Object.keys(js);
+    for (k = 0; k < keys.length; k++) {
+        if (!(keys[k] in c) && CLOCK_SYNC_KEYS.indexOf(keys[k]) < 0) {
+            return "unexpected " + keys[k];
+        }
+    }
+    return null;
+}
+
+var lines = fs.readFileSync(process.argv[3], "utf-8").split("\n");
+var failures = 0;
+var nb = 0;
+for (var l = 0; l < lines.length; l++) {
+    if (lines[l] === "") {
+        continue;
+    }
+    var v = lines[l].split("\t");
+    var c = JSON.parse(v[2]);
+    var js = DecodeData(fromHex(v[1]), { sensors: v[0] }, {});
+    var diff = compare(c, js);
+    nb++;
+    if (diff !== null) {
+        if (failures++ < 20) {
+            console.log("FAIL sensors=" + v[0] + " payload=" + v[1] + ": " + diff);
+            console.log("  C:  " + v[2]);
+            console.log("  JS: " + JSON.stringify(js));
+        }
+    }
+}
+console.log("decoder_test: " + nb + " payloads, " + failures + " failures");
+process.exit(failures === 0 ? 0 : 1);
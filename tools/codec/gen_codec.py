@@ -0,0 +1,546 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2022 Université Grenoble Alpes
+#
+# This file is subject to the terms and conditions of the GNU Lesser
+# General Public License v2.1. See the file LICENSE in the top level
+# directory for more details.
+#
+# Generate the codec of the data uplinks from the payload schema:
+# - the C codec (encoder and decoder) linked by the firmware and the backend tools
+# - the JSON printer of the C decoder (host only)
+# - the DecodeData function of the Javascript decoder (between the BEGIN/END markers)
+# - the uplink section of the README (between the BEGIN/END markers)
+#
+# Usage: gen_codec.py payload.json payload_codec.h payload_codec.c codec_json.c decoder.js README.md
+
+import json
+import sys
+
+GENERATED = "Generated by tools/codec/gen_codec.py from tools/codec/payload.json: do not edit"
+
+# type: (size, C type, signed, big endian)
+TYPES = {
+    "u16le": (2, "uint16_t", False, False),
+    "s16le": (2, "int16_t", True, False),
+    "s16be": (2, "int16_t", True, True),
+    "s24be": (3, "int32_t", True, True),
+}
+
+JS_READERS = {
+    "u16le": "readUInt16LE",
+    "s16le": "readInt16LE",
+    "s16be": "readInt16BE",
+    "s24be": "readInt24BE",
+}
+
+
+class Schema:
+    def __init__(self, path):
+        with open(path, encoding="utf-8") as f:
+            s = json.load(f)
+        self.port = s["port"]
+        self.flags = {fl["name"]: fl for fl in s["flags"]}
+        self.flag_list = s["flags"]
+        self.sensors = {se["name"]: se for se in s["sensors"]}
+        self.sensor_list = s["sensors"]
+        self.default_sensors = sum(self.sensors[n]["mask"] for n in s["default_sensors"])
+        self.blocks = s["blocks"]
+        for b in self.blocks:
+            if ("error_flag" in b) == ("presence_flag" in b):
+                sys.exit("block %s: one of error_flag or presence_flag is required" % b["name"])
+            for fd in b["fields"]:
+                if fd["type"] not in TYPES:
+                    sys.exit("field %s: unknown type %s" % (fd["name"], fd["type"]))
+        self.max_size = 1 + sum(TYPES[fd["type"]][0] for b in self.blocks for fd in b["fields"])
+
+
+def flag_macro(name):
+    return "CODEC_FLAG_" + name
+
+
+def sensor_macro(name):
+    return "CODEC_SENSOR_" + name
+
+
+def c_presence(b):
+    """C condition of the presence of a block (flags and sensors are the variables)"""
+    if "presence_flag" in b:
+        return "flags & %s" % flag_macro(b["presence_flag"])
+    return "(sensors & %s) && !(flags & %s)" % (sensor_macro(b["sensor"]), flag_macro(b["error_flag"]))
+
+
+def js_presence(schema, b):
+    if "presence_flag" in b:
+        return "(flags & 0x%02X) !== 0" % schema.flags[b["presence_flag"]]["mask"]
+    return "(sensors & 0x%02X) !== 0 && (flags & 0x%02X) === 0" % (
+        schema.sensors[b["sensor"]]["mask"], schema.flags[b["error_flag"]]["mask"])
+
+
+def c_block_size(b):
+    fixed = sum(TYPES[fd["type"]][0] for fd in b["fields"] if "sensor" not in fd)
+    terms = [str(fixed)]
+    for fd in b["fields"]:
+        if "sensor" in fd:
+            terms.append("((sensors & %s) ? %d : 0)" % (sensor_macro(fd["sensor"]), TYPES[fd["type"]][0]))
+    return " + ".join(terms)
+
+
+def js_block_size(schema, b):
+    fixed = sum(TYPES[fd["type"]][0] for fd in b["fields"] if "sensor" not in fd)
+    terms = [str(fixed)]
+    for fd in b["fields"]:
+        if "sensor" in fd:
+            terms.append("((sensors & 0x%02X) !== 0 ? %d : 0)" % (schema.sensors[fd["sensor"]]["mask"],
+                                                               TYPES[fd["type"]][0]))
+    return " + ".join(terms)
+
+
+def decimals(scale):
+    d = 0
+    while scale > 1:
+        if scale % 10 != 0:
+            sys.exit("scale %d is not a power of 10" % scale)
+        scale //= 10
+        d += 1
+    return d
+
+
+def gen_header(schema, f):
+    f.write("/*\n * %s\n */\n\n" % GENERATED)
+    f.write("/**\n * @{\n *\n * @file\n * @brief       Codec of the data uplinks (encoder and decoder), "
+            "shared by the firmware and the backend.\n *\n")
+    f.write(" * The blocks of the payload depend on the flags (byte 0) and on the sensors of the endpoint.\n")
+    f.write(" * This file has no dependency on RIOT.\n *\n * @}\n */\n\n")
+    f.write("#ifndef PAYLOAD_CODEC_H\n#define PAYLOAD_CODEC_H\n\n#include <inttypes.h>\n#include <stddef.h>\n\n")
+    f.write('#ifdef __cplusplus\nextern "C"\n{\n#endif\n\n')
+    f.write("#define CODEC_PORT                      (%d)\n\n" % schema.port)
+    f.write("/*\n * Flags (byte 0)\n */\n")
+    for fl in schema.flag_list:
+        f.write("#define %-31s (0x%02X)   /**< %s */\n" % (flag_macro(fl["name"]), fl["mask"], fl["doc"]))
+    f.write("\n/*\n * Sensors of the endpoint\n */\n")
+    for se in schema.sensor_list:
+        f.write("#define %-31s (0x%02X)   /**< %s */\n" % (sensor_macro(se["name"]), se["mask"], se["doc"]))
+    f.write("#define %-31s (0x%02X)\n\n" % ("CODEC_SENSORS_DEFAULT", schema.default_sensors))
+    f.write("/*\n * Max size of the payload (without the clock sync trailer)\n */\n")
+    f.write("#define CODEC_MAX_SIZE                  (%dU)\n\n" % schema.max_size)
+    f.write("#define CODEC_OK                        (int8_t)0\n")
+    f.write("#define CODEC_ERROR_LENGTH              (int8_t)-1\n")
+    f.write("#define CODEC_ERROR_TRAILER             (int8_t)-2\n\n")
+    f.write("/**\n * Content of a data uplink (raw values)\n */\ntypedef struct {\n")
+    f.write("    uint8_t flags;                          /**< flags */\n")
+    for b in schema.blocks:
+        for fd in b["fields"]:
+            unit = fd["unit"]
+            if "scale" in fd:
+                unit = "%s * %d" % (unit, fd["scale"])
+            elif "angle" in fd:
+                unit = "2^23 for %d degrees" % fd["angle"]
+            decl = "%s %s;" % (TYPES[fd["type"]][1], fd["name"])
+            f.write("    %-39s /**< %s (%s) */\n" % (decl, b["name"], unit))
+    f.write("    uint8_t trailer_offset;                 /**< offset of the clock sync trailer (decoder) */\n")
+    f.write("    uint8_t trailer_len;                    /**< length of the clock sync trailer (decoder) */\n")
+    f.write("    uint8_t padding_len;                    /**< length of the zero padding (decoder) */\n")
+    f.write("} codec_data_t;\n\n")
+    f.write("""/**
+ * Encode a data uplink (without the clock sync trailer)
+ *
+ * @param data      the content (the flags select the blocks)
+ * @param sensors   the sensors of the endpoint (CODEC_SENSOR_*)
+ * @param buf       the buffer (CODEC_MAX_SIZE bytes)
+ *
+ * @return the size of the payload
+ */
+uint8_t codec_encode(const codec_data_t *data, uint8_t sensors, uint8_t *buf);
+
+/**
+ * Decode a data uplink
+ *
+ * @param buf       the payload
+ * @param len       the size of the payload
+ * @param sensors   the sensors of the endpoint (CODEC_SENSOR_*)
+ * @param data      the content
+ *
+ * Without a clock sync trailer, the payload can be padded with zeros (the frames of a survey
+ * DRPWSZ_SEQUENCE have the size of the sequence): the padding is skipped.
+ *
+ * @return CODEC_OK, CODEC_ERROR_LENGTH (the size does not match the flags and the sensors) or
+ *         CODEC_ERROR_TRAILER
+ */
+int8_t codec_decode(const uint8_t *buf, uint8_t len, uint8_t sensors, codec_data_t *data);
+
+/**
+ * Decode a data uplink into a JSON object (same keys as codec/decoder.js, tools/codec/codec_json.c)
+ *
+ * @param buf       the payload
+ * @param len       the size of the payload
+ * @param sensors   the sensors of the endpoint (CODEC_SENSOR_*)
+ * @param out       the JSON object (with "_errors" if the payload is not valid)
+ * @param size      the size of out
+ *
+ * @return the error of codec_decode
+ */
+int8_t codec_decode_json(const uint8_t *buf, uint8_t len, uint8_t sensors, char *out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+""")
+
+
+def gen_codec(schema, f):
+    f.write("/*\n * %s\n */\n\n" % GENERATED)
+    f.write('#include <string.h>\n\n#include "payload_codec.h"\n\n')
+    f.write("""static void put_u16le(uint8_t *buf, uint16_t v)
+{
+    buf[0] = v & 0xFF;
+    buf[1] = v >> 8;
+}
+
+static void put_u16be(uint8_t *buf, uint16_t v)
+{
+    buf[0] = v >> 8;
+    buf[1] = v & 0xFF;
+}
+
+static void put_u24be(uint8_t *buf, uint32_t v)
+{
+    buf[0] = (v >> 16) & 0xFF;
+    buf[1] = (v >> 8) & 0xFF;
+    buf[2] = v & 0xFF;
+}
+
+static uint16_t get_u16le(const uint8_t *buf)
+{
+    return buf[0] | (buf[1] << 8);
+}
+
+static uint16_t get_u16be(const uint8_t *buf)
+{
+    return (buf[0] << 8) | buf[1];
+}
+
+static int32_t get_s24be(const uint8_t *buf)
+{
+    uint32_t v = ((uint32_t)buf[0] << 16) | ((uint32_t)buf[1] << 8) | buf[2];
+    // sign extension
+    return (v & 0x800000UL) ? (int32_t)(v | 0xFF000000UL) : (int32_t)v;
+}
+
+""")
+    puts = {"u16le": "put_u16le(buf + i, data->%s)",
+            "s16le": "put_u16le(buf + i, (uint16_t)data->%s)",
+            "s16be": "put_u16be(buf + i, (uint16_t)data->%s)",
+            "s24be": "put_u24be(buf + i, (uint32_t)data->%s)"}
+    gets = {"u16le": "get_u16le(buf + i)",
+            "s16le": "(int16_t)get_u16le(buf + i)",
+            "s16be": "(int16_t)get_u16be(buf + i)",
+            "s24be": "get_s24be(buf + i)"}
+
+    def fields(fd_list, stmt):
+        out = []
+        for fd in fd_list:
+            size = TYPES[fd["type"]][0]
+            indent = "        "
+            lines = [stmt(fd), "i += %d;" % size]
+            if "sensor" in fd:
+                out.append("%sif (sensors & %s) {\n" % (indent, sensor_macro(fd["sensor"])))
+                out.extend("%s    %s\n" % (indent, ln) for ln in lines)
+                out.append("%s}\n" % indent)
+            else:
+                out.extend("%s%s\n" % (indent, ln) for ln in lines)
+        return "".join(out)
+
+    f.write("uint8_t codec_encode(const codec_data_t *data, uint8_t sensors, uint8_t *buf)\n{\n")
+    f.write("    // the trailer is appended by the caller\n")
+    f.write("    uint8_t flags = data->flags & ~%s;\n" % flag_macro("CLOCK_TRAILER"))
+    f.write("    uint8_t i = 0;\n\n    buf[i++] = flags;\n")
+    for b in schema.blocks:
+        f.write("\n    if (%s) {\n" % c_presence(b))
+        f.write(fields(b["fields"], lambda fd: puts[fd["type"]] % fd["name"] + ";"))
+        f.write("    }\n")
+    f.write("    return i;\n}\n\n")
+
+    f.write("int8_t codec_decode(const uint8_t *buf, uint8_t len, uint8_t sensors, codec_data_t *data)\n{\n")
+    f.write("    memset(data, 0, sizeof(*data));\n    if (len < 1) {\n        return CODEC_ERROR_LENGTH;\n    }\n")
+    f.write("    uint8_t flags = data->flags = buf[0];\n    uint8_t end = len;\n    uint8_t i = 1;\n\n")
+    f.write("    if (flags & %s) {\n" % flag_macro("CLOCK_TRAILER"))
+    f.write("""        // <commands><length of the commands>
+        uint8_t n = buf[len - 1];
+        if (n + 2 > len) {
+            return CODEC_ERROR_TRAILER;
+        }
+        end = len - 1 - n;
+        data->trailer_offset = end;
+        data->trailer_len = n;
+    }
+""")
+    for b in schema.blocks:
+        f.write("\n    if (%s) {\n" % c_presence(b))
+        f.write("        if (end - i < %s) {\n            return CODEC_ERROR_LENGTH;\n        }\n" % c_block_size(b))
+        f.write(fields(b["fields"], lambda fd: "data->%s = %s;" % (fd["name"], gets[fd["type"]])))
+        f.write("    }\n")
+    f.write("""
+    if (i < end && !(flags & %s)) {
+        // zero padding of the frames of a survey (DRPWSZ_SEQUENCE)
+        for (uint8_t k = i; k < end; k++) {
+            if (buf[k] != 0) {
+                return CODEC_ERROR_LENGTH;
+            }
+        }
+        data->padding_len = end - i;
+        return CODEC_OK;
+    }
+""" % flag_macro("CLOCK_TRAILER"))
+    f.write("    return (i == end) ? CODEC_OK : CODEC_ERROR_LENGTH;\n}\n")
+
+
+def gen_json(schema, f):
+    f.write("/*\n * %s\n */\n\n" % GENERATED)
+    f.write('#include <stdarg.h>\n#include <stdio.h>\n\n#include "payload_codec.h"\n\n')
+    f.write("""typedef struct {
+    char *out;
+    size_t size;
+    size_t len;
+    const char *sep;
+} json_t;
+
+static void json_printf(json_t *j, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(j->out + j->len, j->len < j->size ? j->size - j->len : 0, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        j->len += n;
+    }
+}
+
+static void json_key(json_t *j, const char *key)
+{
+    json_printf(j, "%s\\"%s\\":", j->sep, key);
+    j->sep = ",";
+}
+
+// fixed-point value with the decimals of the scale
+static void json_fixed(json_t *j, const char *key, int32_t v, uint8_t decimals, int32_t scale)
+{
+    json_key(j, key);
+    if (decimals == 0) {
+        json_printf(j, "%ld", (long)v);
+        return;
+    }
+    uint32_t a = (uint32_t)(v < 0 ? -v : v);
+    json_printf(j, "%s%lu.%0*lu", v < 0 ? "-" : "", (unsigned long)(a / scale), decimals,
+                (unsigned long)(a % scale));
+}
+
+// position of the binary format (2^23 for max_degrees)
+static void json_angle(json_t *j, const char *key, int32_t v, int32_t max_degrees)
+{
+    json_key(j, key);
+    json_printf(j, "%.7f", (double)v * max_degrees / (v < 0 ? 8388608.0 : 8388607.0));
+}
+
+""")
+    f.write("int8_t codec_decode_json(const uint8_t *buf, uint8_t len, uint8_t sensors, char *out, size_t size)\n{\n")
+    f.write("""    json_t j = { out, size, 0, "" };
+    codec_data_t data;
+    int8_t ret = codec_decode(buf, len, sensors, &data);
+
+    if (size > 0) {
+        out[0] = '\\0';
+    }
+    json_printf(&j, "{");
+    if (ret != CODEC_OK) {
+        json_printf(&j, "\\"_errors\\":[\\"%s\\"]}",
+                    ret == CODEC_ERROR_TRAILER ? "bad clock sync trailer" : "bad length for the sensors");
+        return ret;
+    }
+    uint8_t flags = data.flags;
+""")
+    for fl in schema.flag_list:
+        if fl["name"].endswith("_ERROR"):
+            f.write("    if (flags & %s) {\n        json_key(&j, \"%s\");\n        json_printf(&j, \"true\");\n    }\n"
+                    % (flag_macro(fl["name"]), fl["name"].lower()))
+    f.write("""    if (data.trailer_len > 0) {
+        json_key(&j, "clock_sync_payload");
+        json_printf(&j, "\\"");
+        for (uint8_t k = 0; k < data.trailer_len; k++) {
+            json_printf(&j, "%02x", buf[data.trailer_offset + k]);
+        }
+        json_printf(&j, "\\"");
+    }
+""")
+    for b in schema.blocks:
+        f.write("    if (%s) {\n" % c_presence(b))
+        for fd in b["fields"]:
+            indent = "        "
+            if "angle" in fd:
+                stmt = 'json_angle(&j, "%s", data.%s, %d);' % (fd["name"], fd["name"], fd["angle"])
+            else:
+                scale = fd.get("scale", 1)
+                stmt = 'json_fixed(&j, "%s", data.%s, %d, %d);' % (fd["name"], fd["name"], decimals(scale), scale)
+            if "sensor" in fd:
+                f.write("%sif (sensors & %s) {\n%s    %s\n%s}\n" % (indent, sensor_macro(fd["sensor"]), indent, stmt, indent))
+            else:
+                f.write("%s%s\n" % (indent, stmt))
+        f.write("    }\n")
+    f.write("""    if (data.padding_len > 0) {
+        json_fixed(&j, "padding_len", data.padding_len, 0, 1);
+    }
+""")
+    f.write('    json_printf(&j, "}");\n    return CODEC_OK;\n}\n')
+
+
+def gen_js(schema):
+    o = []
+    o.append("// %s\n\n" % GENERATED)
+    o.append("""function readInt16BE (buf, offset) {
+    offset = offset >>> 0;
+    var val = (buf[offset] << 8) | buf[offset + 1];
+    return (val & 0x8000) ? val | 0xFFFF0000 : val;
+}
+
+function readInt24BE (buf, offset) {
+    offset = offset >>> 0;
+    return ((buf[offset] << 24) | (buf[offset + 1] << 16) | (buf[offset + 2] << 8)) >> 8;
+}
+
+""")
+    o.append("var DATA_SENSORS_DEFAULT = 0x%02X;\n\n" % schema.default_sensors)
+    o.append("// Decode the data message (the sensors of the endpoint are given by the device variable 'sensors')\n")
+    o.append("function DecodeData(bytes, variables, o) {\n\n")
+    o.append("""    var sensors = DATA_SENSORS_DEFAULT;
+    if (variables && variables.sensors !== undefined) {
+        sensors = parseInt(variables.sensors);
+    }
+    var size = bytes.length;
+    if (size < 1) {
+        return { _errors: ["data too short"] };
+    }
+
+    var flags = bytes[0];
+    var i = 1;
+
+""")
+    o.append("    if ((flags & 0x%02X) !== 0) {\n" % schema.flags["CLOCK_TRAILER"]["mask"])
+    o.append("""        // clock sync trailer: <commands><length of the commands>
+        var n = bytes[size - 1];
+        if (n + 2 > size) {
+            return { _errors: ["bad clock sync trailer"] };
+        }
+        var trailer = bytes.slice(size - 1 - n, size - 1);
+        o['clock_sync_payload'] = toHex(trailer);
+        Decode202(trailer, variables, o);
+        size -= n + 1;
+    }
+
+""")
+    for fl in schema.flag_list:
+        if fl["name"].endswith("_ERROR"):
+            o.append("    if ((flags & 0x%02X) !== 0) {\n        o['%s'] = true;\n    }\n" % (fl["mask"], fl["name"].lower()))
+    for b in schema.blocks:
+        o.append("\n    if (%s) {\n" % js_presence(schema, b))
+        o.append("        if (size < i + %s) {\n" % js_block_size(schema, b))
+        o.append("            return { _errors: [\"%s too short\"] };\n        }\n" % b["name"])
+        for fd in b["fields"]:
+            size = TYPES[fd["type"]][0]
+            expr = "%s(bytes, i)" % JS_READERS[fd["type"]]
+            if "scale" in fd:
+                expr += " / %d.0" % fd["scale"]
+            elif "angle" in fd:
+                expr = "%s(bytes, i) * %d / (%s(bytes, i) < 0 ? 8388608 : 8388607)" % (
+                    JS_READERS[fd["type"]], fd["angle"], JS_READERS[fd["type"]])
+            lines = ["o['%s'] = %s; // in %s" % (fd["name"], expr, fd["unit"]), "i += %d;" % size]
+            if "sensor" in fd:
+                o.append("        if ((sensors & 0x%02X) !== 0) {\n" % schema.sensors[fd["sensor"]]["mask"])
+                o.extend("            %s\n" % ln for ln in lines)
+                o.append("        }\n")
+            else:
+                o.extend("        %s\n" % ln for ln in lines)
+        o.append("    }\n")
+    o.append("\n    if (i < size && (flags & 0x%02X) === 0) {\n" % schema.flags["CLOCK_TRAILER"]["mask"])
+    o.append("""        // zero padding of the frames of a survey (DRPWSZ_SEQUENCE)
+        var k = i;
+        while (k < size && bytes[k] === 0) {
+            k++;
+        }
+        if (k === size) {
+            o['padding_len'] = size - i;
+            i = size;
+        }
+    }
+""")
+    o.append("""
+    if (i !== size) {
+        return { _errors: ["bad length for the sensors 0x" + sensors.toString(16)] };
+    }
+    return o;
+}
+""")
+    return "".join(o)
+
+
+def gen_readme(schema):
+    o = []
+    o.append("<!-- %s -->\n\n" % GENERATED)
+    o.append("Data uplinks on port %d. The blocks depend on the flags and on the sensors of the endpoint.\n\n" % schema.port)
+    o.append("Byte 0 is the flags:\n\n| Bit | Flag |\n|-----|------|\n")
+    for fl in schema.flag_list:
+        o.append("| 0x%02X | %s |\n" % (fl["mask"], fl["doc"]))
+    o.append("\nThen the blocks, in this order:\n\n| Block | Present if | Field | Type | Unit |\n"
+             "|-------|------------|-------|------|------|\n")
+    for b in schema.blocks:
+        if "presence_flag" in b:
+            cond = "flag 0x%02X" % schema.flags[b["presence_flag"]]["mask"]
+        else:
+            cond = "sensor %s and no flag 0x%02X" % (b["sensor"], schema.flags[b["error_flag"]]["mask"])
+        for fd in b["fields"]:
+            unit = fd["unit"]
+            if "scale" in fd:
+                unit = "%s * %d" % (unit, fd["scale"])
+            elif "angle" in fd:
+                unit = "2^23 for %d%s" % (fd["angle"], fd["unit"])
+            if "sensor" in fd:
+                unit += " (%s only)" % fd["sensor"]
+            o.append("| %s | %s | `%s` | %s | %s |\n" % (b["name"], cond, fd["name"], fd["type"], unit))
+    o.append("\nWithout the clock sync trailer (flag 0x%02X), the payload can end with a zero padding: the frames of a "
+             "survey (`DRPWSZ_SEQUENCE`) are padded to the size of the triplet. The decoders skip it (`padding_len`).\n"
+             % schema.flags["CLOCK_TRAILER"]["mask"])
+    o.append("\nTypes: `u16le`/`s16le` unsigned/signed 16 bits little endian, `s16be`/`s24be` signed 16/24 bits big endian.\n")
+    return "".join(o)
+
+
+def replace_region(path, begin, end, content):
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+    b = text.find(begin)
+    e = text.find(end)
+    if b < 0 or e < b:
+        sys.exit("%s: markers not found" % path)
+    text = text[:b + len(begin)] + "\n" + content + text[e:]
+    with open(path, "w", encoding="utf-8") as f:
+        f.write(text)
+
+
+def main(argv):
+    if len(argv) != 7:
+        sys.exit("usage: %s payload.json payload_codec.h payload_codec.c codec_json.c decoder.js README.md"
+                 % argv[0])
+
+    schema = Schema(argv[1])
+    with open(argv[2], "w", encoding="utf-8") as f:
+        gen_header(schema, f)
+    with open(argv[3], "w", encoding="utf-8") as f:
+        gen_codec(schema, f)
+    with open(argv[4], "w", encoding="utf-8") as f:
+        gen_json(schema, f)
+    replace_region(argv[5], "// BEGIN DecodeData", "// END DecodeData", gen_js(schema))
+    replace_region(argv[6], "<!-- BEGIN uplink -->", "<!-- END uplink -->", gen_readme(schema))
+
+
+if __name__ == "__main__":
+    main(sys.argv)
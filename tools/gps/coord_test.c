@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host test and benchmark of the conversion of the NMEA coordinates (nmea_coord_to_binary).
+ *
+ * The integer conversion used by gps.c is checked against golden vectors, against the
+ * sentences of the NMEA parser, and bit for bit against the previous floating-point
+ * conversion of gps.c (coord_to_double and positions_to_binary, kept here as the reference)
+ * on random coordinates. Then both conversions are timed.
+ *
+ * Usage: coord_test [-n RANDOM_COORDINATES] [-r SEED] (exit code 1 on failure)
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nmea.h"
+#include "random.h"
+
+#define NELEMS(x)  (sizeof(x) / sizeof((x)[0]))
+
+static unsigned failures = 0;
+
+/*
+ * Reference: the floating-point conversion of gps.c before the integer one
+ */
+static const int32_t MaxNorthPosition = 8388607;  // 2^23 - 1
+static const int32_t MaxSouthPosition = 8388608;  // -2^23
+static const int32_t MaxEastPosition  = 8388607;  // 2^23 - 1
+static const int32_t MaxWestPosition  = 8388608;  // -2^23
+
+static struct {
+    double latitude;
+    double longitude;
+    int32_t latitude_bin;
+    int32_t longitude_bin;
+} gps_data;
+
+// Convert GPS positions from double to binary values.
+static void positions_to_binary(void)
+{
+    long double temp;
+
+    if (gps_data.latitude >= 0) { // North
+        temp = gps_data.latitude * MaxNorthPosition;
+        gps_data.latitude_bin = temp / 90;
+    } else {                      // South
+        temp = gps_data.latitude * MaxSouthPosition;
+        gps_data.latitude_bin = temp / 90;
+    }
+
+    if (gps_data.longitude >= 0) { // East
+        temp = gps_data.longitude * MaxEastPosition;
+        gps_data.longitude_bin = temp / 180;
+    } else {                       // West
+        temp = gps_data.longitude * MaxWestPosition;
+        gps_data.longitude_bin = temp / 180;
+    }
+}
+
+// Convert a NMEA coordinate ((d)ddmm.mmmmm) and its hemisphere into degrees.
+static bool coord_to_double(const char *field, const char *hemisphere, double *degrees)
+{
+    int32_t value;
+    if (!nmea_fixed(field, 5, &value))
+        return false;
+
+    // degrees * 10^7 + minutes * 10^5
+    *degrees = (value / 10000000) + (value % 10000000) / 6000000.0;
+    if (hemisphere[0] == 'S' || hemisphere[0] == 'W')
+        *degrees = -*degrees;
+    return true;
+}
+
+static bool reference(const char *lat, const char *ns, const char *lon, const char *ew, int32_t *lat_bin,
+                      int32_t *lon_bin)
+{
+    if (!coord_to_double(lat, ns, &gps_data.latitude) || !coord_to_double(lon, ew, &gps_data.longitude)) {
+        return false;
+    }
+    positions_to_binary();
+    *lat_bin = gps_data.latitude_bin;
+    *lon_bin = gps_data.longitude_bin;
+    return true;
+}
+
+/*
+ * Golden vectors (the out of range coordinates are rejected by the integer conversion only)
+ */
+static const struct {
+    const char *field;
+    const char *hemisphere;
+    int32_t max_degrees;
+    bool valid;
+    int32_t bin;
+} vectors[] = {
+    { "0000.00000", "N", 90, true, 0 },
+    { "9000.00000", "N", 90, true, 8388607 },
+    { "9000.00000", "S", 90, true, -8388608 },
+    { "18000.00000", "E", 180, true, 8388607 },
+    { "18000.00000", "W", 180, true, -8388608 },
+    { "4511.40972", "N", 90, true, 4212027 },
+    { "00543.82413", "E", 180, true, 267056 },
+    { "4807.038", "N", 90, true, 4484856 },
+    { "01131.000", "E", 180, true, 536715 },
+    { "3352.1284", "S", 90, true, -3156801 },
+    { "15112.5621", "E", 180, true, 7046866 },
+    { "4042.7680", "N", 90, true, 3794707 },
+    { "07400.3574", "W", 180, true, -3448927 },
+    { "0000.00001", "N", 90, true, 0 },
+    { "0000.00001", "W", 180, true, 0 },
+    { "8959.99999", "S", 90, true, -8388607 },
+    { "17959.99999", "W", 180, true, -8388607 },
+    { "9000.00001", "N", 90, false, 0 },
+    { "18000.00001", "E", 180, false, 0 },
+    { "4560.00000", "N", 90, false, 0 },
+    { "", "N", 90, false, 0 },
+    { "abc", "N", 90, false, 0 },
+    { "99999.99999", "N", 90, false, 0 },
+    { "-4511.0", "N", 90, false, 0 },
+};
+
+/*
+ * Sentences: the position fields of GGA (2 to 5) and RMC (3 to 6)
+ */
+static const struct {
+    const char *sentence;
+    uint8_t lat_field;
+    int32_t lat_bin;
+    int32_t lon_bin;
+} sentences[] = {
+    { "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n", 2, 4484856, 536715 },
+    { "$GNRMC,083559.00,A,4511.40972,N,00543.82413,E,0.004,77.52,091202,,,A*4E\r\n", 3, 4212027, 267056 },
+    { "$GPGGA,235317.000,3352.1284,S,15112.5621,E,2,07,1.1,58.0,M,22.0,M,,*77\r\n", 2, -3156801, 7046866 },
+};
+
+static void test_vectors(void)
+{
+    for (unsigned i = 0; i < NELEMS(vectors); i++) {
+        int32_t bin = 0;
+        bool valid = nmea_coord_to_binary(vectors[i].field, vectors[i].hemisphere, vectors[i].max_degrees, &bin);
+        if (valid != vectors[i].valid || (valid && bin != vectors[i].bin)) {
+            printf("FAIL vector %s %s: valid=%d bin=%d expected valid=%d bin=%d\n", vectors[i].field,
+                   vectors[i].hemisphere, valid, bin, vectors[i].valid, vectors[i].bin);
+            failures++;
+        }
+        if (!valid) {
+            continue;
+        }
+        // same as the reference
+        int32_t lat_bin = 0, lon_bin = 0;
+        bool is_lat = vectors[i].max_degrees == 90;
+        reference(is_lat ? vectors[i].field : "0", vectors[i].hemisphere, is_lat ? "0" : vectors[i].field,
+                  vectors[i].hemisphere, &lat_bin, &lon_bin);
+        if ((is_lat ? lat_bin : lon_bin) != bin) {
+            printf("FAIL vector %s %s: bin=%d reference=%d\n", vectors[i].field, vectors[i].hemisphere, bin,
+                   is_lat ? lat_bin : lon_bin);
+            failures++;
+        }
+    }
+}
+
+static void test_sentences(void)
+{
+    for (unsigned i = 0; i < NELEMS(sentences); i++) {
+        nmea_parser_t p;
+        nmea_init(&p);
+        bool complete = false;
+        for (const char *c = sentences[i].sentence; *c != '\0'; c++) {
+            complete |= nmea_parse_byte(&p, *c);
+        }
+        uint8_t f = sentences[i].lat_field;
+        int32_t lat, lon;
+        if (!complete || !nmea_coord_to_binary(nmea_field(&p, f), nmea_field(&p, f + 1), 90, &lat)
+            || !nmea_coord_to_binary(nmea_field(&p, f + 2), nmea_field(&p, f + 3), 180, &lon)
+            || lat != sentences[i].lat_bin || lon != sentences[i].lon_bin) {
+            printf("FAIL sentence %s", sentences[i].sentence);
+            failures++;
+        }
+    }
+}
+
+/*
+ * Random coordinate field with 5 decimals of minutes
+ */
+static void random_coord(char *lat, char *ns, char *lon, char *ew)
+{
+    uint32_t d = random_uint32_range(0, 91);
+    uint32_t m = (d == 90) ? 0 : random_uint32_range(0, 6000000);
+    sprintf(lat, "%02u%02u.%05u", d, m / 100000, m % 100000);
+    d = random_uint32_range(0, 181);
+    m = (d == 180) ? 0 : random_uint32_range(0, 6000000);
+    sprintf(lon, "%03u%02u.%05u", d, m / 100000, m % 100000);
+    ns[0] = random_uint32_range(0, 2) ? 'N' : 'S';
+    ew[0] = random_uint32_range(0, 2) ? 'E' : 'W';
+    ns[1] = ew[1] = '\0';
+}
+
+static void test_random(unsigned long n)
+{
+    unsigned long mismatches = 0;
+    for (unsigned long i = 0; i < n; i++) {
+        char lat[16], lon[16], ns[2], ew[2];
+        random_coord(lat, ns, lon, ew);
+        int32_t lat_ref = 0, lon_ref = 0, lat_bin = 0, lon_bin = 0;
+        reference(lat, ns, lon, ew, &lat_ref, &lon_ref);
+        if (!nmea_coord_to_binary(lat, ns, 90, &lat_bin) || !nmea_coord_to_binary(lon, ew, 180, &lon_bin)
+            || lat_bin != lat_ref || lon_bin != lon_ref) {
+            if (mismatches++ < 10) {
+                printf("FAIL %s %s %s %s: %d %d reference %d %d\n", lat, ns, lon, ew, lat_bin, lon_bin, lat_ref,
+                       lon_ref);
+            }
+        }
+    }
+    failures += mismatches;
+    printf("random coordinates: %lu, mismatches: %lu\n", n, mismatches);
+}
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+static void benchmark(void)
+{
+    enum { NB = 1024, LOOPS = 2000 };
+    static char lat[NB][16], lon[NB][16], ns[NB][2], ew[NB][2];
+    for (unsigned i = 0; i < NB; i++) {
+        random_coord(lat[i], ns[i], lon[i], ew[i]);
+    }
+
+    struct timespec start, end;
+    uint32_t sum = 0;
+    int32_t a = 0, b = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned l = 0; l < LOOPS; l++) {
+        for (unsigned i = 0; i < NB; i++) {
+            nmea_coord_to_binary(lat[i], ns[i], 90, &a);
+            nmea_coord_to_binary(lon[i], ew[i], 180, &b);
+            sum += (uint32_t)(a ^ b);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double integer_ns = elapsed_ns(&start, &end) / ((double)NB * LOOPS);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned l = 0; l < LOOPS; l++) {
+        for (unsigned i = 0; i < NB; i++) {
+            reference(lat[i], ns[i], lon[i], ew[i], &a, &b);
+            sum += (uint32_t)(a ^ b);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double double_ns = elapsed_ns(&start, &end) / ((double)NB * LOOPS);
+
+    // on the host (with a FPU): the gain is larger on the Cortex-M4 without double precision FPU
+    printf("position (lat+lon): integer %.1f ns, double %.1f ns [%d]\n", integer_ns, double_ns, (int)(sum & 1));
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long n = 2000000;
+    uint32_t seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+        switch (opt) {
+        case 'n': n = strtoul(optarg, NULL, 0); break;
+        case 'r': seed = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-n RANDOM_COORDINATES] [-r SEED]\n", argv[0]);
+            return 1;
+        }
+    }
+    random_init(seed);
+
+    test_vectors();
+    test_sentences();
+    test_random(n);
+    benchmark();
+
+    printf("coord_test: %u failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
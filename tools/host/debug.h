@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host stand-in of the RIOT debug.h for the host tools (silent unless HOST_DEBUG is 1).
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef DEBUG_H
+#define DEBUG_H
+
+#include <stdio.h>
+
+#ifndef HOST_DEBUG
+#define HOST_DEBUG      (0)
+#endif
+
+#define DEBUG(...)      do { if (HOST_DEBUG) { printf(__VA_ARGS__); } } while (0)
+#define DEBUG_PUTS(s)   do { if (HOST_DEBUG) { puts(s); } } while (0)
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host implementation of the RIOT stand-ins (random, virtual clocks and virtual RTC).
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define _DEFAULT_SOURCE
+#include <time.h>
+
+#include "periph/rtc.h"
+#include "random.h"
+#include "ztimer.h"
+
+static ztimer_clock_t clock_msec;
+static ztimer_clock_t clock_sec;
+
+ztimer_clock_t *const ZTIMER_MSEC = &clock_msec;
+ztimer_clock_t *const ZTIMER_SEC = &clock_sec;
+
+void ztimer_sleep(ztimer_clock_t *clock, uint32_t duration)
+{
+    // both clocks run together
+    if (clock == ZTIMER_SEC) {
+        clock_sec.now += duration;
+        clock_msec.now += duration * 1000;
+    } else {
+        clock_msec.now += duration;
+        clock_sec.now = clock_msec.now / 1000;
+    }
+}
+
+// xorshift64*: reproducible runs
+static uint64_t random_state = 0x9E3779B97F4A7C15ULL;
+
+void random_init(uint32_t seed)
+{
+    random_state = 0x9E3779B97F4A7C15ULL ^ seed;
+}
+
+uint32_t random_uint32(void)
+{
+    random_state ^= random_state >> 12;
+    random_state ^= random_state << 25;
+    random_state ^= random_state >> 27;
+    return (uint32_t)((random_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+uint32_t random_uint32_range(uint32_t a, uint32_t b)
+{
+    return a + (uint32_t)(((uint64_t)random_uint32() * (b - a)) >> 32);
+}
+
+// virtual RTC: the time set runs with ZTIMER_SEC
+static int rtc_valid = 0;
+static time_t rtc_time;
+static uint32_t rtc_set_at;
+unsigned host_rtc_writes = 0;
+
+int rtc_get_time(struct tm *time)
+{
+    if (!rtc_valid) {
+        return -1;
+    }
+    time_t t = rtc_time + (time_t)(clock_sec.now - rtc_set_at);
+    gmtime_r(&t, time);
+    return 0;
+}
+
+int rtc_set_time(struct tm *time)
+{
+    rtc_time = timegm(time);
+    rtc_set_at = clock_sec.now;
+    rtc_valid = 1;
+    host_rtc_writes++;
+    return 0;
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host stand-in of the RIOT irq.h (single-threaded host tools).
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef IRQ_H
+#define IRQ_H
+
+static inline unsigned irq_disable(void)
+{
+    return 0;
+}
+
+static inline void irq_restore(unsigned state)
+{
+    (void)state;
+}
+
+#endif
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host stand-in of the RIOT mutex: the host tools are single-threaded, a relock is a deadlock on the target.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef MUTEX_H
+#define MUTEX_H
+
+#include <assert.h>
+
+typedef struct {
+    int locked;
+} mutex_t;
+
+#define MUTEX_INIT      { 0 }
+
+static inline void mutex_lock(mutex_t *mutex)
+{
+    assert(!mutex->locked);
+    mutex->locked = 1;
+}
+
+static inline void mutex_unlock(mutex_t *mutex)
+{
+    assert(mutex->locked);
+    mutex->locked = 0;
+}
+
+#endif
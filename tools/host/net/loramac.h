@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host stand-in of the RIOT net/loramac.h (the lengths of the identifiers).
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef NET_LORAMAC_H
+#define NET_LORAMAC_H
+
+#define LORAMAC_DEVEUI_LEN          (8U)
+#define LORAMAC_APPEUI_LEN          (8U)
+#define LORAMAC_APPKEY_LEN          (16U)
+#define LORAMAC_APPSKEY_LEN         (16U)
+#define LORAMAC_NWKSKEY_LEN         (16U)
+#define LORAMAC_DEVADDR_LEN         (4U)
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host stand-in of the RIOT periph/rtc.h: a virtual RTC running with ZTIMER_SEC (implemented in host.c).
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef PERIPH_RTC_H
+#define PERIPH_RTC_H
+
+#include <time.h>
+
+/* -1 until the first rtc_set_time */
+int rtc_get_time(struct tm *time);
+
+int rtc_set_time(struct tm *time);
+
+/* number of rtc_set_time calls */
+extern unsigned host_rtc_writes;
+
+#endif
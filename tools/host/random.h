@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host stand-in of the RIOT random module (implemented in host.c, seeded by random_init).
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <inttypes.h>
+
+void random_init(uint32_t seed);
+
+uint32_t random_uint32(void);
+
+/* uniform into [a, b) */
+uint32_t random_uint32_range(uint32_t a, uint32_t b);
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host stand-in of the RIOT semtech_loramac.h: the descriptor and the return codes (the host tools mock the MAC).
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef SEMTECH_LORAMAC_H
+#define SEMTECH_LORAMAC_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "net/loramac.h"
+
+/* same order as RIOT */
+enum {
+    SEMTECH_LORAMAC_JOIN_SUCCEEDED,
+    SEMTECH_LORAMAC_JOIN_FAILED,
+    SEMTECH_LORAMAC_NOT_JOINED,
+    SEMTECH_LORAMAC_ALREADY_JOINED,
+    SEMTECH_LORAMAC_TX_OK,
+    SEMTECH_LORAMAC_TX_SCHEDULE,
+    SEMTECH_LORAMAC_TX_DONE,
+    SEMTECH_LORAMAC_TX_CNF_FAILED,
+    SEMTECH_LORAMAC_TX_ERROR,
+    SEMTECH_LORAMAC_RX_DATA,
+    SEMTECH_LORAMAC_RX_LINK_CHECK,
+    SEMTECH_LORAMAC_RX_CONFIRMED,
+    SEMTECH_LORAMAC_BUSY,
+    SEMTECH_LORAMAC_DUTYCYCLE_RESTRICTED,
+};
+
+typedef struct {
+    uint8_t payload[242];
+    uint8_t payload_len;
+    uint8_t port;
+} semtech_loramac_rx_data_t;
+
+typedef struct {
+    uint8_t demod_margin;
+    uint8_t nb_gateways;
+    bool available;
+} semtech_loramac_link_check_info_t;
+
+typedef struct {
+    semtech_loramac_rx_data_t rx_data;
+    semtech_loramac_link_check_info_t link_chk;
+} semtech_loramac_t;
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host stand-in of the RIOT ztimer: a virtual clock advanced by the host tools.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef ZTIMER_H
+#define ZTIMER_H
+
+#include <inttypes.h>
+
+typedef uint32_t ztimer_now_t;
+
+typedef struct {
+    uint32_t now;                           /**< current time of the clock */
+} ztimer_clock_t;
+
+extern ztimer_clock_t *const ZTIMER_MSEC;
+extern ztimer_clock_t *const ZTIMER_SEC;
+
+static inline ztimer_now_t ztimer_now(ztimer_clock_t *clock)
+{
+    return clock->now;
+}
+
+/* the sleeps advance the virtual clocks */
+void ztimer_sleep(ztimer_clock_t *clock, uint32_t duration);
+
+#endif
@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2022 Université Grenoble Alpes
+#
+# This file is subject to the terms and conditions of the GNU Lesser
+# General Public License v2.1. See the file LICENSE in the top level
+# directory for more details.
+#
+# Generate the sorted table of the DevAddr prefixes (netid_table.h) from the list of the NetIDs.
+#
+# Usage: gen_netid_table.py netid.csv netid_table.h
+
+import csv
+import sys
+
+# DevAddr layout per NetID type (LoRaWAN Backend Interfaces): (prefix length, NwkID bits)
+NETID_TYPES = {
+    0: (1, 6),
+    1: (2, 6),
+    2: (3, 9),
+    3: (4, 11),
+    4: (5, 12),
+    5: (6, 13),
+    6: (7, 15),
+    7: (8, 17),
+}
+
+
+def devaddr_prefix(netid):
+    """Return the DevAddr prefix and its length (in bits) for the NetID"""
+    netid_type = netid >> 21
+    type_len, nwkid_bits = NETID_TYPES[netid_type]
+    nwkid = netid & ((1 << nwkid_bits) - 1)
+    # the type prefix is type_len - 1 ones followed by a zero
+    type_prefix = ((1 << (type_len - 1)) - 1) << 1
+    prefix_len = type_len + nwkid_bits
+    prefix = ((type_prefix << nwkid_bits) | nwkid) << (32 - prefix_len)
+    return prefix, prefix_len
+
+
+def c_string(s):
+    return '"' + s.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.exit("usage: %s netid.csv netid_table.h" % argv[0])
+
+    entries = []
+    with open(argv[1], encoding="utf-8") as f:
+        for row in csv.reader(line for line in f if line.strip() and not line.startswith("#")):
+            netid = int(row[0], 16)
+            operator = row[1].strip()
+            region = row[2].strip() if len(row) > 2 else ""
+            prefix, prefix_len = devaddr_prefix(netid)
+            entries.append((prefix, prefix_len, netid, operator, region))
+
+    entries.sort()
+    for prev, cur in zip(entries, entries[1:]):
+        prev_end = prev[0] + (1 << (32 - prev[1]))
+        if cur[0] < prev_end:
+            sys.exit("overlapping prefixes: NetID %06X and NetID %06X" % (prev[2], cur[2]))
+
+    with open(argv[2], "w", encoding="utf-8") as f:
+        f.write("/*\n")
+        f.write(" * Generated by tools/netid/gen_netid_table.py from tools/netid/netid.csv: do not edit\n")
+        f.write(" */\n\n")
+        f.write("#ifndef NETID_TABLE_H\n#define NETID_TABLE_H\n\n")
+        f.write('#include "netid.h"\n\n')
+        f.write("/* sorted by DevAddr prefix */\n")
+        f.write("static const netid_entry_t netid_table[] = {\n")
+        for prefix, prefix_len, netid, operator, region in entries:
+            f.write("    { 0x%08X, %2d, 0x%06X, %s, %s },\n"
+                    % (prefix, prefix_len, netid, c_string(operator), c_string(region)))
+        f.write("};\n\n#endif\n")
+
+
+if __name__ == "__main__":
+    main(sys.argv)
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2022 Université Grenoble Alpes
+#
+# This file is subject to the terms and conditions of the GNU Lesser
+# General Public License v2.1. See the file LICENSE in the top level
+# directory for more details.
+#
+# Merge a published list of the NetIDs into netid.csv.
+#
+# The supported sources are:
+#   - the NetID assignments of the LoRa Alliance exported as CSV: the columns are found by their
+#     header (NetID, Company/Member/Operator/Name, Region/Country); the NetIDs are in hexadecimal
+#   - the list of the networks of the Packet Broker (JSON, GET /v1/networks): the objects with
+#     a netId and a name; the tenants (tenantId) are sub-blocks of a NetID and are skipped
+#
+# The rows of netid.csv are kept (names and regions curated by the project) and the new NetIDs
+# are added. The output is sorted by NetID.
+#
+# Usage: import_netid.py netid.csv SOURCE...
+
+import csv
+import json
+import re
+import sys
+
+HEADER = """# LoRaWAN NetIDs (LoRa Alliance NetID assignments)
+# The DevAddr prefix is derived from the NetID by gen_netid_table.py
+# Merged by import_netid.py: the existing rows are kept, the new NetIDs are added
+# netid,operator,region
+"""
+
+
+def parse_netid(value):
+    value = value.strip()
+    if value.lower().startswith("0x"):
+        value = value[2:]
+    if not re.fullmatch(r"[0-9A-Fa-f]{1,6}", value):
+        return None
+    return int(value, 16)
+
+
+def read_netid_csv(path):
+    rows = {}
+    with open(path, encoding="utf-8") as f:
+        for row in csv.reader(line for line in f if line.strip() and not line.startswith("#")):
+            netid = parse_netid(row[0])
+            if netid is None:
+                sys.exit("%s: bad NetID: %s" % (path, row[0]))
+            rows[netid] = (row[1].strip(), row[2].strip() if len(row) > 2 else "")
+    return rows
+
+
+def find_column(header, patterns):
+    for pattern in patterns:
+        for i, name in enumerate(header):
+            if re.search(pattern, name, re.IGNORECASE):
+                return i
+    return None
+
+
+def read_alliance_csv(path):
+    with open(path, encoding="utf-8-sig", newline="") as f:
+        sample = f.read(4096)
+        f.seek(0)
+        dialect = csv.Sniffer().sniff(sample, delimiters=",;\t")
+        reader = csv.reader(f, dialect)
+        header = next(reader)
+        col_netid = find_column(header, [r"^\s*net\s*-?id\s*$", r"net\s*-?id"])
+        col_name = find_column(header, [r"operator", r"company", r"member", r"name"])
+        col_region = find_column(header, [r"region", r"country"])
+        if col_netid is None or col_name is None:
+            sys.exit("%s: no NetID or name column in the header: %s" % (path, header))
+        for row in reader:
+            if len(row) <= max(col_netid, col_name):
+                continue
+            netid = parse_netid(row[col_netid])
+            name = row[col_name].strip()
+            if netid is None or not name:
+                continue
+            region = row[col_region].strip() if col_region is not None and len(row) > col_region else ""
+            yield netid, name, region
+
+
+def read_packet_broker_json(path):
+    with open(path, encoding="utf-8") as f:
+        data = json.load(f)
+    if isinstance(data, dict):
+        data = data.get("networks", [])
+    for network in data:
+        if "netId" not in network or network.get("tenantId"):
+            continue
+        netid = network["netId"]
+        netid = parse_netid(netid) if isinstance(netid, str) else int(netid)
+        name = network.get("name", "").strip()
+        if netid is None or not name:
+            continue
+        yield netid, name, ""
+
+
+def main(argv):
+    if len(argv) < 3:
+        sys.exit("usage: %s netid.csv SOURCE..." % argv[0])
+
+    rows = read_netid_csv(argv[1])
+    added = 0
+    for source in argv[2:]:
+        entries = read_packet_broker_json(source) if source.endswith(".json") else read_alliance_csv(source)
+        for netid, name, region in entries:
+            if netid >= 1 << 24:
+                sys.exit("%s: bad NetID: %X" % (source, netid))
+            if netid not in rows:
+                rows[netid] = (name, region)
+                added += 1
+
+    with open(argv[1], "w", encoding="utf-8", newline="") as f:
+        f.write(HEADER)
+        writer = csv.writer(f, lineterminator="\n")
+        for netid in sorted(rows):
+            name, region = rows[netid]
+            writer.writerow(["%06X" % netid, name, region])
+    print("%s: %d NetIDs (%d added)" % (argv[1], len(rows), added))
+
+
+if __name__ == "__main__":
+    main(sys.argv)
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host CLI printing the network of DevAddrs (same lookup as the firmware).
+ *
+ * Usage: netid_cli DEVADDR...  (or the DevAddrs on the standard input, one per line)
+ * Output: <devaddr>,<netid>,<operator>,<region>
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "netid.h"
+
+static int print_network(const char *arg)
+{
+    char *end;
+    unsigned long devaddr = strtoul(arg, &end, 16);
+    if (end == arg || (*end != '\0' && *end != '\n' && *end != '\r')) {
+        fprintf(stderr, "bad DevAddr: %s\n", arg);
+        return 1;
+    }
+
+    const netid_entry_t *e = netid_lookup((uint32_t)devaddr);
+    if (e == NULL) {
+        printf("%08lX,,Unknown,\n", devaddr);
+    } else {
+        printf("%08lX,%06lX,%s,%s\n", devaddr, (unsigned long)e->netid, e->name, e->region);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int ret = 0;
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            ret |= print_network(argv[i]);
+        }
+    } else {
+        char line[64];
+        while (fgets(line, sizeof(line), stdin) != NULL) {
+            ret |= print_network(line);
+        }
+    }
+    return ret;
+}
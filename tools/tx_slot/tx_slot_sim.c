@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host simulation of a fleet of co-located endpoints using the TX slotting.
+ *
+ * Each endpoint runs the scheduling of the firmware: the phase of the first transmission
+ * (tx_slot_first_delay_ms), the jittered period (tx_slot_adjust_period_ms), the duty-cycle
+ * budget (loramac_dutycycle) and the confirmed policy (TXCNF, CNF_EVERY_N and the fallback to
+ * unconfirmed after a missing ACK). The endpoints boot together (power cut) and transmit on
+ * a random channel among the 3 default EU868 channels with the same DR. Two overlapping
+ * uplinks on the same channel are both lost (no capture effect, a single gateway receiving
+ * all the channels, the ACKs are never lost). The retries of the confirmed uplinks are not
+ * simulated (CNF_MAX_RETRIES=0).
+ *
+ * tx_slot.c and loramac_dutycycle.c are included (not linked) so that their state can be
+ * saved and restored for each endpoint.
+ *
+ * Usage: tx_slot_sim [-n NODES] [-d DR] [-p TXPERIOD_AT_DR0] [-s SIZE] [-t HOURS]
+ *                    [-c CNF_EVERY_N] [-C] [-w WARMUP_SEC] [-b] [-r SEED]
+ *   -C     all the uplinks are confirmed (TXCNF)
+ *   -w     delay of the first measure after the boot (the sensors warm-up)
+ *   -b     baseline without TX slotting (no phase, no jitter)
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../tx_slot.c"
+#include "../../loramac_dutycycle.c"
+
+// same as main.c
+#define TX_SLOT_FIRST_WINDOW_SEC        (30U)
+// same as cnf_policy.c
+#define CNF_FALLBACK_FRAMES             (10U)
+
+#define NB_CHANNELS                     (3U)
+// the uplinks which can overlap a new one on a channel
+#define CHANNEL_HISTORY                 (64U)
+// end of the RX2 window after the end of the uplink
+#define RX_WINDOWS_MS                   (2000U)
+
+enum {
+    EVENT_TX_START = 0,
+    EVENT_TX_END,
+};
+
+typedef struct {
+    // state of tx_slot.c
+    uint16_t phase;
+    uint8_t cnt_collisions;
+    bool reshuffle;
+    // state of loramac_dutycycle.c
+    dutycycle_band_t bands[LORAMAC_DUTYCYCLE_NB_BANDS];
+    // state of cnf_policy.c
+    uint32_t cnt_frames;
+    uint16_t fallback_frames;
+
+    // the current uplink
+    uint32_t tx_start;
+    uint32_t tx_end;
+    bool confirmed;
+    bool lost;
+
+    // next event
+    uint32_t event_time;
+    uint8_t event;
+} node_t;
+
+typedef struct {
+    uint16_t node[CHANNEL_HISTORY];         // index + 1 (0 if empty)
+    uint32_t tx_end[CHANNEL_HISTORY];
+    uint8_t head;
+} channel_t;
+
+static node_t *nodes;
+static channel_t channels[NB_CHANNELS];
+
+// binary heap of the node indexes ordered by event time
+static uint16_t *heap;
+static unsigned heap_len;
+
+static void heap_swap(unsigned a, unsigned b)
+{
+    uint16_t t = heap[a];
+    heap[a] = heap[b];
+    heap[b] = t;
+}
+
+static void heap_push(uint16_t n)
+{
+    unsigned i = heap_len++;
+    heap[i] = n;
+    while (i > 0 && nodes[heap[(i - 1) / 2]].event_time > nodes[heap[i]].event_time) {
+        heap_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static uint16_t heap_pop(void)
+{
+    uint16_t top = heap[0];
+    heap[0] = heap[--heap_len];
+    unsigned i = 0;
+    while (true) {
+        unsigned l = 2 * i + 1, r = l + 1, m = i;
+        if (l < heap_len && nodes[heap[l]].event_time < nodes[heap[m]].event_time) {
+            m = l;
+        }
+        if (r < heap_len && nodes[heap[r]].event_time < nodes[heap[m]].event_time) {
+            m = r;
+        }
+        if (m == i) {
+            break;
+        }
+        heap_swap(i, m);
+        i = m;
+    }
+    return top;
+}
+
+static void node_load(const node_t *n)
+{
+    phase = n->phase;
+    cnt_collisions = n->cnt_collisions;
+    reshuffle = n->reshuffle;
+    memcpy(bands, n->bands, sizeof(bands));
+}
+
+static void node_save(node_t *n)
+{
+    n->phase = phase;
+    n->cnt_collisions = cnt_collisions;
+    n->reshuffle = reshuffle;
+    memcpy(n->bands, bands, sizeof(bands));
+}
+
+// same as cnf_policy.c (no alarm)
+static bool is_confirmed(node_t *n, bool txcnf, uint16_t cnf_every_n)
+{
+    n->cnt_frames++;
+    if (n->fallback_frames > 0) {
+        n->fallback_frames--;
+        return false;
+    }
+    if (txcnf) {
+        return true;
+    }
+    return cnf_every_n != 0 && (n->cnt_frames % cnf_every_n) == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned nb_nodes = 500;
+    uint8_t dr = 5;
+    uint32_t txperiod_at_dr0 = 180;
+    uint8_t size = 29;
+    uint32_t hours = 24;
+    uint16_t cnf_every_n = 0;
+    bool txcnf = false;
+    uint32_t warmup_sec = 0;
+    bool baseline = false;
+    uint32_t seed = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:d:p:s:t:c:Cw:br:")) != -1) {
+        switch (opt) {
+        case 'n': nb_nodes = strtoul(optarg, NULL, 0); break;
+        case 'd': dr = strtoul(optarg, NULL, 0); break;
+        case 'p': txperiod_at_dr0 = strtoul(optarg, NULL, 0); break;
+        case 's': size = strtoul(optarg, NULL, 0); break;
+        case 't': hours = strtoul(optarg, NULL, 0); break;
+        case 'c': cnf_every_n = strtoul(optarg, NULL, 0); break;
+        case 'C': txcnf = true; break;
+        case 'w': warmup_sec = strtoul(optarg, NULL, 0); break;
+        case 'b': baseline = true; break;
+        case 'r': seed = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-n NODES] [-d DR] [-p TXPERIOD_AT_DR0] [-s SIZE] [-t HOURS] "
+                    "[-c CNF_EVERY_N] [-C] [-w WARMUP_SEC] [-b] [-r SEED]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (nb_nodes == 0 || nb_nodes > 65535 || dr > 5) {
+        fprintf(stderr, "bad parameters\n");
+        return 1;
+    }
+
+    random_init(seed);
+    nodes = calloc(nb_nodes, sizeof(node_t));
+    heap = calloc(nb_nodes, sizeof(uint16_t));
+
+    uint32_t period_ms = (txperiod_at_dr0 >> dr) * 1000;
+    uint32_t toa = loramac_dutycycle_time_on_air_ms(dr, size);
+    uint32_t end_ms = hours * 3600000UL;
+
+    for (unsigned i = 0; i < nb_nodes; i++) {
+        node_t *n = nodes + i;
+        // consecutive DevEUIs (same batch of endpoints)
+        uint8_t deveui[8] = { 0x70, 0xB3, 0xD5, 0x7E, 0xD0, 0x00, (i >> 8) & 0xFF, i & 0xFF };
+        tx_slot_init(deveui, sizeof(deveui));
+        memset(bands, 0, sizeof(bands));
+        node_save(n);
+        // same as main.c: the phase is applied after the first measure
+        n->event_time = warmup_sec * 1000 + (baseline ? 0 : tx_slot_first_delay_ms(TX_SLOT_FIRST_WINDOW_SEC * 1000U));
+        n->event = EVENT_TX_START;
+        heap_push(i);
+    }
+
+    uint64_t nb_tx = 0, nb_lost = 0, nb_tx_1h = 0, nb_lost_1h = 0;
+    uint64_t nb_cnf = 0, nb_cnf_lost = 0, nb_collision_calls = 0, nb_reshuffles = 0;
+
+    while (heap_len > 0) {
+        uint16_t id = heap_pop();
+        node_t *n = nodes + id;
+        if (n->event_time >= end_ms) {
+            continue;
+        }
+        ZTIMER_MSEC->now = n->event_time;
+        node_load(n);
+
+        if (n->event == EVENT_TX_START) {
+            n->tx_start = n->event_time;
+            n->tx_end = n->tx_start + toa;
+            n->lost = false;
+            n->confirmed = is_confirmed(n, txcnf, cnf_every_n);
+            // the uplinks still on air on the channel collide with this one
+            channel_t *ch = channels + random_uint32_range(0, NB_CHANNELS);
+            for (unsigned k = 1; k <= CHANNEL_HISTORY; k++) {
+                unsigned h = (ch->head + CHANNEL_HISTORY - k) % CHANNEL_HISTORY;
+                if (ch->node[h] == 0 || ch->tx_end[h] <= n->tx_start) {
+                    break;
+                }
+                nodes[ch->node[h] - 1].lost = true;
+                n->lost = true;
+            }
+            ch->node[ch->head] = id + 1;
+            ch->tx_end[ch->head] = n->tx_end;
+            ch->head = (ch->head + 1) % CHANNEL_HISTORY;
+            loramac_dutycycle_register_tx(dr, size, n->tx_start);
+            n->event_time = n->tx_end + RX_WINDOWS_MS;
+            n->event = EVENT_TX_END;
+        } else {
+            // all the overlapping uplinks have started: the outcome is known
+            nb_tx++;
+            nb_lost += n->lost;
+            if (n->tx_start < 3600000UL) {
+                nb_tx_1h++;
+                nb_lost_1h += n->lost;
+            }
+            if (n->confirmed && !baseline) {
+                nb_cnf++;
+                if (n->lost) {
+                    nb_cnf_lost++;
+                    nb_collision_calls++;
+                    tx_slot_collision();
+                    nb_reshuffles += reshuffle;
+                    n->fallback_frames = CNF_FALLBACK_FRAMES;
+                } else {
+                    tx_slot_delivered();
+                }
+            }
+            // same as loramac_utils_sleep_next_tx
+            uint32_t now = n->event_time;
+            uint32_t min_period = now + loramac_dutycycle_next_tx_delay(n->tx_start, 0, now) - n->tx_start;
+            uint32_t target = baseline ? period_ms : tx_slot_adjust_period_ms(period_ms, min_period);
+            uint32_t delay = loramac_dutycycle_next_tx_delay(n->tx_start, target, now);
+            n->event_time += delay;
+            n->event = EVENT_TX_START;
+        }
+        node_save(n);
+        heap_push(id);
+    }
+
+    printf("nodes=%u dr=%u size=%u toa=%lu ms period=%lu ms hours=%lu %s txcnf=%d cnf_every_n=%u warmup=%lu s\n",
+           nb_nodes, dr, size, (unsigned long)toa, (unsigned long)period_ms, (unsigned long)hours,
+           baseline ? "baseline" : "tx_slot", txcnf, cnf_every_n, (unsigned long)warmup_sec);
+    printf("uplinks=%llu pdr=%.4f first_hour_pdr=%.4f confirmed=%llu not_acked=%llu "
+           "tx_slot_collision=%llu reshuffles=%llu\n",
+           (unsigned long long)nb_tx, nb_tx ? 1.0 - (double)nb_lost / nb_tx : 0.0,
+           nb_tx_1h ? 1.0 - (double)nb_lost_1h / nb_tx_1h : 0.0,
+           (unsigned long long)nb_cnf, (unsigned long long)nb_cnf_lost,
+           (unsigned long long)nb_collision_calls, (unsigned long long)nb_reshuffles);
+
+    free(heap);
+    free(nodes);
+    return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Per-device TX slotting for avoiding the collisions of a fleet of endpoints.
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#define ENABLE_DEBUG (1)
+#include "debug.h"
+
+#include <stdbool.h>
+
+#include "random.h"
+
+#include "tx_slot.h"
+
+// phase into the period (in 1/65536 of the period)
+static uint16_t phase = 0;
+
+static uint8_t cnt_collisions = 0;
+static bool reshuffle = false;
+
+/*
+ * FNV-1a hash
+ */
+static uint32_t fnv1a(const uint8_t *data, size_t len)
+{
+    uint32_t h = 2166136261UL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+void tx_slot_init(const uint8_t *id, size_t len)
+{
+    uint32_t h = fnv1a(id, len);
+    phase = (h >> 16) ^ (h & 0xFFFF);
+    DEBUG("[slot] phase=%d/65536\n", phase);
+}
+
+uint32_t tx_slot_first_delay_ms(uint32_t period_ms)
+{
+    return ((uint64_t)period_ms * phase) >> 16;
+}
+
+uint32_t tx_slot_adjust_period_ms(uint32_t period_ms, uint32_t min_period_ms)
+{
+    uint32_t jitter_max = (period_ms > min_period_ms ? period_ms : min_period_ms) * TX_SLOT_JITTER_PERCENT / 100;
+    if (period_ms < min_period_ms + jitter_max) {
+        // the duty-cycle bounds the period: the jitter is kept above the off-time
+        period_ms = min_period_ms + jitter_max;
+    }
+    uint32_t adjusted = period_ms;
+
+    if (jitter_max > 0) {
+        // uniform into [-jitter_max, +jitter_max]
+        uint32_t r = random_uint32_range(0, 2 * jitter_max + 1);
+        adjusted = period_ms - jitter_max + r;
+    }
+
+    if (reshuffle) {
+        // shift the phase by a random fraction of the period
+        reshuffle = false;
+        phase = random_uint32() & 0xFFFF;
+        uint32_t shift = tx_slot_first_delay_ms(period_ms);
+        DEBUG("[slot] new phase=%d/65536: shift %ld msec\n", phase, shift);
+        adjusted += shift;
+    }
+    return adjusted;
+}
+
+void tx_slot_collision(void)
+{
+    if (++cnt_collisions >= TX_SLOT_COLLISIONS_BEFORE_RESHUFFLE) {
+        cnt_collisions = 0;
+        reshuffle = true;
+    }
+}
+
+void tx_slot_delivered(void)
+{
+    cnt_collisions = 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2022 Université Grenoble Alpes
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Per-device TX slotting for avoiding the collisions of a fleet of endpoints.
+ *
+ * The phase of the first transmission is derived from a hash of the DevEUI (or the DevAddr),
+ * so the endpoints powered up together do not transmit at the same time. A bounded random
+ * jitter is added to each period and the phase is re-randomized when collisions are suspected
+ * (consecutive confirmed uplinks without ACK).
+ *
+ * @author      Didier Donsez <didier.donsez@univ-grenoble-alpes.fr>
+ *
+ * @}
+ */
+
+#ifndef TX_SLOT_H
+#define TX_SLOT_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Max jitter of the TX period (in percent of the period)
+ */
+#ifndef TX_SLOT_JITTER_PERCENT
+#define TX_SLOT_JITTER_PERCENT              (10U)
+#endif
+
+/*
+ * Number of consecutive suspected collisions before re-randomizing the phase
+ */
+#ifndef TX_SLOT_COLLISIONS_BEFORE_RESHUFFLE
+#define TX_SLOT_COLLISIONS_BEFORE_RESHUFFLE (2U)
+#endif
+
+/**
+ * Compute the phase of the endpoint from its identifier
+ *
+ * @param id    the identifier (DevEUI or DevAddr)
+ * @param len   the length of the identifier
+ */
+void tx_slot_init(const uint8_t *id, size_t len);
+
+/**
+ * Get the delay before the first transmission
+ *
+ * @param period_ms     the TX period in milliseconds
+ *
+ * @return the phase of the endpoint into the period in milliseconds
+ */
+uint32_t tx_slot_first_delay_ms(uint32_t period_ms);
+
+/**
+ * Apply the jitter (and the pending re-randomized phase shift) to the TX period
+ *
+ * When the duty-cycle off-time is longer than the TX period, the jitter is applied above the
+ * off-time: otherwise the endpoints bounded by the duty-cycle would stay synchronized.
+ *
+ * @param period_ms     the TX period in milliseconds
+ * @param min_period_ms the min period allowed by the duty-cycle budget in milliseconds
+ *
+ * @return the adjusted period in milliseconds
+ */
+uint32_t tx_slot_adjust_period_ms(uint32_t period_ms, uint32_t min_period_ms);
+
+/**
+ * Report a suspected collision (confirmed uplink without ACK)
+ */
+void tx_slot_collision(void);
+
+/**
+ * Report a delivered uplink (ACK received)
+ */
+void tx_slot_delivered(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
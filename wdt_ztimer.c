@@ -18,59 +18,98 @@
 #include "debug.h"
 
 #include "ztimer.h"
-#include "ztimer/periodic.h"
 
 #include "fmt.h"
 #include "shell.h"
 
-#ifndef WDT_UTILS_KICK_PERIOD
-#define WDT_UTILS_KICK_PERIOD		4000LU	// msec
+#include "periph/wdt.h"
+
+#include "liveness.h"
+#include "wdt_ztimer.h"
+
+#if WDT_UTILS_TIMEOUT > WDT_UTILS_IWDG_MAX_MS
+#error "WDT_UTILS_TIMEOUT is above the max timeout of the IWDG"
 #endif
 
-#ifndef WDT_UTILS_TIMEOUT
-#define WDT_UTILS_TIMEOUT			10000 	// msec
+#if WDT_UTILS_MAX_STEP_MS + WDT_UTILS_MARGIN_MS > WDT_UTILS_TIMEOUT
+#error "WDT_UTILS_TIMEOUT is too short for the longest blocking step"
 #endif
 
-#include "periph/wdt.h"
+#if LIVENESS_SENDER_MAX_BUSY_MS + WDT_UTILS_MARGIN_MS >= WDT_UTILS_TIMEOUT
+#error "LIVENESS_SENDER_MAX_BUSY_MS is too long: the WDT would reset the board before the stuck sender is reported"
+#endif
 
-static unsigned cpt = 0;
+#if LIVENESS_SENDER_MAX_BUSY_MS < WDT_UTILS_MAX_STEP_MS
+#error "LIVENESS_SENDER_MAX_BUSY_MS is too short for the longest blocking step"
+#endif
 
-static const char* _param = "WDT";
+#if ENABLE_WDT_ZTIMER == 1
 
-static bool _wdt_kick_cb(void *arg)
+static unsigned cpt = 0;
+
+void wdt_ztimer_kick(void)
 {
-	(void)arg;
 	cpt++;
-    DEBUG("\n[%s] KICK %s %d\n", __FUNCTION__, (char*)arg, cpt);
+
+    // the WDT is kicked only when all the registered tasks are live
+    const char *stuck = liveness_check();
+    if (stuck != NULL) {
+        liveness_reboot(stuck);
+        return;
+    }
+
+    DEBUG("\n[%s] KICK %d\n", __FUNCTION__, cpt);
     wdt_kick();
+}
+
+static ztimer_t blocking_timer;
 
-	// function to call on each trigger returns true if the timer should keep going
-    return true;
+static void _blocking_kick(void *arg)
+{
+	(void)arg;
+	// the liveness of the tasks is checked from the ISR: a stuck sender is reported
+	wdt_ztimer_kick();
+	ztimer_set(ZTIMER_MSEC, &blocking_timer, WDT_UTILS_SLEEP_CHUNK_MS);
+}
+
+void wdt_ztimer_blocking_begin(void)
+{
+	blocking_timer.callback = _blocking_kick;
+	blocking_timer.arg = NULL;
+	ztimer_set(ZTIMER_MSEC, &blocking_timer, WDT_UTILS_SLEEP_CHUNK_MS);
+}
+
+void wdt_ztimer_blocking_end(void)
+{
+	ztimer_remove(ZTIMER_MSEC, &blocking_timer);
 }
 
-static ztimer_periodic_t _wdt_ztimer;
+void wdt_ztimer_sleep(ztimer_clock_t *clock, uint32_t duration)
+{
+	uint32_t chunk = (clock == ZTIMER_SEC) ? WDT_UTILS_SLEEP_CHUNK_MS / 1000 : WDT_UTILS_SLEEP_CHUNK_MS;
+	while (duration > chunk) {
+		ztimer_sleep(clock, chunk);
+		duration -= chunk;
+		wdt_ztimer_kick();
+	}
+	ztimer_sleep(clock, duration);
+	wdt_ztimer_kick();
+}
+
+#endif
 
 int start_wdt_ztimer(void) {
 
-    ztimer_periodic_init(ZTIMER_MSEC, &_wdt_ztimer, _wdt_kick_cb, (void*)_param, WDT_UTILS_KICK_PERIOD);
-    ztimer_periodic_start(&_wdt_ztimer);
 	wdt_setup_reboot(0, WDT_UTILS_TIMEOUT);
 	wdt_start();
 
-    if (!ztimer_is_set(ZTIMER_MSEC, &_wdt_ztimer.timer)) {
-    	printf("[%s] ERROR\n", __FUNCTION__);
-        return -1;
-    } else {
 #if	ENABLE_DEBUG == 1
-    	printf("[%s] WDT started (DEBUG mode)\n", __FUNCTION__);
+	printf("[%s] WDT started (DEBUG mode)\n", __FUNCTION__);
 #else
-		printf("[%s] WDT started (SILENT mode)\n", __FUNCTION__);
+	printf("[%s] WDT started (SILENT mode)\n", __FUNCTION__);
 #endif
-		printf("[%s] WDT kick period %ld msec\n", __FUNCTION__, WDT_UTILS_KICK_PERIOD);
-		printf("[%s] WDT timeout %d msec\n", __FUNCTION__, WDT_UTILS_TIMEOUT);
-		return 0;
-    }
-
+	printf("[%s] WDT timeout %ld msec (kicked by the progress points)\n", __FUNCTION__, WDT_UTILS_TIMEOUT);
+	printf("[%s] WDT max sleep chunk %ld msec\n", __FUNCTION__, WDT_UTILS_SLEEP_CHUNK_MS);
 	return 0;
 }
 
@@ -10,7 +10,84 @@
 #ifndef _WDT_TIMER_H
 #define _WDT_TIMER_H
 
+#include <inttypes.h>
+
+#include "ztimer.h"
+
+/*
+ * The WDT is kicked from the progress points of the sender (and of its long blocking steps)
+ * instead of a periodic timer: a kick proves that the sender progresses and it is done only
+ * when all the tasks registered into the liveness monitor are live. The sleeps of the sender
+ * are cut into chunks shorter than the WDT timeout.
+ */
+
+/*
+ * Longest legitimate blocking step between two progress points (msec):
+ * a join or a confirmed uplink with its RX windows at DR0
+ */
+#ifndef WDT_UTILS_MAX_STEP_MS
+#define WDT_UTILS_MAX_STEP_MS		20000LU
+#endif
+
+/*
+ * Max timeout of the IWDG (msec): LSI at 32 kHz, prescaler 256, reload 4095
+ */
+#ifndef WDT_UTILS_IWDG_MAX_MS
+#define WDT_UTILS_IWDG_MAX_MS		32000LU
+#endif
+
+/*
+ * Margin (msec) for the wakeup of the sleeping sender
+ */
+#ifndef WDT_UTILS_MARGIN_MS
+#define WDT_UTILS_MARGIN_MS			2000LU
+#endif
+
+#ifndef WDT_UTILS_TIMEOUT
+#define WDT_UTILS_TIMEOUT			WDT_UTILS_IWDG_MAX_MS	// msec
+#endif
+
+/*
+ * Max duration (msec) of a chunk of sleep
+ */
+#define WDT_UTILS_SLEEP_CHUNK_MS	(WDT_UTILS_TIMEOUT - WDT_UTILS_MARGIN_MS)
+
 int start_wdt_ztimer(void);
+
+#if ENABLE_WDT_ZTIMER == 1
+/**
+ * Progress point: kick the WDT if all the tasks are live (reboot otherwise)
+ */
+void wdt_ztimer_kick(void);
+
+/**
+ * Sleep with a kick of the WDT every WDT_UTILS_SLEEP_CHUNK_MS
+ *
+ * @param clock     ZTIMER_MSEC or ZTIMER_SEC
+ * @param duration  the duration in ticks of the clock
+ */
+void wdt_ztimer_sleep(ztimer_clock_t *clock, uint32_t duration);
+
+/**
+ * Kick the WDT every WDT_UTILS_SLEEP_CHUNK_MS (when all the tasks are live) during a blocking call
+ * longer than the WDT timeout (a confirmed uplink with the retransmissions of the MAC)
+ */
+void wdt_ztimer_blocking_begin(void);
+
+/**
+ * End of the blocking call: stop the kicks of wdt_ztimer_blocking_begin
+ */
+void wdt_ztimer_blocking_end(void);
+#else
+static inline void wdt_ztimer_kick(void) {}
+static inline void wdt_ztimer_blocking_begin(void) {}
+static inline void wdt_ztimer_blocking_end(void) {}
+static inline void wdt_ztimer_sleep(ztimer_clock_t *clock, uint32_t duration)
+{
+	ztimer_sleep(clock, duration);
+}
+#endif
+
 #if WDT_HAS_STOP
 int wdt_stop_cmd(int argc, char *argv[]);
 #endif